@@ -0,0 +1,212 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Scaling from one thread up to every hardware thread (or --max-threads) of
+// parse_batch(), on many small documents (random expressions of the grammar
+// of example_lisp()), and of parse_chunked(), on a log of newline-separated
+// records.
+//
+//   ./bench_batch [--json] [--documents N] [--log-bytes N] [--max-threads N] [--memoize]
+//
+// For every thread count it reports the documents (or records) and MB parsed
+// per second and the speedup over one thread; the baselines are a plain loop
+// of parse() calls and a single parse() of the whole log. The pool is started
+// once and reused by every pass, as a service would. The output is CSV, or
+// JSON with --json.
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../tools/lisp_grammar.hpp"
+#include "grammar.hpp"
+#include "batch.hpp"
+#include "parser.hpp"
+
+
+// -----
+
+
+namespace {
+
+struct measurement_t {
+    std::string mode;
+    std::size_t threads;
+    double seconds;
+    // Documents, or records of the log
+    double items_per_second;
+    double mb_per_second;
+    double speedup;
+};
+
+// The fastest of a few passes, each parsing every document
+template<typename F>
+double time_passes(F pass)
+{
+    double best = 0;
+    for (int k = 0; k < 5; ++k) {
+        auto start = std::chrono::steady_clock::now();
+        std::size_t parsed = pass();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (parsed == 0)
+            std::cerr << "nothing parsed" << std::endl;
+        if (k == 0 || seconds < best)
+            best = seconds;
+    }
+    return best;
+}
+
+void print(const measurement_t& m, bool json, bool& first)
+{
+    if (json) {
+        std::cout << (first ? "" : ",\n") << "  {\"mode\": \"" << m.mode << "\", \"threads\": " << m.threads
+                  << ", \"seconds\": " << m.seconds << ", \"items_per_second\": " << m.items_per_second
+                  << ", \"mb_per_second\": " << m.mb_per_second << ", \"speedup\": " << m.speedup << "}";
+    } else {
+        std::cout << m.mode << "," << m.threads << "," << m.seconds << "," << m.items_per_second << ","
+                  << m.mb_per_second << "," << m.speedup << std::endl;
+    }
+    first = false;
+}
+
+} // namespace
+
+
+// -----
+
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    std::size_t document_count = 200000;
+    std::size_t log_bytes = 8 << 20;
+    std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    wi::parse_options_t options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--documents") == 0 && i + 1 < argc) {
+            document_count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--log-bytes") == 0 && i + 1 < argc) {
+            log_bytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
+            max_threads = std::max((std::size_t)1, (std::size_t)std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--memoize") == 0) {
+            options.memoize = true;
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--json] [--documents N] [--log-bytes N] [--max-threads N] [--memoize]" << std::endl;
+            return 1;
+        }
+    }
+
+    wi::grammar_t g;
+    const wi::parser_t *p_lisp = make_lisp_grammar(g);
+
+    std::mt19937 rng(2023);
+    std::vector<std::string> inputs;
+    std::size_t bytes = 0;
+    for (std::size_t k = 0; k < document_count; ++k) {
+        inputs.push_back(random_lisp_expression(rng, 1 + rng() % 5));
+        bytes += inputs.back().size();
+    }
+    std::vector<std::string_view> documents(inputs.begin(), inputs.end());
+
+    // e.g. "user=1234 code=200 path=index"
+    wi::parser_t *p_log = g.make<wi::separated_by_parser_t>(
+        g.make<wi::string_parser_t>("\n"),
+        g.make<wi::separated_by_parser_t>(
+            g.make<wi::string_parser_t>(" "),
+            g.make<wi::sequence_of_parser_t>({
+                g.make<wi::letters_parser_t>(),
+                g.make<wi::string_parser_t>("="),
+                g.make<wi::choice_of_parser_t>({g.make<wi::digits_parser_t>(), g.make<wi::letters_parser_t>()})
+            })
+        )
+    );
+    static const char *keys[] = {"user", "code", "path", "method", "bytes"};
+    std::string log;
+    std::size_t records = 0;
+    while (log.size() < log_bytes) {
+        for (int k = 0, fields = 2 + rng() % 4; k < fields; ++k) {
+            log += std::string(k == 0 ? "" : " ") + keys[rng() % 5] + "=";
+            log += rng() % 2 ? std::to_string(rng() % 100000) : std::string(1 + rng() % 12, 'a' + rng() % 26);
+        }
+        log += "\n";
+        ++records;
+    }
+
+    auto measure = [&](std::string mode, std::size_t threads, double seconds, double baseline) {
+        return measurement_t{mode, threads, seconds, documents.size() / seconds, bytes / seconds / 1e6, baseline / seconds};
+    };
+    auto measure_log = [&](std::string mode, std::size_t threads, double seconds, double baseline) {
+        return measurement_t{mode, threads, seconds, records / seconds, log.size() / seconds / 1e6, baseline / seconds};
+    };
+
+    if (json)
+        std::cout << "[\n";
+    else
+        std::cout << "mode,threads,seconds,items_per_second,mb_per_second,speedup" << std::endl;
+    bool first = true;
+
+    double baseline = time_passes([&]() {
+        std::size_t parsed = 0;
+        for (std::string_view document : documents)
+            parsed += !wi::parse(p_lisp, std::string(document), options).error.has_value();
+        return parsed;
+    });
+    print(measure("loop", 1, baseline, baseline), json, first);
+
+    for (std::size_t threads = 1; threads <= max_threads; threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2) {
+        wi::work_stealing_pool_t pool(threads);
+        double seconds = time_passes([&]() {
+            std::size_t parsed = 0;
+            for (const wi::parser_state_t& ps : wi::parse_batch(p_lisp, documents, pool, options))
+                parsed += !ps.error.has_value();
+            return parsed;
+        });
+        print(measure("batch", threads, seconds, baseline), json, first);
+    }
+
+    double log_baseline = time_passes([&]() {
+        wi::parser_state_t ps = wi::parse(p_log, std::make_shared<const std::string>(log), options);
+        return ps.index == log.size() ? records : 0;
+    });
+    print(measure_log("log", 1, log_baseline, log_baseline), json, first);
+
+    for (std::size_t threads = 1; threads <= max_threads; threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2) {
+        wi::work_stealing_pool_t pool(threads);
+        double seconds = time_passes([&]() {
+            wi::chunked_result_t r = wi::parse_chunked(p_log, log, wi::after_delimiter('\n'), pool, options);
+            return r.state.index == log.size() ? records : 0;
+        });
+        print(measure_log("chunked", threads, seconds, log_baseline), json, first);
+    }
+
+    if (json)
+        std::cout << "\n]" << std::endl;
+    return 0;
+}
@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Cost of a one-byte edit with incremental_parser_t against a full parse(),
+// on config-like documents ("key=value" lines) of growing size.
+//
+//   ./bench_incremental [--json] [--sizes N,N,...] [--edits N]
+//
+// Every edit replaces one digit of a value, at a random line. For every size
+// it reports the time of a full parse, the mean time of an edit, the bytes of
+// the text an edit read and the entries it parsed again. The edits should
+// cost about the same at every size, the full parse growing with it. The
+// output is CSV, or JSON with --json.
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "incremental.hpp"
+#include "grammar.hpp"
+#include "parser.hpp"
+
+
+// -----
+
+
+namespace {
+
+struct measurement_t {
+    std::size_t bytes;
+    std::size_t entries;
+    double parse_seconds;
+    double edit_seconds;
+    double bytes_read;
+    double elements_parsed;
+    double speedup;
+};
+
+// The fastest of a few passes
+template<typename F>
+double time_passes(F pass)
+{
+    double best = 0;
+    for (int k = 0; k < 5; ++k) {
+        auto start = std::chrono::steady_clock::now();
+        std::size_t parsed = pass();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (parsed == 0)
+            std::cerr << "nothing parsed" << std::endl;
+        if (k == 0 || seconds < best)
+            best = seconds;
+    }
+    return best;
+}
+
+void print(const measurement_t& m, bool json, bool& first)
+{
+    if (json) {
+        std::cout << (first ? "" : ",\n") << "  {\"bytes\": " << m.bytes << ", \"entries\": " << m.entries
+                  << ", \"parse_seconds\": " << m.parse_seconds << ", \"edit_seconds\": " << m.edit_seconds
+                  << ", \"bytes_read\": " << m.bytes_read << ", \"elements_parsed\": " << m.elements_parsed
+                  << ", \"speedup\": " << m.speedup << "}";
+    } else {
+        std::cout << m.bytes << "," << m.entries << "," << m.parse_seconds << "," << m.edit_seconds << ","
+                  << m.bytes_read << "," << m.elements_parsed << "," << m.speedup << std::endl;
+    }
+    first = false;
+}
+
+} // namespace
+
+
+// -----
+
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    std::vector<std::size_t> sizes = {1 << 18, 1 << 20, 1 << 22, 1 << 24};
+    std::size_t edit_count = 2000;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            sizes.clear();
+            for (char *s = argv[++i]; *s != '\0'; s += *s == ',')
+                sizes.push_back(std::strtoull(s, &s, 10));
+        } else if (std::strcmp(argv[i], "--edits") == 0 && i + 1 < argc) {
+            edit_count = std::max((std::size_t)1, (std::size_t)std::strtoull(argv[++i], nullptr, 10));
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--json] [--sizes N,N,...] [--edits N]" << std::endl;
+            return 1;
+        }
+    }
+
+    // e.g. "width=80"
+    wi::grammar_t g;
+    wi::parser_t *p_config = g.make<wi::separated_by_parser_t>(
+        g.make<wi::string_parser_t>("\n"),
+        g.make<wi::sequence_of_parser_t>({
+            g.make<wi::letters_parser_t>(),
+            g.make<wi::string_parser_t>("="),
+            g.make<wi::choice_of_parser_t>({g.make<wi::digits_parser_t>(), g.make<wi::letters_parser_t>()})
+        })
+    );
+    static const char *keys[] = {"width", "height", "depth", "color", "title"};
+
+    if (json)
+        std::cout << "[\n";
+    else
+        std::cout << "bytes,entries,parse_seconds,edit_seconds,bytes_read,elements_parsed,speedup" << std::endl;
+    bool first = true;
+
+    std::mt19937 rng(2023);
+    for (std::size_t size : sizes) {
+        // Every value is a number, so that any of its digits can be edited
+        std::string text;
+        std::vector<std::size_t> digits;
+        std::size_t entries = 0;
+        while (text.size() < size) {
+            text += std::string(entries == 0 ? "" : "\n") + keys[rng() % 5] + "=";
+            digits.push_back(text.size());
+            text += std::to_string(1 + rng() % 100000);
+            ++entries;
+        }
+
+        double parse_seconds = time_passes([&]() {
+            wi::parser_state_t ps = wi::parse(p_config, std::make_shared<const std::string>(text));
+            return ps.index == text.size() ? entries : 0;
+        });
+
+        wi::incremental_parser_t parser(p_config, text);
+        std::size_t bytes_read = 0, elements_parsed = 0, edits = 0;
+        double edit_seconds = time_passes([&]() {
+            std::size_t parsed = 0;
+            for (std::size_t k = 0; k < edit_count; ++k) {
+                parser.edit({digits[rng() % digits.size()], 1, std::string(1, '1' + rng() % 9)});
+                bytes_read += parser.get_stats().bytes_read;
+                elements_parsed += parser.get_stats().elements_parsed;
+                parsed += parser.get_stats().elements_parsed;
+                ++edits;
+            }
+            return parsed;
+        }) / edit_count;
+
+        // The edits changed no length, so every entry is still there
+        if (parser.get_element_count() != entries)
+            std::cerr << "lost entries" << std::endl;
+        print(measurement_t{text.size(), entries, parse_seconds, edit_seconds, (double)bytes_read / edits,
+                            (double)elements_parsed / edits, parse_seconds / edit_seconds}, json, first);
+    }
+
+    if (json)
+        std::cout << "\n]" << std::endl;
+    return 0;
+}
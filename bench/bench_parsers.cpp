@@ -0,0 +1,437 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Throughput of every combinator of parser.hpp on generated inputs, from
+// 1 KB up to 100 MB. Each benchmark is a record grammar; the driver applies
+// it over and over until the input is consumed, dropping the results, so
+// memory stays bounded by a record and not by the input.
+//
+//   ./bench_parsers [--json] [--optimize] [--vm] [--max-bytes N] [--filter NAME]
+//
+// For every benchmark and size it reports the throughput (MB/s and ns per
+// byte), the heap allocations per pass (counted by replacing the global
+// operator new) and the peak RSS during the run. The output is CSV, or JSON
+// with --json, meant to be diffed between releases. --optimize runs every
+// grammar through optimize_grammar() first, and --vm runs it compiled into a
+// vm_program_t.
+
+#include <sys/resource.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "static_parser.hpp"
+#include "optimizer.hpp"
+#include "vm.hpp"
+#include "grammar.hpp"
+#include "parser.hpp"
+
+
+// -----
+
+
+namespace {
+
+std::atomic<std::size_t> allocation_count(0);
+std::atomic<std::size_t> allocation_bytes(0);
+
+void* counted_allocate(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* counted_allocate(std::size_t size, std::align_val_t alignment)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    std::size_t a = static_cast<std::size_t>(alignment);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a))
+        return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return counted_allocate(size); }
+void* operator new[](std::size_t size) { return counted_allocate(size); }
+void* operator new(std::size_t size, std::align_val_t a) { return counted_allocate(size, a); }
+void* operator new[](std::size_t size, std::align_val_t a) { return counted_allocate(size, a); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+
+// -----
+
+
+// On Linux the peak RSS can be reset, which gives a peak per measurement;
+// elsewhere this falls back on the peak of the whole process
+void reset_peak_rss()
+{
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs)
+        clear_refs << "5";
+}
+
+std::size_t peak_rss_kb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::strtoull(line.c_str() + 6, nullptr, 10);
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+
+// -----
+
+
+// Appends records produced by gen() until the input holds at least size bytes
+std::string generate(std::size_t size, std::function<void(std::mt19937&, std::string&)> gen)
+{
+    std::mt19937 rng(42);
+    std::string s;
+    s.reserve(size + 256);
+    while (s.size() < size)
+        gen(rng, s);
+    return s;
+}
+
+const std::vector<std::string> keywords = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do",
+    "double", "else", "enum", "extern", "float", "for", "goto", "if",
+    "int", "long", "register", "return", "short", "signed", "sizeof", "static"
+};
+
+void gen_word(std::mt19937& rng, std::string& s)
+{
+    for (std::size_t n = 1 + rng() % 8; n > 0; --n)
+        s.push_back('a' + rng() % 26);
+}
+
+void gen_number(std::mt19937& rng, std::string& s)
+{
+    for (std::size_t n = 1 + rng() % 6; n > 0; --n)
+        s.push_back('0' + rng() % 10);
+}
+
+// A random s-expression of bounded depth
+void gen_sexpr(std::mt19937& rng, std::string& s, int depth)
+{
+    if (depth == 0 || rng() % 3 == 0) {
+        gen_word(rng, s);
+        return;
+    }
+    s.push_back('(');
+    for (std::size_t n = 1 + rng() % 4; n > 0; --n) {
+        gen_sexpr(rng, s, depth - 1);
+        if (n > 1)
+            s.push_back(' ');
+    }
+    s.push_back(')');
+}
+
+// A wide choice: one alternative per keyword
+const wi::parser_t* make_statement(wi::grammar_t& g)
+{
+    using namespace wi;
+    choice_of_parser_t *choice = g.make<choice_of_parser_t>();
+    for (const std::string& keyword : keywords) {
+        choice->add_parser(g.make<sequence_of_parser_t>({
+            g.make<string_parser_t>(keyword),
+            g.make<whitespaces_parser_t>()
+        }));
+    }
+    return choice;
+}
+
+struct benchmark_t {
+    std::string name;
+    std::function<void(std::mt19937&, std::string&)> gen;
+    std::function<const wi::parser_t*(wi::grammar_t&)> build;
+};
+
+std::vector<benchmark_t> make_benchmarks()
+{
+    using namespace wi;
+    return {
+        {"string_parser_t",
+            [](std::mt19937&, std::string& s) { s += "lorem "; },
+            [](grammar_t& g) -> const parser_t* {
+                return g.make<string_parser_t>("lorem ");
+            }},
+        {"choice_of_string_parser_t",
+            [](std::mt19937& rng, std::string& s) { s += keywords[rng() % keywords.size()]; s += ' '; },
+            [](grammar_t& g) -> const parser_t* {
+                return g.make<sequence_of_parser_t>({
+                    g.make<choice_of_string_parser_t>(keywords, choice_of_string_parser_t::match_mode_t::longest),
+                    g.make<maybe_whitespaces_parser_t>()
+                });
+            }},
+        {"choice_of_parser_t",
+            [](std::mt19937& rng, std::string& s) { s += keywords[rng() % keywords.size()]; s += ' '; },
+            [](grammar_t& g) -> const parser_t* {
+                return make_statement(g);
+            }},
+        {"choice_of_parser_t/dispatch",
+            [](std::mt19937& rng, std::string& s) { s += keywords[rng() % keywords.size()]; s += ' '; },
+            [](grammar_t& g) -> const parser_t* {
+                const parser_t *statement = make_statement(g);
+                build_dispatch_tables(statement);
+                return statement;
+            }},
+        {"chars_parser_t",
+            [](std::mt19937& rng, std::string& s) { gen_number(rng, s); s += ' '; },
+            [](grammar_t& g) -> const parser_t* {
+                return g.make<sequence_of_parser_t>({
+                    g.make<digits_parser_t>(),
+                    g.make<maybe_whitespaces_parser_t>()
+                });
+            }},
+        {"many_parser_t",
+            [](std::mt19937& rng, std::string& s) { gen_word(rng, s); s += ' '; },
+            [](grammar_t& g) -> const parser_t* {
+                return g.make<sequence_of_parser_t>({
+                    g.make<many_parser_t>(g.make<letter_parser_t>()),
+                    g.make<whitespace_parser_t>()
+                });
+            }},
+        {"separated_by_parser_t",
+            [](std::mt19937& rng, std::string& s) {
+                for (std::size_t n = 1 + rng() % 8; n > 0; --n) {
+                    gen_number(rng, s);
+                    if (n > 1)
+                        s.push_back(',');
+                }
+                s.push_back('\n');
+            },
+            [](grammar_t& g) -> const parser_t* {
+                return g.make<sequence_of_parser_t>({
+                    g.make<separated_by_parser_t>(g.make<string_parser_t>(","), g.make<digits_parser_t>()),
+                    g.make<string_parser_t>("\n")
+                });
+            }},
+        {"static_separated_by_parser_t",
+            [](std::mt19937& rng, std::string& s) {
+                for (std::size_t n = 1 + rng() % 8; n > 0; --n) {
+                    gen_number(rng, s);
+                    if (n > 1)
+                        s.push_back(',');
+                }
+                s.push_back('\n');
+            },
+            [](grammar_t& g) -> const parser_t* {
+                using namespace wi::st;
+                return to_parser(g, seq(separated_by(lit<','>, chars(digit)), lit<'\n'>));
+            }},
+        {"between_parser_t",
+            [](std::mt19937& rng, std::string& s) { s.push_back('('); gen_word(rng, s); s.push_back(')'); },
+            [](grammar_t& g) -> const parser_t* {
+                return g.make<between_parser_t>(
+                    g.make<string_parser_t>("("),
+                    g.make<string_parser_t>(")"),
+                    g.make<letters_parser_t>()
+                );
+            }},
+        {"lazy_parser_t",
+            [](std::mt19937& rng, std::string& s) { gen_sexpr(rng, s, 6); s.push_back('\n'); },
+            [](grammar_t& g) -> const parser_t* {
+                lazy_parser_t *p_lazy_term = g.make<lazy_parser_t>();
+                parser_t *p_term = g.make<choice_of_parser_t>({
+                    g.make<letters_parser_t>(),
+                    g.make<between_parser_t>(
+                        g.make<string_parser_t>("("),
+                        g.make<string_parser_t>(")"),
+                        g.make<separated_by_parser_t>(g.make<string_parser_t>(" "), p_lazy_term)
+                    )
+                });
+                p_lazy_term->set_parser(p_term);
+                return g.make<sequence_of_parser_t>({p_term, g.make<string_parser_t>("\n")});
+            }}
+    };
+}
+
+
+// -----
+
+
+struct measurement_t {
+    std::string name;
+    std::size_t bytes;
+    std::size_t iterations;
+    double seconds;
+    std::size_t allocations;
+    std::size_t allocated_bytes;
+    std::size_t peak_rss_kb;
+    std::size_t records;
+    bool ok;
+};
+
+// One pass over the input, record by record; returns the number of records
+// or 0 if a record failed to parse
+std::size_t run_pass(const wi::parser_t *record, const std::shared_ptr<const std::string>& input)
+{
+    wi::parser_state_t parser_state(input);
+    parser_state.set_context(std::make_shared<wi::parse_context_t>());
+    std::size_t records = 0;
+    while (parser_state.index < input->size()) {
+        parser_state = record->apply(std::move(parser_state));
+        if (parser_state.error.has_value())
+            return 0;
+        ++records;
+    }
+    return records;
+}
+
+measurement_t measure(const benchmark_t& benchmark, std::size_t size, bool optimize, bool vm)
+{
+    wi::grammar_t g, optimized;
+    const wi::parser_t *record = benchmark.build(g);
+    if (optimize)
+        record = wi::optimize_grammar(record, optimized);
+    if (vm)
+        record = g.make<wi::vm_parser_t>(record);
+    std::shared_ptr<const std::string> input = std::make_shared<const std::string>(generate(size, benchmark.gen));
+
+    // Small inputs are parsed repeatedly, for at least min_seconds
+    const double min_seconds = 0.2;
+    measurement_t m = {benchmark.name + (optimize ? "/optimized" : "") + (vm ? "/vm" : ""), input->size(), 0, 0.0, 0, 0, 0, 0, true};
+    reset_peak_rss();
+    std::size_t allocations = allocation_count.load();
+    std::size_t allocated_bytes = allocation_bytes.load();
+    auto start = std::chrono::steady_clock::now();
+    do {
+        m.records = run_pass(record, input);
+        m.ok = m.ok && m.records != 0;
+        ++m.iterations;
+        m.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (m.seconds < min_seconds);
+    m.allocations = (allocation_count.load() - allocations) / m.iterations;
+    m.allocated_bytes = (allocation_bytes.load() - allocated_bytes) / m.iterations;
+    m.peak_rss_kb = peak_rss_kb();
+    return m;
+}
+
+void print_csv_header()
+{
+    std::cout << "benchmark,bytes,iterations,seconds,mb_per_s,ns_per_byte,"
+              << "allocations,allocated_bytes,peak_rss_kb,records,ok" << std::endl;
+}
+
+void print_csv(const measurement_t& m)
+{
+    double seconds = m.seconds / m.iterations;
+    std::cout << m.name << "," << m.bytes << "," << m.iterations << "," << seconds << ","
+              << (m.bytes / 1e6) / seconds << "," << seconds * 1e9 / m.bytes << ","
+              << m.allocations << "," << m.allocated_bytes << "," << m.peak_rss_kb << ","
+              << m.records << "," << (m.ok ? "true" : "false") << std::endl;
+}
+
+void print_json(const measurement_t& m, bool first)
+{
+    double seconds = m.seconds / m.iterations;
+    std::cout << (first ? "  " : ",\n  ")
+              << "{\"benchmark\": \"" << m.name << "\", \"bytes\": " << m.bytes
+              << ", \"iterations\": " << m.iterations << ", \"seconds\": " << seconds
+              << ", \"mb_per_s\": " << (m.bytes / 1e6) / seconds
+              << ", \"ns_per_byte\": " << seconds * 1e9 / m.bytes
+              << ", \"allocations\": " << m.allocations
+              << ", \"allocated_bytes\": " << m.allocated_bytes
+              << ", \"peak_rss_kb\": " << m.peak_rss_kb
+              << ", \"records\": " << m.records
+              << ", \"ok\": " << (m.ok ? "true" : "false") << "}" << std::flush;
+}
+
+
+// -----
+
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    bool optimize = false;
+    bool vm = false;
+    std::size_t max_bytes = 100 << 20;
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--optimize") == 0) {
+            optimize = true;
+        } else if (std::strcmp(argv[i], "--vm") == 0) {
+            vm = true;
+        } else if (std::strcmp(argv[i], "--max-bytes") == 0 && i + 1 < argc) {
+            max_bytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--json] [--optimize] [--vm] [--max-bytes N] [--filter NAME]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (json)
+        std::cout << "[\n";
+    else
+        print_csv_header();
+
+    bool first = true;
+    for (const benchmark_t& benchmark : make_benchmarks()) {
+        if (benchmark.name.find(filter) == std::string::npos)
+            continue;
+        for (std::size_t size = 1 << 10; size <= max_bytes; size *= 10) {
+            measurement_t m = measure(benchmark, size, optimize, vm);
+            if (json)
+                print_json(m, first);
+            else
+                print_csv(m);
+            first = false;
+        }
+    }
+
+    if (json)
+        std::cout << "\n]" << std::endl;
+    return 0;
+}
@@ -0,0 +1,188 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Compares the ways of matching runs of characters (chars_parser_t and
+// friends) on multi-megabyte inputs:
+// - "regex": the original path, one std::regex_search per byte inside
+//   many_parser_t, with the results concatenated afterwards
+// - "many": the same combinator path, using a char_class_t lookup
+// - "chars_parser_t": the dedicated parser, backed by class_scanner_t
+// - "scan/<isa>": the bare class_scanner_t, for each instruction set
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <regex>
+
+#include "class_scanner.hpp"
+#include "parser.hpp"
+
+
+// -----
+
+
+// char_parser_t as it used to be, matching every byte through std::regex
+class regex_char_parser_t : public wi::parser_t {
+    std::regex rexp;
+
+public:
+    regex_char_parser_t(std::regex _rexp)
+    : rexp(_rexp)
+    {}
+
+    wi::parser_state_t run(wi::parser_state_t parser_state) const
+    {
+        if (parser_state.error.has_value())
+            return parser_state;
+        if (parser_state.index < parser_state.target_string.size()) {
+            std::string first_char = std::string(1, parser_state.target_string[parser_state.index]);
+            if (std::regex_search(first_char, rexp))
+                return parser_state.set_result(first_char).set_index(parser_state.index + 1);
+        }
+        return parser_state.set_result("").set_error("no match");
+    }
+};
+
+// maybe_chars_parser_t as it used to be: many + concatenation
+class legacy_chars_parser_t : public wi::parser_t {
+    wi::many_parser_t many_parser;
+
+public:
+    legacy_chars_parser_t(const wi::parser_t *char_parser)
+    : many_parser(char_parser)
+    {}
+
+    wi::parser_state_t run(wi::parser_state_t parser_state) const
+    {
+        parser_state = many_parser.run(parser_state);
+        if (parser_state.error.has_value())
+            return parser_state;
+        return parser_state.map_result([](std::any x) {
+            std::vector<std::any> v = std::any_cast< std::vector<std::any> >(x);
+            std::string s;
+            for (std::any& a : v)
+                s += std::any_cast<std::string>(a);
+            return s;
+        });
+    }
+};
+
+
+// -----
+
+
+// Runs of digits separated by runs of whitespace, of random lengths
+std::string make_tokens(std::size_t size, std::size_t max_run)
+{
+    std::mt19937 rng(42);
+    const char blanks[] = " \t\n";
+    std::string s;
+    s.reserve(size + 2 * max_run);
+    while (s.size() < size) {
+        for (std::size_t n = 1 + rng() % max_run; n > 0; --n)
+            s.push_back('0' + rng() % 10);
+        for (std::size_t n = 1 + rng() % max_run; n > 0; --n)
+            s.push_back(blanks[rng() % 3]);
+    }
+    return s;
+}
+
+template<typename F>
+void report(const std::string& input_name, const std::string& impl, std::size_t bytes, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::size_t check = f();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << input_name << "," << impl << "," << bytes << "," << seconds << ","
+              << (bytes / 1e6) / seconds << "," << check << std::endl;
+}
+
+void bench_parsers(const std::string& input_name, const std::string& input, const wi::parser_t *digits, const wi::parser_t *blanks, const std::string& impl)
+{
+    report(input_name, impl, input.size(), [&]() {
+        wi::parser_state_t state(input);
+        std::size_t tokens = 0;
+        while (state.index < input.size() && !state.error.has_value()) {
+            state = digits->run(state);
+            state = blanks->run(state);
+            ++tokens;
+        }
+        return tokens;
+    });
+}
+
+void bench_scanners(const std::string& input_name, const std::string& input)
+{
+    wi::class_scanner_t digits(wi::char_class_t("[0-9]")), blanks(wi::char_class_t("\\s"));
+    for (wi::scan_isa_t isa : {wi::scan_isa_t::scalar, wi::scan_isa_t::ssse3, wi::scan_isa_t::avx2, wi::scan_isa_t::avx512}) {
+        if (!wi::scan_isa_supported(isa))
+            continue;
+        report(input_name, std::string("scan/") + wi::scan_isa_name(isa), input.size(), [&]() {
+            std::size_t index = 0, tokens = 0;
+            while (index < input.size()) {
+                index = digits.scan(input, index, isa);
+                index = blanks.scan(input, index, isa);
+                ++tokens;
+            }
+            return tokens;
+        });
+    }
+}
+
+
+// -----
+
+
+int main()
+{
+    using namespace wi;
+
+    const std::size_t size = 8 << 20;
+    std::vector<std::pair<std::string, std::string>> inputs = {
+        {"short_runs", make_tokens(size, 8)},
+        {"long_runs", make_tokens(size, 256)},
+        {"single_run", std::string(size, ' ') + "0"}
+    };
+
+    regex_char_parser_t regex_digit(std::regex("[0-9]")), regex_blank(std::regex("\\s"));
+    legacy_chars_parser_t regex_digits(&regex_digit), regex_blanks(&regex_blank);
+    char_parser_t digit(char_class_t("[0-9]")), blank(char_class_t("\\s"));
+    legacy_chars_parser_t many_digits(&digit), many_blanks(&blank);
+    maybe_digits_parser_t digits;
+    maybe_whitespaces_parser_t blanks;
+
+    std::cout << "input,impl,bytes,seconds,mb_per_s,tokens" << std::endl;
+    for (auto& [name, input] : inputs) {
+        // The combinator paths are far too slow for the whole input
+        std::string head = input.substr(0, input.size() / 16);
+        bench_parsers(name + "/16", head, &regex_digits, &regex_blanks, "regex");
+        bench_parsers(name + "/16", head, &many_digits, &many_blanks, "many");
+        bench_parsers(name + "/16", head, &digits, &blanks, "chars_parser_t");
+
+        bench_parsers(name, input, &digits, &blanks, "chars_parser_t");
+        bench_scanners(name, input);
+    }
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_ARENA_HPP_
+#define _WI_ARENA_HPP_ "1.0.2b"
+
+#include <memory_resource>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+namespace wi {
+// -----
+
+
+// A bump allocator: memory is carved out of large blocks and only given back
+// all at once, by release() or by the destructor. Deallocating is a no-op.
+// It is a std::pmr::memory_resource, so any pmr container can use it.
+class parse_arena_t : public std::pmr::memory_resource {
+    struct block_t {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size;
+    };
+
+    std::vector<block_t> blocks;
+    unsigned char *current;
+    std::size_t remaining;
+    std::size_t block_size;
+
+    std::size_t allocations;
+    std::size_t bytes_allocated;
+    std::size_t bytes_reserved;
+
+public:
+    parse_arena_t(std::size_t _block_size = 64 * 1024);
+    ~parse_arena_t();
+
+    parse_arena_t(const parse_arena_t&) = delete;
+    parse_arena_t& operator=(const parse_arena_t&) = delete;
+
+    void release();
+
+    // Number of allocations served and bytes handed out by the arena
+    std::size_t get_allocations() const;
+    std::size_t get_bytes_allocated() const;
+    // Number of blocks (i.e. of real allocations) and their total size
+    std::size_t get_block_count() const;
+    std::size_t get_bytes_reserved() const;
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+
+// -----
+} // namespace wi
+#endif // _WI_ARENA_HPP_
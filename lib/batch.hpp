@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_BATCH_HPP_
+#define _WI_BATCH_HPP_ "1.0.2b"
+
+#include "parser.hpp"
+
+#include <condition_variable>
+#include <string_view>
+#include <functional>
+#include <exception>
+#include <cstddef>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+
+namespace wi {
+// -----
+
+
+// A fixed set of threads running the indices [0, count) of a task. Each
+// worker starts with an even share of the indices and takes them from the
+// front, one at a time; a worker that ran out steals the back half of the
+// share of another one, so uneven tasks still keep every thread busy.
+//
+// The thread calling for_each() is one of the workers, so a pool of one
+// thread starts none.
+class work_stealing_pool_t {
+public:
+    // 0 threads means one per hardware thread
+    work_stealing_pool_t(std::size_t threads = 0);
+    ~work_stealing_pool_t();
+
+    work_stealing_pool_t(const work_stealing_pool_t&) = delete;
+    work_stealing_pool_t& operator=(const work_stealing_pool_t&) = delete;
+
+    std::size_t get_thread_count() const;
+
+    // Calls task(i) for every i in [0, count), concurrently, and returns once
+    // they are all done. If a call throws, the indices not yet started are
+    // skipped and the first exception is rethrown. Calls from several
+    // threads run one after the other.
+    void for_each(std::size_t count, const std::function<void(std::size_t)>& task);
+
+private:
+    // The indices [begin, end) left to a worker
+    struct share_t {
+        std::mutex lock;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    std::size_t worker_count;
+    std::unique_ptr<share_t[]> shares;
+    std::vector<std::thread> threads;
+
+    std::mutex calls;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(std::size_t)> *task;
+    std::size_t generation;
+    std::size_t running;
+    bool stopping;
+    std::exception_ptr failure;
+    std::atomic<bool> failed;
+
+    bool take(std::size_t worker, std::size_t& index);
+    void work(std::size_t worker);
+    void thread_main(std::size_t worker);
+};
+
+
+// -----
+
+
+// Runs a parser over every document, spread over the threads of a pool, and
+// returns the final states in the order of the documents. Every document
+// gets its own parse context, created on the thread that parses it, so the
+// memo table, the arena and the statistics are never shared; the options
+// (and thus on_event, if set) are shared by all of them.
+//
+// Running a grammar concurrently is safe once it is built: the nodes,
+// lazy_parser_t targets included, are only read during a parse. It is up to
+// the caller not to change the grammar (set_parser(), set_memoize(),
+// build_dispatch_tables(), optimize_grammar(), ...) while a batch runs, and
+// to make the functions given to map() / chain() and on_event safe to call
+// from several threads at once.
+//
+// The documents are not copied: they must outlive the returned states,
+// whose errors and spans refer to them.
+std::vector<parser_state_t> parse_batch(const parser_t* parser, const std::vector<std::string_view>& documents, work_stealing_pool_t& pool, const parse_options_t& options = parse_options_t());
+// The same, on a pool of the given number of threads (0 for one per
+// hardware thread) started for this batch only
+std::vector<parser_state_t> parse_batch(const parser_t* parser, const std::vector<std::string_view>& documents, std::size_t threads = 0, const parse_options_t& options = parse_options_t());
+
+
+// -----
+
+
+// Whether an element of a list may begin at input[index], i.e. whether the
+// input can be cut there (see parse_chunked())
+using record_boundary_t = std::function<bool(std::string_view input, std::size_t index)>;
+
+// A boundary right after every delimiter byte, e.g. after_delimiter('\n')
+record_boundary_t after_delimiter(char delimiter);
+
+// The outcome of parse_chunked()
+struct chunked_result_t {
+    // The final state of the list, as run() would leave it: the elements in
+    // the result, the index it stopped at (and the error of a many1_parser_t
+    // that matched nothing, or of an element nested deeper than
+    // parse_options_t::max_depth)
+    parser_state_t state;
+    // The failure that ended the list before the end of the input, e.g. the
+    // malformed record (or separator) at state.index; unset if the list
+    // reached the end of the input
+    parse_error_t stop_error;
+    std::size_t chunks;
+    // The chunks that did not start where the previous one ended, and whose
+    // records were thus parsed again, serially
+    std::size_t resynchronized;
+};
+
+// Runs a many_parser_t, many1_parser_t or separated_by_parser_t over an
+// input held in memory (e.g. a mapped_file_t), on the threads of a pool:
+//
+//   mapped_file_t file("app.log");
+//   chunked_result_t r = parse_chunked(p_lines, file.get_view(), after_delimiter('\n'));
+//
+// The input is cut into chunks of about chunk_size bytes, at the first
+// boundary past each multiple of chunk_size, and the elements starting in
+// each chunk are parsed in parallel, with the indices of the whole input.
+// The chunks are then stitched in order: if the elements of a chunk did not
+// end exactly where the next chunk starts (an element ran past the
+// boundary, or the boundary was not a real one), the elements up to the next
+// chunk that does line up are parsed again, serially. The outcome is thus
+// the same as run(), whatever the boundaries; they only decide how much of
+// the work is done in parallel.
+//
+// As with parse_stream(), each element (and separator) is parsed from an
+// empty incoming result, and a list whose element and separator matched
+// nothing ends there instead of looping. Every chunk has its own context;
+// the lists inside the elements go on the heap (use_arena is ignored), and
+// on_event is not supported. The input must outlive the result.
+chunked_result_t parse_chunked(const parser_t* list_parser, std::string_view input, record_boundary_t is_boundary,
+                               work_stealing_pool_t& pool, const parse_options_t& options = parse_options_t(),
+                               std::size_t chunk_size = 1 << 20);
+chunked_result_t parse_chunked(const parser_t* list_parser, std::string_view input, record_boundary_t is_boundary,
+                               std::size_t threads = 0, const parse_options_t& options = parse_options_t(),
+                               std::size_t chunk_size = 1 << 20);
+
+
+// -----
+} // namespace wi
+#endif // _WI_BATCH_HPP_
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_CHAR_CLASS_HPP_
+#define _WI_CHAR_CLASS_HPP_ "1.0.2b"
+
+#include <cstdint>
+#include <string>
+#include <regex>
+
+
+namespace wi {
+// -----
+
+
+// A set of bytes, stored as a 256-bit lookup table. It is compiled once, at
+// construction, so matching a character is a single table lookup.
+//
+// The pattern constructor understands a single character, an escape sequence
+// (\s, \S, \d, \D, \w, \W, \t, \n, ...), the "." wildcard and bracket
+// expressions such as [A-Za-z], [^)\]] or [\s,;]. Any other std::regex is
+// supported too, by matching it once against every possible byte.
+class char_class_t {
+    std::uint64_t bits[4];
+
+public:
+    char_class_t();
+    char_class_t(const char *pattern);
+    char_class_t(const std::string& pattern);
+    char_class_t(const std::regex& rexp);
+
+    bool contains(unsigned char c) const
+    {
+        return (bits[c >> 6] >> (c & 63)) & 1;
+    }
+
+    char_class_t& add(unsigned char c);
+    char_class_t& add_range(unsigned char first, unsigned char last);
+    char_class_t& add_class(const char_class_t& other);
+    char_class_t& negate();
+    char_class_t& clear();
+
+    bool empty() const;
+    std::size_t size() const;
+    const std::uint64_t* get_bits() const;
+
+    bool operator==(const char_class_t& other) const;
+    bool operator!=(const char_class_t& other) const;
+
+    // A bracket expression describing the class, e.g. "[0-9]"
+    std::string to_string() const;
+};
+
+
+// -----
+} // namespace wi
+#endif // _WI_CHAR_CLASS_HPP_
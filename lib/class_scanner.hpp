@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_CLASS_SCANNER_HPP_
+#define _WI_CLASS_SCANNER_HPP_ "1.0.2b"
+
+#include "char_class.hpp"
+
+#include <string_view>
+#include <cstdint>
+
+
+namespace wi {
+// -----
+
+
+enum class scan_isa_t {
+    scalar,
+    ssse3,   // 16 bytes at a time
+    avx2,    // 32 bytes at a time
+    avx512   // 64 bytes at a time
+};
+
+const char* scan_isa_name(scan_isa_t isa);
+
+// The widest instruction set available on the running CPU
+scan_isa_t scan_best_isa();
+
+bool scan_isa_supported(scan_isa_t isa);
+
+
+// -----
+
+
+// Finds the end of a run of characters belonging to a class. The class is
+// turned into two 16-byte nibble tables at construction, which lets the SIMD
+// implementations test a whole vector of bytes with a couple of shuffles,
+// whatever the class looks like.
+class class_scanner_t {
+    char_class_t char_class;
+    alignas(16) std::uint8_t low_nibble_masks[2][16];
+    scan_isa_t isa;
+
+public:
+    class_scanner_t();
+    class_scanner_t(char_class_t _char_class);
+
+    // Returns the index of the first character at or after `from` which is
+    // not a member of the class (or s.size() if there is none)
+    std::size_t scan(std::string_view s, std::size_t from = 0) const;
+    std::size_t scan(std::string_view s, std::size_t from, scan_isa_t _isa) const;
+
+    const char_class_t& get_char_class() const;
+    scan_isa_t get_isa() const;
+
+    // Forces an implementation, mostly for benchmarking
+    class_scanner_t& set_isa(scan_isa_t _isa);
+};
+
+
+// -----
+} // namespace wi
+#endif // _WI_CLASS_SCANNER_HPP_
@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_CODEGEN_HPP_
+#define _WI_CODEGEN_HPP_ "1.0.2b"
+
+#include "grammar.hpp"
+#include "parser.hpp"
+
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <utility>
+#include <string>
+#include <vector>
+#include <map>
+
+
+namespace wi {
+// -----
+
+
+struct codegen_options_t {
+    // The namespace of the generated parser; it also names the header guard
+    std::string namespace_name = "generated_parser";
+};
+
+// Emits a standalone C++ 17 header holding a recursive-descent parser for the
+// grammar reachable from a root: one function per node, numbered as in
+// dump_grammar(), with the character classes turned into bit tables and the
+// literals into string constants. It only needs the standard library.
+//
+//   std::ofstream("lisp_parser.hpp") << generate_cpp(p_root, {"lisp"});
+//
+//   std::size_t index = 0;
+//   std::any result = "";
+//   if (lisp::parse(input, index, result)) ...
+//
+// parse() succeeds where the grammar does, with the same index and the same
+// result: std::string leaves in std::vector<std::any> lists, as without
+// parse_options_t::span_results and use_arena. On failure it returns false
+// and leaves index and result untouched. The result passed in is the one seen
+// by nodes that forward their incoming result, "" for a fresh parser_state_t.
+//
+// The function of a map_parser_t cannot be emitted: the header declares a
+// std::any map_N(std::any) for every such node #N, to be defined by the user.
+// chain_parser_t nodes, whose parsers are only known at run time, and custom
+// node types cannot be generated and make generate() throw. Memoization is
+// left out, as it does not change the results.
+class cpp_generator_t {
+public:
+    cpp_generator_t(codegen_options_t _options = codegen_options_t());
+
+    std::string generate(const parser_t *root);
+
+    // The maps whose functions the generated code calls, by function name
+    const std::vector<std::pair<std::string, const map_parser_t*>>& get_map_functions() const;
+
+private:
+    codegen_options_t options;
+    std::vector<const parser_t*> nodes;
+    std::unordered_map<const parser_t*, std::size_t> ids;
+    std::map<std::vector<std::uint64_t>, std::size_t> classes;
+    std::vector<std::pair<std::string, const map_parser_t*>> map_functions;
+    // Whether some node reads the result it was handed
+    bool forwards;
+
+    std::string call(const parser_t *parser) const;
+    std::string class_name(const char_class_t& char_class);
+    void generate_node(std::stringstream& ss, std::size_t id, const first_set_analysis_t& analysis);
+};
+
+std::string generate_cpp(const parser_t *root, codegen_options_t options = codegen_options_t());
+
+
+// -----
+} // namespace wi
+#endif // _WI_CODEGEN_HPP_
@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_FIRST_SET_HPP_
+#define _WI_FIRST_SET_HPP_ "1.0.2b"
+
+#include "char_class.hpp"
+
+#include <unordered_map>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace wi {
+class parser_t;
+}
+
+
+namespace wi {
+// -----
+
+
+// What a node can start with: the bytes a match may begin with, and whether
+// it may match without consuming anything (in which case it is viable
+// whatever comes next, the end of the input included). Nodes that cannot
+// tell (custom parsers, chain targets) use any().
+struct first_set_t {
+    char_class_t bytes;
+    bool nullable = false;
+
+    static first_set_t any();
+
+    // Whether a node with this set may succeed on input[index...]; slot 256
+    // stands for the end of the input
+    bool viable(std::size_t slot) const;
+
+    bool operator==(const first_set_t& other) const;
+    bool operator!=(const first_set_t& other) const;
+};
+
+
+// -----
+
+
+// Computes the first_set_t of every node reachable from a root. The sets of
+// recursive grammars (through lazy_parser_t) are found by iterating to a
+// fixpoint, starting from the empty set.
+//
+//   first_set_analysis_t analysis(p_root);
+//   analysis.build_dispatch_tables();
+//
+// The sets describe the grammar as it is when the analysis runs: after
+// changing any node, run it again.
+class first_set_analysis_t {
+public:
+    first_set_analysis_t(const parser_t *root);
+
+    // The set of a node reached by the analysis; any() for the others
+    first_set_t get(const parser_t *parser) const;
+    std::size_t node_count() const;
+    // The number of passes the fixpoint took
+    std::size_t get_iterations() const;
+
+    // Gives every reachable choice_of_parser_t a dispatch table, so that it
+    // only tries the alternatives that can match the next byte
+    void build_dispatch_tables() const;
+
+private:
+    std::vector<const parser_t*> nodes; // children before parents, mostly
+    std::unordered_map<const parser_t*, first_set_t> sets;
+    std::size_t iterations;
+};
+
+
+// -----
+
+
+// For every next byte (slot 0-255) and for the end of the input (slot 256),
+// the indices of the alternatives of a choice that are viable there, in
+// their original order
+class dispatch_table_t {
+    std::uint32_t offsets[258];
+    std::vector<std::uint32_t> alternatives;
+
+public:
+    dispatch_table_t(const std::vector<first_set_t>& alternative_sets);
+
+    const std::uint32_t* begin(std::size_t slot) const
+    {
+        return alternatives.data() + offsets[slot];
+    }
+
+    const std::uint32_t* end(std::size_t slot) const
+    {
+        return alternatives.data() + offsets[slot + 1];
+    }
+};
+
+// Runs first_set_analysis_t over root and builds the dispatch tables
+void build_dispatch_tables(const parser_t *root);
+
+
+// -----
+} // namespace wi
+#endif // _WI_FIRST_SET_HPP_
@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_GRAMMAR_HPP_
+#define _WI_GRAMMAR_HPP_ "1.0.2b"
+
+#include "parser.hpp"
+
+#include <type_traits>
+#include <functional>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <memory>
+#include <string>
+#include <vector>
+#include <new>
+#include <any>
+
+
+namespace wi {
+// -----
+
+
+// Owns the nodes of a grammar. The nodes are allocated next to each other in
+// large blocks and every pointer handed out by make() is a non-owning handle,
+// valid until the grammar is cleared or destroyed, which tears down every
+// node at once (in reverse order of creation).
+//
+//   grammar_t g;
+//   lazy_parser_t *p_lazy = g.make<lazy_parser_t>();
+//   parser_t *p_value = g.make<choice_of_parser_t>({
+//       g.make<digits_parser_t>(), p_lazy
+//   });
+//
+// Any type can be made, typed_parser_t nodes included, as long as it needs
+// no more than __STDCPP_DEFAULT_NEW_ALIGNMENT__. Building a grammar is
+// not thread-safe, running a built one is.
+class grammar_t {
+public:
+    grammar_t(std::size_t _block_size = 16 * 1024);
+    grammar_t(grammar_t&& other);
+    grammar_t& operator=(grammar_t&& other);
+    ~grammar_t();
+
+    grammar_t(const grammar_t&) = delete;
+    grammar_t& operator=(const grammar_t&) = delete;
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args)
+    {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "grammar_t::make(): over-aligned node types are not supported");
+        void *p = allocate(sizeof(T), alignof(T));
+        T *node = new (p) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            destructors.push_back({node, [](void *x) { static_cast<T*>(x)->~T(); }});
+        ++node_count;
+        return node;
+    }
+
+    // Shorthands for the nodes built from a list, e.g.
+    // g.make<sequence_of_parser_t>({p_left, p_right})
+    template<typename T>
+    T* make(std::initializer_list<const parser_t*> parsers)
+    {
+        return make<T>(std::vector<const parser_t*>(parsers));
+    }
+
+    template<typename T>
+    T* make(std::initializer_list<std::string> words)
+    {
+        return make<T>(std::vector<std::string>(words));
+    }
+
+    // Grammar-owned counterparts of parser_t::map() and parser_t::chain()
+    parser_t* map(const parser_t *parser, std::function<std::any(std::any)> f);
+    parser_t* chain(const parser_t *parser, std::function<parser_t*(std::any)> f);
+
+    // Destroys every node; all the handles become dangling
+    grammar_t& clear();
+
+    std::size_t get_node_count() const;
+    std::size_t get_bytes_used() const;
+    std::size_t get_bytes_reserved() const;
+
+private:
+    struct block_t {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size;
+        std::size_t used;
+    };
+
+    struct destructor_t {
+        void *node;
+        void (*destroy)(void*);
+    };
+
+    std::size_t block_size;
+    std::vector<block_t> blocks;
+    std::vector<destructor_t> destructors;
+    std::size_t node_count;
+    std::size_t bytes_used;
+
+    void* allocate(std::size_t size, std::size_t align);
+};
+
+
+// -----
+
+
+// Calls f once for every node reachable from root (through get_children()),
+// parents before their children; shared and recursive nodes are visited once
+void visit_grammar(const parser_t *root, const std::function<void(const parser_t*)>& f);
+
+// One line per reachable node, numbered in visiting order, e.g.
+//   #0 choice_of_parser_t -> #1 #2
+//   #1 digits_parser_t: one or more characters of [0-9]
+std::string dump_grammar(const parser_t *root);
+
+
+// -----
+} // namespace wi
+#endif // _WI_GRAMMAR_HPP_
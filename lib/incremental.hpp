@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _WI_INCREMENTAL_HPP_
+#define _WI_INCREMENTAL_HPP_ "1.0.2b"
+
+#include "parser.hpp"
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <memory>
+#include <string>
+#include <any>
+
+
+namespace wi {
+// -----
+
+
+// The bytes input[offset, offset + removed) are replaced by inserted
+struct text_edit_t {
+    std::size_t offset;
+    std::size_t removed;
+    std::string inserted;
+};
+
+// What the last edit (or the first parse) cost
+struct incremental_stats_t {
+    // The elements kept from the previous parse, and the ones parsed again
+    std::size_t elements_reused = 0;
+    std::size_t elements_parsed = 0;
+    // The bytes of the text read to parse them
+    std::size_t bytes_read = 0;
+};
+
+// A many_parser_t, many1_parser_t or separated_by_parser_t kept up to date
+// as its input is edited, e.g. the entries of a document open in an editor:
+//
+//   incremental_parser_t parser(p_config, text);
+//   parser.edit({offset, 1, "x"});   // one key typed
+//   parser.get_element(i);           // an entry of the edited text
+//
+// The text is kept in pieces, and the elements of the list in order, each
+// with its length (its separator and value) and how far its attempts looked
+// into the text, in two balanced trees. A position is thus the sum of the
+// lengths before it, and an edit moves every element after it without
+// touching them. The elements that looked at the bytes an edit replaced are
+// parsed again, from the text around the edit, until an element ends where
+// one of the previous parse began after the edit; that one and the rest
+// are kept as they are. An edit thus costs the elements it reached and a
+// logarithm of the document, not the document.
+//
+// As in parse_stream(), the elements are parsed one at a time, each with a
+// fresh context. The reused results are kept (not copied), so span_results
+// is turned off and event mode is not supported; custom leaves must report
+// how far they look with note_lookahead(). If the elements read the
+// incoming result (see parse_context_t::is_memoizable()), everything after
+// an edit is parsed again. The parser must outlive this.
+class incremental_parser_t {
+public:
+    incremental_parser_t(const parser_t *_list_parser, std::string _text, parse_options_t _options = parse_options_t());
+    ~incremental_parser_t();
+
+    incremental_parser_t(const incremental_parser_t&) = delete;
+    incremental_parser_t& operator=(const incremental_parser_t&) = delete;
+
+    // Applies the edit to the text and parses again the elements it reached
+    void edit(const text_edit_t& text_edit);
+
+    // The elements of the list, parsed from the current text
+    std::size_t get_element_count() const;
+    const std::any& get_element(std::size_t i) const;
+    // The state run() would return for the current text. It holds a copy of
+    // the whole text and of every element, so it is built on demand, once
+    // per edit, and costs as much as the document.
+    const parser_state_t& get_state() const;
+    std::string_view get_text() const;
+    std::size_t get_text_size() const;
+    const incremental_stats_t& get_stats() const;
+
+private:
+    struct text_node_t;
+    struct element_node_t;
+    // How the list ended after its last element: the bytes it still took (a
+    // trailing separator), how far the attempts looked, and the error of the
+    // one that went past max_depth, if any; all from the end of the element
+    struct tail_t {
+        std::size_t length;
+        std::size_t extent;
+        parse_error_t error;
+    };
+
+    const parser_t *list_parser;
+    const parser_t *value_parser;
+    const parser_t *separator_parser;
+    bool at_least_one;
+    // Whether the elements read the incoming result, and thus depend on the
+    // ones before them
+    bool forwards;
+    parse_options_t options;
+    std::uint32_t seed;
+    std::unique_ptr<text_node_t> text;
+    std::unique_ptr<element_node_t> elements;
+    tail_t tail;
+    incremental_stats_t stats;
+    mutable std::shared_ptr<const std::string> text_copy;
+    mutable std::optional<parser_state_t> parser_state;
+
+    // Parses the elements again from the first one that looked past offset,
+    // text[offset, offset + inserted) having replaced removed bytes; the
+    // whole list if reparse_all is set
+    void update(std::size_t offset, std::size_t removed, std::size_t inserted, bool reparse_all);
+};
+
+
+// -----
+} // namespace wi
+#endif // _WI_INCREMENTAL_HPP_
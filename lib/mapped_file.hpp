@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_MAPPED_FILE_HPP_
+#define _WI_MAPPED_FILE_HPP_ "1.0.2b"
+
+#include "parser.hpp"
+
+#include <string_view>
+#include <cstddef>
+#include <string>
+
+
+namespace wi {
+// -----
+
+
+// A whole file mapped read-only into memory, unmapped when destroyed. The
+// pages are read from the disk as the parse reaches them, and the kernel is
+// told they will be read in order (MADV_SEQUENTIAL), so it reads ahead and
+// can drop the pages already parsed.
+class mapped_file_t {
+    const char *data;
+    std::size_t size;
+
+public:
+    // Throws a std::string if the file cannot be opened or mapped
+    mapped_file_t(const std::string& path);
+    ~mapped_file_t();
+
+    mapped_file_t(const mapped_file_t&) = delete;
+    mapped_file_t& operator=(const mapped_file_t&) = delete;
+
+    std::string_view get_view() const;
+};
+
+// Runs a parser over a whole file, mapped instead of read into a string:
+// there is no copy, and no more memory than the pages the parse touches.
+// The states of the parse own the mapping, and so does every span into it
+// (parse_options_t::spans_keep_input is set), so that the result can be
+// moved out of the final state and outlive it. The size of the file, the
+// page faults and the time taken are reported by get_stats().
+parser_state_t parse_file(const parser_t* parser, const std::string& path, parse_options_t options = parse_options_t());
+
+
+// -----
+} // namespace wi
+#endif // _WI_MAPPED_FILE_HPP_
@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_OPTIMIZER_HPP_
+#define _WI_OPTIMIZER_HPP_ "1.0.2b"
+
+#include "grammar.hpp"
+#include "parser.hpp"
+
+#include <unordered_set>
+#include <cstddef>
+#include <utility>
+#include <map>
+#include <set>
+
+
+namespace wi {
+// -----
+
+
+struct optimize_options_t {
+    // Run build_dispatch_tables() over the optimized grammar
+    bool dispatch_tables = true;
+};
+
+struct optimize_stats_t {
+    std::size_t nodes_before = 0;
+    std::size_t nodes_after = 0;
+    std::size_t flattened_choices = 0;
+    std::size_t flattened_sequences = 0;
+    std::size_t merged_strings = 0;
+    std::size_t string_tries = 0;
+    std::size_t char_scanners = 0;
+    std::size_t removed_nodes = 0;
+    std::size_t inlined_lazies = 0;
+};
+
+// Rewrites a grammar into a faster one with identical results, by copying
+// the nodes reachable from a root into a grammar_t:
+// - nested choices are flattened, and runs of string_parser_t alternatives
+//   become a single choice_of_string_parser_t (a trie)
+// - maps that were given no function and flattens whose result is dropped
+//   are removed
+// - lazy_parser_t nodes that are not part of a cycle are inlined
+// - where a result is dropped (the left and right of between_parser_t, the
+//   separator of separated_by_parser_t, and everything below them), nested
+//   sequences are flattened, adjacent string literals merged and many(char)
+//   turned into a maybe_chars_parser_t (many1 into a chars_parser_t)
+//
+// Any node that forwards its incoming result (do_nothing_parser_t, maps and
+// chains built without a parser) lets later nodes observe the shape of a
+// dropped result, so the last group is skipped for grammars containing one.
+// Nodes marked with set_memoize() or set_label() are kept, with their flag
+// and label.
+//
+// Leaves and node types the optimizer does not know are shared with the
+// original grammar, which must thus outlive the optimized one.
+//
+//   grammar_t optimized;
+//   const parser_t *p_fast = optimize_grammar(p_root, optimized);
+class grammar_optimizer_t {
+public:
+    grammar_optimizer_t(grammar_t& _g, optimize_options_t _options = optimize_options_t());
+
+    const parser_t* optimize(const parser_t *root);
+    const optimize_stats_t& get_stats() const;
+
+private:
+    grammar_t& g;
+    optimize_options_t options;
+    optimize_stats_t stats;
+
+    // Whether results are only ever read by the parents, in which case the
+    // dropped ones may change shape
+    bool shape_free;
+    std::unordered_set<const parser_t*> recursive_lazies;
+    // Keyed by (node, whether its result is dropped)
+    std::map<std::pair<const parser_t*, bool>, const parser_t*> done;
+    std::set<std::pair<const parser_t*, bool>> in_progress;
+    // Copies of lazies whose target was still being rewritten
+    std::map<std::pair<const parser_t*, bool>, std::vector<lazy_parser_t*>> pending_lazies;
+
+    const parser_t* rewrite(const parser_t *parser, bool dropped);
+    const parser_t* rewrite_node(const parser_t *parser, bool dropped);
+    const parser_t* rewrite_sequence(const sequence_of_parser_t *sequence, bool dropped);
+    const parser_t* rewrite_choice(const choice_of_parser_t *choice, bool dropped);
+    const parser_t* rewrite_many(const many_parser_t *many, bool at_least_one, bool dropped);
+    template<typename T, typename... Args>
+    T* make(const parser_t *original, Args&&... args);
+};
+
+const parser_t* optimize_grammar(const parser_t *root, grammar_t& g, optimize_options_t options = optimize_options_t());
+
+
+// -----
+} // namespace wi
+#endif // _WI_OPTIMIZER_HPP_
@@ -25,7 +25,13 @@
 
 
 namespace wi {
+class parse_error_t;
 class parser_state_t;
+enum class parse_event_kind_t;
+struct parse_event_t;
+struct parse_options_t;
+struct parse_stats_t;
+class parse_context_t;
 class parser_t;
 class do_nothing_parser_t;
 class lazy_parser_t;
@@ -55,12 +61,21 @@ class maybe_whitespaces_parser_t;
 // -----
 
 
+#include "class_scanner.hpp"
+#include "string_trie.hpp"
+#include "char_class.hpp"
 #include "utilities.hpp"
+#include "arena.hpp"
+#include "profile.hpp"
+#include "first_set.hpp"
 
+#include <string_view>
 #include <functional>
 #include <optional>
 #include <cstdint>
 #include <sstream>
+#include <unordered_map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <regex>
@@ -71,36 +86,108 @@ namespace wi {
 // -----
 
 
+// A failure, recorded as the node that failed, the index it failed at and a
+// node-specific reason code; recording one costs no allocation. The message
+// is only built when asked for, by the failing node's describe_error().
+// Errors set from a string (set_error()) carry that string instead.
+//
+// The error points to its node, so it can only be formatted (to_string(),
+// parser_state_t::get_error()) while the node is alive: a state or an error
+// kept after its grammar_t is destroyed, or after the node a chain() function
+// created is gone, must be formatted before that. Keep the string if the
+// message has to outlive the grammar.
+class parse_error_t {
+public:
+    const parser_t *parser;
+    std::size_t index;
+    std::uint32_t code;
+    std::shared_ptr<const std::string> message;
+
+    parse_error_t();
+    parse_error_t(const parser_t *_parser, std::size_t _index, std::uint32_t _code = 0);
+    parse_error_t(std::string _message, std::size_t _index);
+
+    bool has_value() const;
+    void reset();
+
+    // target_string is the input the error refers to
+    std::string to_string(std::string_view target_string) const;
+};
+
+
+// -----
+
+
 class parser_state_t {
 public:
-    std::string target_string;
+    // The input is shared by every state of a parse: `input` keeps the buffer
+    // alive, while `target_string` is a view over it. Copying a state is thus
+    // cheap, no matter how large the input is.
+    std::shared_ptr<const void> input;
+    std::string_view target_string;
+    // Per-parse data (options, memo table, statistics). May be null, in which
+    // case the parse runs without any of the optional features. It is
+    // declared before the result, which may live in its arena, so that it
+    // is destroyed after it.
+    std::shared_ptr<parse_context_t> context;
     std::any result;
     std::size_t index;
-    std::optional<std::string> error;
+    parse_error_t error;
 
     parser_state_t();
     parser_state_t(std::string _target_string);
+    parser_state_t(std::shared_ptr<const std::string> _input);
+    parser_state_t(const parser_state_t&) = default;
+    parser_state_t(parser_state_t&&) = default;
+    parser_state_t& operator=(const parser_state_t&) = default;
+    parser_state_t& operator=(parser_state_t&&) = default;
+    // Releases the result through release_any(), as it may be nested
+    // arbitrarily deep
+    ~parser_state_t();
 
     // Setters
     parser_state_t& set_target_string(std::string _target_string);
+    parser_state_t& set_input(std::shared_ptr<const std::string> _input);
     parser_state_t& set_result(std::any _result);
     parser_state_t& set_index(std::size_t _index);
     parser_state_t& set_error(std::string _error);
     parser_state_t& unset_error();
+    // Records a failure of parser at the current index, without building any
+    // message, and reports it to the context (furthest failure tracking)
+    parser_state_t& fail(const parser_t *parser, std::uint32_t code = 0);
+    parser_state_t& set_context(std::shared_ptr<parse_context_t> _context);
 
     // Getters
     std::string get_target_string() const;
+    std::string_view get_target_view() const;
     std::any get_result() const;
     std::size_t get_index() const;
+    // Formats the error; if the parse got further than this error before
+    // failing, the furthest failure is described as well. The nodes that
+    // failed must still be alive (see parse_error_t).
     std::optional<std::string> get_error() const;
+    std::shared_ptr<parse_context_t> get_context() const;
 
-    parser_state_t map_result(std::function<std::any(std::any)> f) const;
+    // The rvalue overloads hand the result over instead of copying it
+    parser_state_t map_result(std::function<std::any(std::any)> f) const &;
+    parser_state_t map_result(std::function<std::any(std::any)> f) &&;
     parser_state_t map_nested_result(std::function<std::any(std::string)> f) const;
     parser_state_t map_error(std::function<std::string(std::string)> f) const;
 
     parser_state_t chain(std::function<parser_t*(std::any)> f) const;
 
-    parser_state_t flatten_result() const;
+    // The result of a leaf parser matching target_string[begin, end): either
+    // a span_t or a std::string, depending on the parse options
+    std::any slice(std::size_t begin, std::size_t end) const;
+    bool wants_spans() const;
+    // Leaf parsers call this with one past the last byte they read, or would
+    // have read, had the input been longer (see parse_context_t::lookahead)
+    void note_lookahead(std::size_t end) const;
+    // Reports an event for target_string[begin, end), in event mode
+    void note_event(parse_event_kind_t kind, const parser_t *parser, std::size_t begin, std::size_t end) const;
+
+    parser_state_t flatten_result() const &;
+    parser_state_t flatten_result() &&;
 
     std::string to_string() const;
 };
@@ -109,15 +196,227 @@ public:
 // -----
 
 
+// What the nodes report in event mode (parse_options_t::on_event), in the
+// shape of the result they would have built: a sequence or a list is a
+// begin, its elements (for lists, each followed by an item) and an end, a
+// leaf is a leaf. The events of the parts whose result is dropped (the left
+// and right of between_parser_t, the separators of separated_by_parser_t)
+// are left out.
+enum class parse_event_kind_t {
+    begin,  // a sequence or list starts at begin
+    end,    // it matched [begin, end)
+    item,   // an element of a list matched [begin, end)
+    leaf    // a leaf matched [begin, end)
+};
+
+struct parse_event_t {
+    parse_event_kind_t kind;
+    const parser_t *parser;
+    std::size_t begin;
+    std::size_t end;
+    // target_string[begin, end), valid for as long as the input is
+    std::string_view text;
+};
+
+
+// -----
+
+
+struct parse_options_t {
+    // Memoize every parser node, not only the ones marked with set_memoize()
+    bool memoize = false;
+    // Leaf parsers return span_t slices of the input instead of std::string
+    // copies; use smart_string_any_cast() to materialize them when needed
+    bool span_results = false;
+    // Spans hold a reference to the input of the state they were sliced
+    // from, so that they keep it alive on their own (parse_file() sets it)
+    bool spans_keep_input = false;
+    // Result lists of sequence_of / many / separated_by are allocated in a
+    // per-parse arena, as std::pmr::vector<std::any>; read them through
+    // any_vector_view(). They are released together with the context, so
+    // copy (do not move) a result out if it should outlive the final state.
+    bool use_arena = false;
+    std::size_t arena_block_size = 64 * 1024;
+    // How deeply the lazy_parser_t rules may nest while a grammar is run, 0
+    // (the default) meaning no limit. Every level recurses on the machine
+    // stack, so a limit makes a deeper input fail the whole parse with an
+    // error instead of overflowing it (no alternative is tried past it).
+    std::size_t max_depth = 0;
+    // The same limit for the subroutine calls of a vm_program_t, whose
+    // stack lives on the heap
+    std::size_t max_vm_depth = 1000000;
+    // Event mode: the nodes report what they match to on_event, as soon as
+    // no backtracking can take it back, instead of building result lists.
+    // Leaves return span_t slices and lists are left empty, so results (and
+    // thus map() and chain() functions) are not meaningful; memoization is
+    // turned off.
+    std::function<void(const parse_event_t&)> on_event;
+};
+
+struct parse_stats_t {
+    std::size_t memo_hits = 0;
+    std::size_t memo_misses = 0;
+    // The buffers allocated by the result lists as they were built, and
+    // their size, counted the same way whether they came from the arena or
+    // from the heap
+    std::size_t result_allocations = 0;
+    std::size_t result_bytes_allocated = 0;
+    // Only filled in when parse_options_t::use_arena is set
+    std::size_t arena_allocations = 0;
+    std::size_t arena_bytes_allocated = 0;
+    std::size_t arena_blocks = 0;
+    std::size_t arena_bytes_reserved = 0;
+    // Only filled in by parse_file(): the size of the file, the page faults
+    // taken while parsing it (major ones had to read from the disk) and the
+    // wall-clock time of the parse
+    std::size_t input_bytes = 0;
+    std::size_t minor_page_faults = 0;
+    std::size_t major_page_faults = 0;
+    double seconds = 0;
+
+    // In MB/s, 0 if no time was measured
+    double get_throughput() const;
+};
+
+// The failures at the largest index reached during a parse; expected lists
+// the (distinct) nodes that failed there, which must be alive for
+// to_string(), as for parse_error_t
+struct furthest_failure_t {
+    std::size_t index = 0;
+    std::vector<const parser_t*> expected;
+
+    bool has_value() const;
+    // E.g. "expected \"x\" or a character of [0-9] at index 12 (\"abc\")",
+    // mentioning only the nodes that can describe what they expected
+    std::string to_string(std::string_view target_string) const;
+};
+
+class parse_context_t {
+public:
+    parse_options_t options;
+    parse_stats_t stats;
+    // The lazy_parser_t rules entered and not yet left, and the error of
+    // the first one that would have gone deeper than options.max_depth;
+    // once it is set, every node fails with it (see parser_t::apply())
+    std::size_t depth;
+    parse_error_t depth_error;
+    // How far the leaf parsers looked into the input: one past the last byte
+    // they read or wanted to read, which may be past its end. A streamed
+    // parse needs more input whenever it is, and an incremental one parses
+    // an element again when an edit reaches that far.
+    std::size_t lookahead;
+    // Filled in only when built with _WI_PROFILE_ (see parse_profile_t)
+    parse_profile_t profile;
+
+    parse_context_t();
+    parse_context_t(parse_options_t _options);
+
+    const parse_options_t& get_options() const;
+    parse_stats_t get_stats() const;
+    const parse_profile_t& get_profile() const;
+
+    // The arena backing result lists, or nullptr if use_arena is not set
+    parse_arena_t* get_arena() const;
+
+    void note_failure(const parser_t* parser, std::size_t index);
+    const furthest_failure_t& get_furthest_failure() const;
+
+    // Packrat memo table, keyed by (parser node, input index)
+    std::optional<parser_state_t> memo_find(const parser_t* parser, std::size_t index);
+    void memo_store(const parser_t* parser, std::size_t index, parser_state_t parser_state);
+    std::size_t memo_size() const;
+    void clear_memo();
+
+    // A node may only be memoized if its outcome depends on the input index
+    // alone, i.e. if no node reachable from it forwards the incoming result.
+    bool is_memoizable(const parser_t* parser);
+
+    // Event mode. The events are delivered at once when no backtrack point
+    // is live; otherwise they are held until the outermost one is left, and
+    // dropped if the attempt they belong to failed.
+    bool in_event_mode() const;
+    void emit_event(const parse_event_t& event);
+    // A backtrack point (a choice alternative, a repetition) is entered
+    // with begin_attempt(), which returns the mark to pass to end_attempt()
+    std::size_t begin_attempt();
+    void end_attempt(std::size_t mark, bool matched);
+    // The events of the parts whose result is dropped are muted
+    void mute_events();
+    void unmute_events();
+
+private:
+    // Declared before the memo table, whose results may live in it
+    std::unique_ptr<parse_arena_t> arena;
+    furthest_failure_t furthest_failure;
+
+    struct memo_key_hash_t {
+        std::size_t operator()(const std::pair<const parser_t*, std::size_t>& key) const;
+    };
+
+    std::unordered_map<std::pair<const parser_t*, std::size_t>, parser_state_t, memo_key_hash_t> memo;
+    std::unordered_map<const parser_t*, bool> memoizable;
+
+    bool event_mode;
+    std::vector<parse_event_t> events;
+    std::size_t attempts;
+    std::size_t muted;
+};
+
+
+// -----
+
+
 class parser_t {
+    bool memoize;
+    std::string label;
+
+    // apply(), once the node is profiled
+    parser_state_t apply_in_context(parser_state_t parser_state) const;
+
 public:
+    parser_t();
+    virtual ~parser_t() = default;
+
     virtual parser_state_t run(parser_state_t parser_state) const;
 
+    // Runs the parser through the per-parse context (memoization etc.).
+    // Combinators use this to run their children.
+    parser_state_t apply(parser_state_t parser_state) const;
+
     parser_t* map(std::function<std::any(std::any)> f) const;
     parser_t* chain(std::function<parser_t*(std::any)> f) const;
+
+    parser_t& set_memoize(bool _memoize);
+    bool get_memoize() const;
+    // A name for the node in profiles (see parse_profile_t), e.g. the rule
+    // it implements
+    parser_t& set_label(std::string _label);
+    const std::string& get_label() const;
+
+    // Introspection
+    virtual std::string get_name() const;
+    virtual std::vector<const parser_t*> get_children() const;
+    virtual bool forwards_result() const;
+
+    // Error reporting: the message for an error recorded by this node with
+    // fail(), and a short description of what the node matches ("\"abc\"",
+    // "a character of [0-9]"), empty for nodes that only combine others
+    virtual std::string describe_error(const parse_error_t& error, std::string_view target_string) const;
+    virtual std::string describe_expected() const;
+
+    // The node's rule for first_set_analysis_t, in terms of the (current)
+    // sets of its children; the default, any(), is always correct
+    virtual first_set_t first_set(const first_set_analysis_t& analysis) const;
 };
 
 
+// Runs a parser over the whole input, using a fresh parse context
+parser_state_t parse(const parser_t* parser, std::string target_string, parse_options_t options = parse_options_t());
+parser_state_t parse(const parser_t* parser, std::shared_ptr<const std::string> input, parse_options_t options = parse_options_t());
+// Same, from a state that already holds the input (see parse_file())
+parser_state_t parse(const parser_t* parser, parser_state_t parser_state, parse_options_t options = parse_options_t());
+
+
 // -----
 
 
@@ -125,6 +424,9 @@ class do_nothing_parser_t : public parser_t {
 public:
     do_nothing_parser_t();
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    bool forwards_result() const;
 };
 
 
@@ -138,8 +440,13 @@ public:
     lazy_parser_t();
     lazy_parser_t(const parser_t *_parser);
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
 
     lazy_parser_t& set_parser(const parser_t *_parser);
+    const parser_t* get_parser() const;
 };
 
 
@@ -149,6 +456,7 @@ public:
 class map_parser_t : public parser_t {
     const parser_t *parser;
     std::function<std::any(std::any)> f;
+    bool identity;
 
 public:
     map_parser_t();
@@ -157,9 +465,16 @@ public:
     map_parser_t(const parser_t *_parser, std::function<std::any(std::any)> _f);
 
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
 
     map_parser_t& set_parser(const parser_t *_parser);
     map_parser_t& set_f(std::function<std::any(std::any)> _f);
+    const parser_t* get_parser() const;
+    const std::function<std::any(std::any)>& get_f() const;
+    // True while no function was given, i.e. f returns its argument
+    bool is_identity() const;
 };
 
 
@@ -177,9 +492,14 @@ public:
     chain_parser_t(const parser_t *_parser, std::function<parser_t*(std::any)> f);
 
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
 
     chain_parser_t& set_parser(const parser_t *_parser);
     chain_parser_t& set_f(std::function<parser_t*(std::any)> _f);
+    const parser_t* get_parser() const;
+    const std::function<parser_t*(std::any)>& get_f() const;
 };
 
 
@@ -194,8 +514,12 @@ public:
     flatten_parser_t(const parser_t *_parser);
 
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
 
     flatten_parser_t& set_parser(const parser_t *_parser);
+    const parser_t* get_parser() const;
 };
 
 
@@ -210,10 +534,14 @@ public:
     sequence_of_parser_t(std::vector<const parser_t*> _parsers);
 
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
 
     sequence_of_parser_t& set_parsers(std::vector<const parser_t*> _parsers);
     sequence_of_parser_t& add_parser(const parser_t* parser);
     sequence_of_parser_t& clear();
+    const std::vector<const parser_t*>& get_parsers() const;
 };
 
 
@@ -222,16 +550,29 @@ public:
 
 class choice_of_parser_t : public parser_t {
     std::vector<const parser_t*> parsers;
+    // Derived from the alternatives, which it only speeds up, so it may be
+    // installed on a node held as const
+    mutable std::shared_ptr<const dispatch_table_t> dispatch_table;
 
 public:
     choice_of_parser_t();
     choice_of_parser_t(std::vector<const parser_t*> _parsers);
 
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const;
 
     choice_of_parser_t& set_parsers(std::vector<const parser_t*> _parsers);
     choice_of_parser_t& add_parser(const parser_t* parser);
     choice_of_parser_t& clear();
+    const std::vector<const parser_t*>& get_parsers() const;
+
+    // Installed by first_set_analysis_t::build_dispatch_tables(); dropped
+    // whenever the alternatives change
+    const choice_of_parser_t& set_dispatch_table(std::shared_ptr<const dispatch_table_t> _dispatch_table) const;
+    std::shared_ptr<const dispatch_table_t> get_dispatch_table() const;
 };
 
 
@@ -246,8 +587,16 @@ public:
     many_parser_t(const parser_t* parser);
 
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
 
     many_parser_t& set_parser(const parser_t* _parser);
+    const parser_t* get_parser() const;
+
+protected:
+    // run(), also counting the matches (the list is left empty in event mode)
+    parser_state_t run_counted(parser_state_t parser_state, std::size_t& count) const;
 };
 
 
@@ -260,6 +609,9 @@ public:
     many1_parser_t(const parser_t* parser);
 
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const;
 
     many1_parser_t& set_parser(const parser_t* _parser);
 };
@@ -269,19 +621,25 @@ public:
 
 
 class between_parser_t : public parser_t {
-    parser_t *left_parser, *right_parser, *content_parser;
+    const parser_t *left_parser, *right_parser, *content_parser;
 
 public:
     between_parser_t();
-    between_parser_t(parser_t* content_parser);
-    between_parser_t(parser_t* _left_parser, parser_t* _right_parser);
-    between_parser_t(parser_t* _left_parser, parser_t* _right_parser, parser_t* content_parser);
+    between_parser_t(const parser_t* content_parser);
+    between_parser_t(const parser_t* _left_parser, const parser_t* _right_parser);
+    between_parser_t(const parser_t* _left_parser, const parser_t* _right_parser, const parser_t* content_parser);
 
     parser_state_t run(parser_state_t parser_state) const;
-
-    between_parser_t& set_left_parser(parser_t* _left_parser);
-    between_parser_t& set_right_parser(parser_t* _right_parser);
-    between_parser_t& set_content_parser(parser_t* _content_parser);
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
+
+    between_parser_t& set_left_parser(const parser_t* _left_parser);
+    between_parser_t& set_right_parser(const parser_t* _right_parser);
+    between_parser_t& set_content_parser(const parser_t* _content_parser);
+    const parser_t* get_left_parser() const;
+    const parser_t* get_right_parser() const;
+    const parser_t* get_content_parser() const;
 };
 
 
@@ -289,17 +647,23 @@ public:
 
 
 class separated_by_parser_t : public parser_t {
-    parser_t *seaparator_parser, *value_parser;
+    const parser_t *seaparator_parser, *value_parser;
 
 public:
     separated_by_parser_t();
-    separated_by_parser_t(parser_t* _seaparator_parser);
-    separated_by_parser_t(parser_t* _seaparator_parser, parser_t* _value_parser);
+    separated_by_parser_t(const parser_t* _seaparator_parser);
+    separated_by_parser_t(const parser_t* _seaparator_parser, const parser_t* _value_parser);
 
     parser_state_t run(parser_state_t parser_state) const;
-
-    separated_by_parser_t& set_seaparator_parser(parser_t* _seaparator_parser);
-    separated_by_parser_t& set_value_parser(parser_t* _value_parser);
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const;
+
+    separated_by_parser_t& set_seaparator_parser(const parser_t* _seaparator_parser);
+    separated_by_parser_t& set_value_parser(const parser_t* _value_parser);
+    const parser_t* get_seaparator_parser() const;
+    const parser_t* get_value_parser() const;
 };
 
 
@@ -313,8 +677,13 @@ public:
     string_parser_t();
     string_parser_t(std::string _s);
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const;
+    std::string describe_expected() const;
 
     string_parser_t& set_string(std::string _s);
+    const std::string& get_string() const;
 };
 
 
@@ -322,17 +691,36 @@ public:
 
 
 class choice_of_string_parser_t : public parser_t {
+public:
+    enum class match_mode_t {
+        first_listed,  // the first word in the list that matches
+        longest        // the longest word that matches
+    };
+
+private:
     std::vector<std::string> words;
+    string_trie_t trie;
+    match_mode_t match_mode;
 
 public:
     choice_of_string_parser_t();
     choice_of_string_parser_t(std::vector<std::string> _words);
+    choice_of_string_parser_t(std::vector<std::string> _words, match_mode_t _match_mode);
 
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const;
+    std::string describe_expected() const;
 
     choice_of_string_parser_t& set_words(std::vector<std::string> _words);
     choice_of_string_parser_t& add_word(std::string _word);
     choice_of_string_parser_t& clear();
+    choice_of_string_parser_t& set_match_mode(match_mode_t _match_mode);
+
+    const std::vector<std::string>& get_words() const;
+    const string_trie_t& get_trie() const;
+    match_mode_t get_match_mode() const;
 };
 
 
@@ -340,26 +728,36 @@ public:
 
 
 class char_parser_t : public parser_t {
-    std::regex rexp;
+    char_class_t char_class;
 
 public:
-    char_parser_t(std::regex rexp);
+    char_parser_t(std::regex _rexp);
+    char_parser_t(char_class_t _char_class);
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const;
+    std::string describe_expected() const;
+
+    const char_class_t& get_char_class() const;
 };
 
 class letter_parser_t : public char_parser_t {
 public:
     letter_parser_t();
+    std::string get_name() const;
 };
 
 class digit_parser_t : public char_parser_t {
 public:
     digit_parser_t();
+    std::string get_name() const;
 };
 
 class whitespace_parser_t : public char_parser_t {
 public:
     whitespace_parser_t();
+    std::string get_name() const;
 };
 
 
@@ -367,26 +765,36 @@ public:
 
 
 class chars_parser_t : public parser_t {
-    char_parser_t char_parser;
+    class_scanner_t scanner;
 
 public:
     chars_parser_t(std::regex _rexp);
+    chars_parser_t(char_class_t _char_class);
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const;
+    std::string describe_expected() const;
+
+    const char_class_t& get_char_class() const;
 };
 
 class letters_parser_t : public chars_parser_t {
 public:
     letters_parser_t();
+    std::string get_name() const;
 };
 
 class digits_parser_t : public chars_parser_t {
 public:
     digits_parser_t();
+    std::string get_name() const;
 };
 
 class whitespaces_parser_t : public chars_parser_t {
 public:
     whitespaces_parser_t();
+    std::string get_name() const;
 };
 
 
@@ -394,26 +802,34 @@ public:
 
 
 class maybe_chars_parser_t : public parser_t {
-    char_parser_t char_parser;
+    class_scanner_t scanner;
 
 public:
     maybe_chars_parser_t(std::regex _rexp);
+    maybe_chars_parser_t(char_class_t _char_class);
     parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+
+    const char_class_t& get_char_class() const;
 };
 
 class maybe_letters_parser_t : public maybe_chars_parser_t {
 public:
     maybe_letters_parser_t();
+    std::string get_name() const;
 };
 
 class maybe_digits_parser_t : public maybe_chars_parser_t {
 public:
     maybe_digits_parser_t();
+    std::string get_name() const;
 };
 
 class maybe_whitespaces_parser_t : public maybe_chars_parser_t {
 public:
     maybe_whitespaces_parser_t();
+    std::string get_name() const;
 };
 
 
@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_PROFILE_HPP_
+#define _WI_PROFILE_HPP_ "1.0.2b"
+
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+
+
+namespace wi {
+class parser_t;
+// -----
+
+
+// What a node of the grammar did during a parse
+struct node_profile_t {
+    const parser_t *parser = nullptr;
+    std::size_t calls = 0;
+    std::size_t successes = 0;
+    std::size_t failures = 0;
+    // Matched by the successful calls
+    std::size_t bytes_consumed = 0;
+    // Matched by the failed calls before they failed, i.e. read for nothing
+    // by the alternative or repetition that tried them
+    std::size_t bytes_backtracked = 0;
+    // With and without the time of the nodes it ran. The bytes and the
+    // inclusive time of a node running inside itself (through a
+    // lazy_parser_t) are only counted for the outermost call.
+    std::uint64_t inclusive_ns = 0;
+    std::uint64_t exclusive_ns = 0;
+
+    // The type of the node, and its label if it has one, e.g.
+    // "choice_of_parser_t[value]"
+    std::string get_name() const;
+};
+
+// Per-node counters and timings of a parse, kept by its parse_context_t.
+// Recording is compiled in with _WI_PROFILE_ only (make clean && make
+// PROFILE=1, as every object must be rebuilt with it); otherwise the profile
+// stays empty and the parse pays nothing for it. Every node run through
+// parser_t::apply() is counted, memo hits included; the nodes a vm_program_t
+// runs natively are not.
+//
+//   parser_state_t ps = parse(p_root, input);
+//   const parse_profile_t& profile = ps.get_context()->get_profile();
+//   std::cout << profile.to_string();              // the costliest nodes
+//   std::ofstream("parse.folded") << profile.to_folded_stacks();
+//
+// The folded stacks (one "root;child;leaf nanoseconds" line per path of
+// nodes, with the time spent in the last one) are the input of flame graph
+// tools such as flamegraph.pl.
+class parse_profile_t {
+public:
+    parse_profile_t();
+
+    // Whether the library was built with _WI_PROFILE_
+    static bool is_enabled();
+
+    // Called by parser_t::apply() around every node it runs
+    void enter(const parser_t *parser);
+    void leave(std::size_t begin, std::size_t index, bool failed, std::size_t error_index);
+
+    // Sorted by exclusive time, the costliest first
+    std::vector<node_profile_t> get_nodes() const;
+    std::string to_folded_stacks() const;
+    // A table of get_nodes()
+    std::string to_string() const;
+    bool empty() const;
+
+private:
+    using clock_t = std::chrono::steady_clock;
+
+    // A path of nodes from the root, as in a call tree
+    struct path_t {
+        std::size_t parent;
+        std::size_t node;
+        std::vector<std::pair<const parser_t*, std::size_t>> children;
+        std::uint64_t exclusive_ns;
+    };
+    struct frame_t {
+        std::size_t path;
+        clock_t::time_point start;
+        std::uint64_t children_ns;
+    };
+
+    std::vector<node_profile_t> nodes;
+    std::unordered_map<const parser_t*, std::size_t> node_indices;
+    // The nodes running at the moment, per node
+    std::vector<std::size_t> active;
+    // paths[0] is the root, which is no node
+    std::vector<path_t> paths;
+    std::vector<frame_t> stack;
+};
+
+
+// -----
+} // namespace wi
+#endif // _WI_PROFILE_HPP_
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_RESUMABLE_HPP_
+#define _WI_RESUMABLE_HPP_ "1.0.2b"
+
+#include "parser.hpp"
+#include "vm.hpp"
+
+#include <string_view>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+
+namespace wi {
+// -----
+
+
+enum class feed_status_t {
+    need_more,  // the input so far is a prefix of what the grammar may match
+    done,       // a message was parsed
+    error       // the input cannot be completed into a match anymore
+};
+
+// A parse fed with its input a piece at a time, as it arrives, e.g. from a
+// socket:
+//
+//   resumable_parser_t parser(program);
+//   while (parser.feed(read_some()) == feed_status_t::need_more)
+//       ;
+//
+// Each feed runs the compiled grammar as far as the bytes received allow
+// and stops at the first instruction whose outcome depends on the bytes not
+// there yet: the position, the backtrack points and the partial results are
+// kept (in a vm_machine_t) and the parse resumes from there on the next
+// feed, instead of running the grammar again from the start. The grammar
+// is done as soon as its outcome cannot change, or at finish(), which tells
+// that there is no more input (e.g. for a greedy run at the very end).
+//
+// The bytes past the end of a message stay buffered: next() drops the
+// message and parses the following one from them. The indices of the states
+// are counted from the start of the current message, which is at
+// get_offset() in the whole input.
+//
+// The input is buffered and grows, so span_results is turned off and
+// event mode is not supported. Nodes run natively (see vm_program_t) that
+// need more input are run again from their start after the next feed, so
+// they should be small; custom leaves must report how far they look with
+// note_lookahead(). A failed parse reports the error the grammar does, on
+// the input received so far. The program must outlive the parser.
+class resumable_parser_t {
+public:
+    resumable_parser_t(const vm_program_t& _program, parse_options_t _options = parse_options_t());
+
+    // Appends bytes to the input and parses as far as they allow; once the
+    // message is done (or failed), the bytes are only buffered for next()
+    feed_status_t feed(std::string_view bytes);
+    // There will be no more input
+    feed_status_t finish();
+    // Starts over with the input left after the message that was done
+    feed_status_t next();
+
+    feed_status_t get_status() const;
+    // The state the parse is in; the final one, once done or failed. It
+    // views the buffered input, so it is only valid until the next call.
+    const parser_state_t& get_state() const;
+    // The offset of the current message in the whole input
+    std::size_t get_offset() const;
+    // The bytes buffered, from the start of the current message
+    std::string_view get_buffer() const;
+    // How many times the parse stopped to wait for more input
+    std::size_t get_suspensions() const;
+
+private:
+    const vm_program_t& program;
+    parse_options_t options;
+    std::string buffer;
+    std::size_t offset;
+    bool finished;
+    feed_status_t status;
+    vm_machine_t machine;
+    parser_state_t parser_state;
+    std::size_t suspensions;
+
+    void start();
+    feed_status_t resume();
+};
+
+
+// -----
+} // namespace wi
+#endif // _WI_RESUMABLE_HPP_
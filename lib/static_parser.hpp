@@ -0,0 +1,654 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_STATIC_PARSER_HPP_
+#define _WI_STATIC_PARSER_HPP_ "1.0.2b"
+
+#include <cstddef>
+
+namespace wi {
+class static_char_class_t;
+template<char... Cs> class static_string_parser_t;
+class static_literal_parser_t;
+class static_char_parser_t;
+class static_chars_parser_t;
+template<typename... Ps> class static_sequence_of_parser_t;
+template<typename... Ps> class static_choice_of_parser_t;
+template<typename P, std::size_t at_least> class static_many_parser_t;
+template<typename P, typename F> class static_map_parser_t;
+template<typename L, typename P, typename R> class static_between_parser_t;
+template<typename S, typename P> class static_separated_by_parser_t;
+template<typename T> class static_ref_parser_t;
+template<typename P> class static_adapter_parser_t;
+template<typename P> class static_typed_parser_t;
+}
+
+
+// -----
+
+
+#include "typed_parser.hpp"
+#include "char_class.hpp"
+#include "grammar.hpp"
+#include "parser.hpp"
+
+#include <type_traits>
+#include <string_view>
+#include <cstdint>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <tuple>
+
+
+namespace wi {
+// -----
+
+
+// Header-only counterpart of the typed layer: every node is a plain value
+// whose type holds the whole grammar below it, so a grammar such as
+//
+//   using namespace wi::st;
+//   constexpr auto number = chars(digit);
+//   const auto pair = between(lit<'('>, lit<')'>, seq(number, lit<','>, number));
+//
+// compiles to a single inlined parse() with no virtual calls and no
+// std::function. The nodes follow typed_parser_t: they expose result_type
+// and parse(s, index, value), which either succeeds and moves index past
+// the match, or fails and leaves index untouched.
+//
+// to_parser() turns a static grammar into a parser_t (results converted as
+// typed_to_any() does), to_typed() into a typed_parser_t, and ref() embeds a
+// typed_parser_t into a static grammar. A recursive grammar goes through a
+// typed_lazy_parser_t:
+//
+//   typed_lazy_parser_t<T> lazy;
+//   const auto expr = alt(number_as_T, between(lit<'('>, lit<')'>, ref(lazy)));
+//   static_typed_parser_t<decltype(expr)> typed_expr(expr);
+//   lazy.set_parser(&typed_expr);
+
+
+// -----
+
+
+// A 256-bit set of bytes, like char_class_t, but built at compile time
+class static_char_class_t {
+    std::uint64_t bits[4];
+
+public:
+    constexpr static_char_class_t()
+    : bits{0, 0, 0, 0}
+    {}
+
+    constexpr bool contains(unsigned char c) const
+    {
+        return (bits[c >> 6] >> (c & 63)) & 1;
+    }
+
+    constexpr static_char_class_t& add(unsigned char c)
+    {
+        bits[c >> 6] |= (std::uint64_t)1 << (c & 63);
+        return *this;
+    }
+
+    constexpr static_char_class_t& add_range(unsigned char first, unsigned char last)
+    {
+        for (unsigned c = first; c <= last; ++c)
+            add((unsigned char)c);
+        return *this;
+    }
+
+    constexpr static_char_class_t operator|(const static_char_class_t& other) const
+    {
+        static_char_class_t result;
+        for (int i = 0; i < 4; ++i)
+            result.bits[i] = bits[i] | other.bits[i];
+        return result;
+    }
+
+    constexpr static_char_class_t operator~() const
+    {
+        static_char_class_t result;
+        for (int i = 0; i < 4; ++i)
+            result.bits[i] = ~bits[i];
+        return result;
+    }
+
+    char_class_t to_char_class() const
+    {
+        char_class_t result;
+        for (int c = 0; c < 256; ++c) {
+            if (contains((unsigned char)c))
+                result.add((unsigned char)c);
+        }
+        return result;
+    }
+};
+
+
+// -----
+
+
+template<char... Cs>
+class static_string_parser_t {
+public:
+    using result_type = std::string_view;
+
+    bool parse(std::string_view s, std::size_t& index, std::string_view& value) const
+    {
+        constexpr std::size_t n = sizeof...(Cs);
+        if (index > s.size() || s.size() - index < n)
+            return false;
+        std::size_t i = index;
+        if (!((s[i++] == Cs) && ...))
+            return false;
+        value = s.substr(index, n);
+        index += n;
+        return true;
+    }
+};
+
+// The same, for a string known at compile time but not as a template
+// argument, e.g. str("let")
+class static_literal_parser_t {
+    std::string_view literal;
+
+public:
+    using result_type = std::string_view;
+
+    constexpr static_literal_parser_t(std::string_view _literal)
+    : literal(_literal)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, std::string_view& value) const
+    {
+        if (index > s.size() || s.compare(index, literal.size(), literal) != 0)
+            return false;
+        value = s.substr(index, literal.size());
+        index += literal.size();
+        return true;
+    }
+};
+
+
+// -----
+
+
+class static_char_parser_t {
+    static_char_class_t char_class;
+
+public:
+    using result_type = char;
+
+    constexpr static_char_parser_t(static_char_class_t _char_class)
+    : char_class(_char_class)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, char& value) const
+    {
+        if (index >= s.size() || !char_class.contains((unsigned char)s[index]))
+            return false;
+        value = s[index++];
+        return true;
+    }
+};
+
+// A run of characters; with allow_empty it behaves like maybe_chars_parser_t
+class static_chars_parser_t {
+    static_char_class_t char_class;
+    bool allow_empty;
+
+public:
+    using result_type = std::string_view;
+
+    constexpr static_chars_parser_t(static_char_class_t _char_class, bool _allow_empty = false)
+    : char_class(_char_class),
+      allow_empty(_allow_empty)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, std::string_view& value) const
+    {
+        if (index > s.size())
+            return false;
+        std::size_t end = index;
+        while (end < s.size() && char_class.contains((unsigned char)s[end]))
+            ++end;
+        if (end == index && !allow_empty)
+            return false;
+        value = s.substr(index, end - index);
+        index = end;
+        return true;
+    }
+};
+
+
+// -----
+
+
+template<typename... Ps>
+class static_sequence_of_parser_t {
+    std::tuple<Ps...> parsers;
+
+    template<std::size_t... Is>
+    bool parse_all(std::string_view s, std::size_t& index, std::tuple<typename Ps::result_type...>& value, std::index_sequence<Is...>) const
+    {
+        return (std::get<Is>(parsers).parse(s, index, std::get<Is>(value)) && ...);
+    }
+
+public:
+    using result_type = std::tuple<typename Ps::result_type...>;
+
+    constexpr static_sequence_of_parser_t(Ps... _parsers)
+    : parsers(std::move(_parsers)...)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, result_type& value) const
+    {
+        std::size_t start = index;
+        if (parse_all(s, index, value, std::index_sequence_for<Ps...>()))
+            return true;
+        index = start;
+        return false;
+    }
+};
+
+
+// -----
+
+
+// The alternatives' common result type, or a std::variant of them
+template<typename... Ts>
+struct static_choice_result {
+    using type = std::variant<Ts...>;
+};
+
+template<typename T, typename... Ts>
+struct static_choice_result<T, Ts...> {
+    using type = std::conditional_t<(std::is_same_v<T, Ts> && ...), T, std::variant<T, Ts...>>;
+};
+
+template<typename... Ps>
+class static_choice_of_parser_t {
+    std::tuple<Ps...> parsers;
+
+    template<std::size_t I>
+    bool parse_one(std::string_view s, std::size_t& index, typename static_choice_result<typename Ps::result_type...>::type& value) const
+    {
+        using T = typename std::tuple_element_t<I, std::tuple<Ps...>>::result_type;
+        if constexpr (std::is_same_v<T, result_type>) {
+            return std::get<I>(parsers).parse(s, index, value);
+        } else {
+            T aux{};
+            if (!std::get<I>(parsers).parse(s, index, aux))
+                return false;
+            value.template emplace<I>(std::move(aux));
+            return true;
+        }
+    }
+
+    template<std::size_t... Is>
+    bool parse_any(std::string_view s, std::size_t& index, typename static_choice_result<typename Ps::result_type...>::type& value, std::index_sequence<Is...>) const
+    {
+        return (parse_one<Is>(s, index, value) || ...);
+    }
+
+public:
+    using result_type = typename static_choice_result<typename Ps::result_type...>::type;
+
+    constexpr static_choice_of_parser_t(Ps... _parsers)
+    : parsers(std::move(_parsers)...)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, result_type& value) const
+    {
+        return parse_any(s, index, value, std::index_sequence_for<Ps...>());
+    }
+};
+
+
+// -----
+
+
+template<typename P, std::size_t at_least>
+class static_many_parser_t {
+    P parser;
+
+public:
+    using result_type = std::vector<typename P::result_type>;
+
+    constexpr static_many_parser_t(P _parser)
+    : parser(std::move(_parser))
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, result_type& value) const
+    {
+        std::size_t start = index;
+        value.clear();
+        typename P::result_type aux{};
+        while (parser.parse(s, index, aux))
+            value.push_back(std::move(aux));
+        if (value.size() >= at_least)
+            return true;
+        index = start;
+        return false;
+    }
+};
+
+
+// -----
+
+
+template<typename P, typename F>
+class static_map_parser_t {
+    P parser;
+    F f;
+
+public:
+    using result_type = std::decay_t< std::invoke_result_t<const F&, typename P::result_type&&> >;
+
+    constexpr static_map_parser_t(P _parser, F _f)
+    : parser(std::move(_parser)),
+      f(std::move(_f))
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, result_type& value) const
+    {
+        typename P::result_type aux{};
+        if (!parser.parse(s, index, aux))
+            return false;
+        value = f(std::move(aux));
+        return true;
+    }
+};
+
+
+// -----
+
+
+template<typename L, typename P, typename R>
+class static_between_parser_t {
+    L left_parser;
+    P content_parser;
+    R right_parser;
+
+public:
+    using result_type = typename P::result_type;
+
+    constexpr static_between_parser_t(L _left_parser, R _right_parser, P _content_parser)
+    : left_parser(std::move(_left_parser)),
+      content_parser(std::move(_content_parser)),
+      right_parser(std::move(_right_parser))
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, result_type& value) const
+    {
+        std::size_t start = index;
+        typename L::result_type left{};
+        typename R::result_type right{};
+        if (left_parser.parse(s, index, left) &&
+            content_parser.parse(s, index, value) &&
+            right_parser.parse(s, index, right))
+            return true;
+        index = start;
+        return false;
+    }
+};
+
+
+// -----
+
+
+template<typename S, typename P>
+class static_separated_by_parser_t {
+    S separator_parser;
+    P value_parser;
+
+public:
+    using result_type = std::vector<typename P::result_type>;
+
+    constexpr static_separated_by_parser_t(S _separator_parser, P _value_parser)
+    : separator_parser(std::move(_separator_parser)),
+      value_parser(std::move(_value_parser))
+    {}
+
+    // Like separated_by_parser_t, a trailing separator is consumed
+    bool parse(std::string_view s, std::size_t& index, result_type& value) const
+    {
+        value.clear();
+        typename P::result_type aux{};
+        typename S::result_type separator{};
+        while (value_parser.parse(s, index, aux)) {
+            value.push_back(std::move(aux));
+            if (!separator_parser.parse(s, index, separator))
+                break;
+        }
+        return true;
+    }
+};
+
+
+// -----
+
+
+// A typed_parser_t used inside a static grammar (through a virtual call)
+template<typename T>
+class static_ref_parser_t {
+    const typed_parser_t<T> *parser;
+
+public:
+    using result_type = T;
+
+    constexpr static_ref_parser_t(const typed_parser_t<T> *_parser)
+    : parser(_parser)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, T& value) const
+    {
+        return parser->parse(s, index, value);
+    }
+};
+
+
+// -----
+
+
+// Runs a static grammar as part of a parser_t grammar
+template<typename P>
+class static_adapter_parser_t : public parser_t {
+    P parser;
+
+public:
+    static_adapter_parser_t(P _parser)
+    : parser(std::move(_parser))
+    {}
+
+    parser_state_t run(parser_state_t parser_state) const
+    {
+        if (parser_state.error.has_value())
+            return parser_state;
+
+        typename P::result_type value{};
+        std::size_t index = parser_state.index;
+        if (index <= parser_state.target_string.size() && parser.parse(parser_state.target_string, index, value)) {
+            return parser_state
+                .set_result(typed_to_any(value))
+                .set_index(index);
+        }
+
+        return parser_state
+            .set_result("")
+            .fail(this);
+    }
+
+    std::string get_name() const
+    {
+        return "static_adapter_parser_t";
+    }
+
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const
+    {
+        return "static_adapter_parser_t::run(): Couldn't match the static parser in \"" + string_at_most<true>(target_string, 10, error.index) + "\"";
+    }
+};
+
+// Runs a static grammar as a typed_parser_t
+template<typename P>
+class static_typed_parser_t : public typed_parser_t<typename P::result_type> {
+    P parser;
+
+public:
+    static_typed_parser_t(P _parser)
+    : parser(std::move(_parser))
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, typename P::result_type& value) const override
+    {
+        return parser.parse(s, index, value);
+    }
+};
+
+
+// -----
+
+
+namespace st {
+
+constexpr static_char_class_t range(char first, char last)
+{
+    return static_char_class_t().add_range((unsigned char)first, (unsigned char)last);
+}
+
+constexpr static_char_class_t one_of(std::string_view chars)
+{
+    static_char_class_t result;
+    for (char c : chars)
+        result.add((unsigned char)c);
+    return result;
+}
+
+constexpr static_char_class_t digit = range('0', '9');
+constexpr static_char_class_t alpha = range('a', 'z') | range('A', 'Z');
+constexpr static_char_class_t alnum = alpha | digit;
+constexpr static_char_class_t space = one_of(" \t\n\v\f\r");
+constexpr static_char_class_t any_char = ~static_char_class_t();
+
+template<char... Cs>
+constexpr static_string_parser_t<Cs...> lit{};
+
+constexpr static_literal_parser_t str(std::string_view literal)
+{
+    return static_literal_parser_t(literal);
+}
+
+constexpr static_char_parser_t chr(static_char_class_t char_class)
+{
+    return static_char_parser_t(char_class);
+}
+
+constexpr static_chars_parser_t chars(static_char_class_t char_class)
+{
+    return static_chars_parser_t(char_class);
+}
+
+constexpr static_chars_parser_t maybe_chars(static_char_class_t char_class)
+{
+    return static_chars_parser_t(char_class, true);
+}
+
+template<typename... Ps>
+constexpr auto seq(Ps... parsers)
+{
+    return static_sequence_of_parser_t<Ps...>(std::move(parsers)...);
+}
+
+template<typename... Ps>
+constexpr auto alt(Ps... parsers)
+{
+    return static_choice_of_parser_t<Ps...>(std::move(parsers)...);
+}
+
+template<typename P>
+constexpr auto many(P parser)
+{
+    return static_many_parser_t<P, 0>(std::move(parser));
+}
+
+template<typename P>
+constexpr auto many1(P parser)
+{
+    return static_many_parser_t<P, 1>(std::move(parser));
+}
+
+template<typename P, typename F>
+constexpr auto map(P parser, F f)
+{
+    return static_map_parser_t<P, F>(std::move(parser), std::move(f));
+}
+
+template<typename L, typename R, typename P>
+constexpr auto between(L left_parser, R right_parser, P content_parser)
+{
+    return static_between_parser_t<L, P, R>(std::move(left_parser), std::move(right_parser), std::move(content_parser));
+}
+
+template<typename S, typename P>
+constexpr auto separated_by(S separator_parser, P value_parser)
+{
+    return static_separated_by_parser_t<S, P>(std::move(separator_parser), std::move(value_parser));
+}
+
+template<typename T>
+constexpr auto ref(const typed_parser_t<T>& parser)
+{
+    return static_ref_parser_t<T>(&parser);
+}
+
+template<typename P>
+auto to_parser(P parser)
+{
+    return new static_adapter_parser_t<P>(std::move(parser));
+}
+
+template<typename P>
+auto to_parser(grammar_t& g, P parser)
+{
+    return g.make< static_adapter_parser_t<P> >(std::move(parser));
+}
+
+template<typename P>
+auto to_typed(P parser)
+{
+    return new static_typed_parser_t<P>(std::move(parser));
+}
+
+template<typename P>
+auto to_typed(grammar_t& g, P parser)
+{
+    return g.make< static_typed_parser_t<P> >(std::move(parser));
+}
+
+} // namespace st
+
+
+// -----
+} // namespace wi
+#endif // _WI_STATIC_PARSER_HPP_
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_STREAM_HPP_
+#define _WI_STREAM_HPP_ "1.0.2b"
+
+#include "parser.hpp"
+
+#include <string_view>
+#include <functional>
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <any>
+
+
+namespace wi {
+// -----
+
+
+// Where a streamed input comes from. read() blocks until it can hand out
+// some bytes, and only returns 0 at the end of the input.
+class input_source_t {
+public:
+    virtual ~input_source_t() = default;
+
+    // Copies at most size bytes to buffer and returns how many there were
+    virtual std::size_t read(char *buffer, std::size_t size) = 0;
+};
+
+// A buffer that is already in memory, which must outlive the source
+class memory_source_t : public input_source_t {
+    std::string_view data;
+    std::size_t position;
+
+public:
+    memory_source_t(std::string_view _data);
+    std::size_t read(char *buffer, std::size_t size);
+};
+
+class istream_source_t : public input_source_t {
+    std::istream& stream;
+
+public:
+    istream_source_t(std::istream& _stream);
+    std::size_t read(char *buffer, std::size_t size);
+};
+
+// A POSIX file descriptor (a file, a pipe, a socket...), which is not
+// closed by the source. Read errors are thrown.
+class fd_source_t : public input_source_t {
+    int fd;
+
+public:
+    fd_source_t(int _fd);
+    std::size_t read(char *buffer, std::size_t size);
+};
+
+
+// -----
+
+
+// The part of a streamed input that may still be read: bytes are read from
+// the source a chunk at a time and dropped with discard() once nothing can
+// go back to them, so the window only grows as large as what is parsed at
+// once. The offsets are absolute, counted from the start of the input.
+class input_window_t {
+    input_source_t& source;
+    std::string buffer;
+    // buffer[begin] is the first byte not discarded, at offset in the input
+    std::size_t begin;
+    std::size_t offset;
+    std::size_t chunk_size;
+    std::size_t peak_size;
+    bool end;
+
+public:
+    input_window_t(input_source_t& _source, std::size_t _chunk_size = 64 * 1024);
+
+    // The bytes in the window; invalidated by fill()
+    std::string_view get_view() const;
+    // The offset of get_view()[0] in the input
+    std::size_t get_offset() const;
+    // Whether the source is exhausted, i.e. the window ends with the input
+    bool at_end() const;
+    // The largest the window grew, in bytes
+    std::size_t get_peak_size() const;
+
+    // Reads at least one chunk, or as many bytes as the window already holds
+    // if that is more (so that waiting for a long element stays linear), and
+    // returns the number of bytes read, 0 at the end of the input
+    std::size_t fill();
+    // Drops the first n bytes of the window
+    void discard(std::size_t n);
+};
+
+
+// -----
+
+
+// The outcome of parse_stream(). The final state refers to what was left in
+// the window, i.e. its index (as the index of its error) is relative to the
+// offset of the window at that point.
+struct stream_result_t {
+    parser_state_t state;
+    // The elements handed to on_element
+    std::size_t elements;
+    // The offset, in the input, the list stopped at
+    std::size_t index;
+    std::size_t peak_window_size;
+};
+
+// Receives each element of the list, with its offsets in the input. Spans
+// and arena lists in the result refer to the window and the element's
+// context, so they must be copied if they should outlive the call.
+using stream_callback_t = std::function<void(std::any result, std::size_t begin, std::size_t end)>;
+
+// Runs a many_parser_t, many1_parser_t or separated_by_parser_t over a
+// streamed input, as run() would, except that each element is handed to
+// on_element as soon as it is parsed instead of being collected, and that
+// the input it was parsed from is then discarded:
+//
+//   fd_source_t source(fd);
+//   stream_result_t r = parse_stream(p_records, source, [&](std::any record, std::size_t, std::size_t) {
+//       ...
+//   });
+//
+// Memory thus stays bounded by the longest element (and separator), not by
+// the input. Each element (and separator) is parsed with a fresh context,
+// from an empty incoming result, and again with more input whenever the
+// attempt reached the end of the window. An element (or separator) nested
+// deeper than parse_options_t::max_depth fails the final state, as in run(),
+// after the elements before it were handed over.
+stream_result_t parse_stream(const parser_t *list_parser, input_source_t& source, stream_callback_t on_element,
+                             parse_options_t options = parse_options_t(), std::size_t chunk_size = 64 * 1024);
+
+
+// -----
+} // namespace wi
+#endif // _WI_STREAM_HPP_
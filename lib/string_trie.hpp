@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_STRING_TRIE_HPP_
+#define _WI_STRING_TRIE_HPP_ "1.0.2b"
+
+#include <string_view>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+namespace wi {
+// -----
+
+
+// A trie over a list of words, each word being identified by its position in
+// the list. Matching walks the input once, whatever the number of words.
+class string_trie_t {
+public:
+    static constexpr std::size_t npos = (std::size_t)-1;
+
+    struct match_t {
+        std::size_t word;    // npos if nothing matched
+        std::size_t length;
+    };
+
+    string_trie_t();
+
+    // If the same word is inserted twice, the smallest id is kept
+    string_trie_t& insert(std::string_view word, std::size_t id);
+    string_trie_t& clear();
+
+    // The matching word with the smallest id
+    match_t match_first(std::string_view s, std::size_t index = 0) const;
+    // The longest matching word
+    match_t match_longest(std::string_view s, std::size_t index = 0) const;
+
+    // Whether s[index..] is a proper prefix of some word, i.e. whether more
+    // input past the end of s could change the match
+    bool extends(std::string_view s, std::size_t index = 0) const;
+
+    // Bytes that can start a match (the empty word aside)
+    bool can_start_with(unsigned char c) const;
+    bool has_empty_word() const;
+    std::size_t node_count() const;
+    // The length of the longest word, i.e. how far a match may look
+    std::size_t get_max_length() const;
+
+private:
+    struct node_t {
+        std::vector< std::pair<unsigned char, std::uint32_t> > edges; // sorted
+        std::size_t word;
+    };
+
+    std::vector<node_t> nodes;
+    std::size_t max_length;
+    // The root is the widest node by far, so its edges get a direct table
+    std::uint32_t root_edges[256];
+
+    std::uint32_t child(std::uint32_t node, unsigned char c) const;
+};
+
+
+// -----
+} // namespace wi
+#endif // _WI_STRING_TRIE_HPP_
@@ -0,0 +1,562 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_TYPED_PARSER_HPP_
+#define _WI_TYPED_PARSER_HPP_ "1.0.2b"
+
+
+namespace wi {
+template<typename T> class typed_parser_t;
+class typed_string_parser_t;
+class typed_choice_of_string_parser_t;
+class typed_char_parser_t;
+class typed_chars_parser_t;
+template<typename T> class typed_lazy_parser_t;
+template<typename T, typename U> class typed_map_parser_t;
+template<typename... Ts> class typed_sequence_of_parser_t;
+template<typename T> class typed_choice_of_parser_t;
+template<typename T> class typed_many_parser_t;
+template<typename L, typename T, typename R> class typed_between_parser_t;
+template<typename T, typename S> class typed_separated_by_parser_t;
+template<typename T> class typed_adapter_parser_t;
+class typed_legacy_parser_t;
+}
+
+
+// -----
+
+
+#include "grammar.hpp"
+#include "parser.hpp"
+
+#include <type_traits>
+#include <string_view>
+#include <functional>
+#include <utility>
+#include <string>
+#include <variant>
+#include <vector>
+#include <tuple>
+#include <any>
+
+
+namespace wi {
+// -----
+
+
+// The typed layer mirrors the parser_t hierarchy, but every parser states
+// the type of its result, so the combinators build plain values (tuples,
+// vectors, whatever map() returns) instead of std::any trees. Leaf parsers
+// return std::string_view slices of the input, which must thus outlive the
+// results.
+//
+// parse() either succeeds, storing the result in `value` and moving `index`
+// past the match, or fails and leaves `index` untouched.
+template<typename T>
+class typed_parser_t {
+public:
+    using result_type = T;
+
+    virtual ~typed_parser_t() = default;
+    virtual bool parse(std::string_view s, std::size_t& index, T& value) const = 0;
+};
+
+
+// -----
+
+
+class typed_string_parser_t : public typed_parser_t<std::string_view> {
+    std::string s;
+
+public:
+    typed_string_parser_t(std::string _s);
+    bool parse(std::string_view target, std::size_t& index, std::string_view& value) const override;
+};
+
+
+// -----
+
+
+class typed_choice_of_string_parser_t : public typed_parser_t<std::string_view> {
+    choice_of_string_parser_t parser;
+
+public:
+    typed_choice_of_string_parser_t(std::vector<std::string> _words);
+    typed_choice_of_string_parser_t(std::vector<std::string> _words, choice_of_string_parser_t::match_mode_t _match_mode);
+    bool parse(std::string_view s, std::size_t& index, std::string_view& value) const override;
+};
+
+
+// -----
+
+
+class typed_char_parser_t : public typed_parser_t<char> {
+    char_class_t char_class;
+
+public:
+    typed_char_parser_t(char_class_t _char_class);
+    bool parse(std::string_view s, std::size_t& index, char& value) const override;
+};
+
+
+// -----
+
+
+// A run of characters; with allow_empty it behaves like maybe_chars_parser_t
+class typed_chars_parser_t : public typed_parser_t<std::string_view> {
+    class_scanner_t scanner;
+    bool allow_empty;
+
+public:
+    typed_chars_parser_t(char_class_t _char_class, bool _allow_empty = false);
+    bool parse(std::string_view s, std::size_t& index, std::string_view& value) const override;
+};
+
+
+// -----
+
+
+template<typename T>
+class typed_lazy_parser_t : public typed_parser_t<T> {
+    const typed_parser_t<T> *parser;
+
+public:
+    typed_lazy_parser_t()
+    : parser(nullptr)
+    {}
+
+    typed_lazy_parser_t(const typed_parser_t<T> *_parser)
+    : parser(_parser)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, T& value) const override
+    {
+        return parser->parse(s, index, value);
+    }
+
+    typed_lazy_parser_t& set_parser(const typed_parser_t<T> *_parser)
+    {
+        parser = _parser;
+        return *this;
+    }
+};
+
+
+// -----
+
+
+template<typename T, typename U>
+class typed_map_parser_t : public typed_parser_t<U> {
+    const typed_parser_t<T> *parser;
+    std::function<U(T&&)> f;
+
+public:
+    typed_map_parser_t(const typed_parser_t<T> *_parser, std::function<U(T&&)> _f)
+    : parser(_parser),
+      f(std::move(_f))
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, U& value) const override
+    {
+        T aux{};
+        if (!parser->parse(s, index, aux))
+            return false;
+        value = f(std::move(aux));
+        return true;
+    }
+};
+
+
+// -----
+
+
+template<typename... Ts>
+class typed_sequence_of_parser_t : public typed_parser_t< std::tuple<Ts...> > {
+    std::tuple<const typed_parser_t<Ts>*...> parsers;
+
+    template<std::size_t I>
+    bool parse_from(std::string_view s, std::size_t& index, std::tuple<Ts...>& value) const
+    {
+        if constexpr (I == sizeof...(Ts)) {
+            return true;
+        } else {
+            return std::get<I>(parsers)->parse(s, index, std::get<I>(value)) &&
+                   parse_from<I + 1>(s, index, value);
+        }
+    }
+
+public:
+    typed_sequence_of_parser_t(const typed_parser_t<Ts>*... _parsers)
+    : parsers(_parsers...)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, std::tuple<Ts...>& value) const override
+    {
+        std::size_t start = index;
+        if (parse_from<0>(s, index, value))
+            return true;
+        index = start;
+        return false;
+    }
+};
+
+
+// -----
+
+
+template<typename T>
+class typed_choice_of_parser_t : public typed_parser_t<T> {
+    std::vector<const typed_parser_t<T>*> parsers;
+
+public:
+    typed_choice_of_parser_t(std::vector<const typed_parser_t<T>*> _parsers)
+    : parsers(std::move(_parsers))
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, T& value) const override
+    {
+        for (const typed_parser_t<T> *parser : parsers) {
+            if (parser->parse(s, index, value))
+                return true;
+        }
+        return false;
+    }
+
+    typed_choice_of_parser_t& add_parser(const typed_parser_t<T> *parser)
+    {
+        parsers.push_back(parser);
+        return *this;
+    }
+};
+
+
+// -----
+
+
+// many_parser_t, or many1_parser_t if at_least is 1
+template<typename T>
+class typed_many_parser_t : public typed_parser_t< std::vector<T> > {
+    const typed_parser_t<T> *parser;
+    std::size_t at_least;
+
+public:
+    typed_many_parser_t(const typed_parser_t<T> *_parser, std::size_t _at_least = 0)
+    : parser(_parser),
+      at_least(_at_least)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, std::vector<T>& value) const override
+    {
+        std::size_t start = index;
+        value.clear();
+        T aux{};
+        while (parser->parse(s, index, aux))
+            value.push_back(std::move(aux));
+        if (value.size() >= at_least)
+            return true;
+        index = start;
+        return false;
+    }
+};
+
+
+// -----
+
+
+template<typename L, typename T, typename R>
+class typed_between_parser_t : public typed_parser_t<T> {
+    const typed_parser_t<L> *left_parser;
+    const typed_parser_t<R> *right_parser;
+    const typed_parser_t<T> *content_parser;
+
+public:
+    typed_between_parser_t(const typed_parser_t<L> *_left_parser, const typed_parser_t<R> *_right_parser, const typed_parser_t<T> *_content_parser)
+    : left_parser(_left_parser),
+      right_parser(_right_parser),
+      content_parser(_content_parser)
+    {}
+
+    bool parse(std::string_view s, std::size_t& index, T& value) const override
+    {
+        std::size_t start = index;
+        L left{};
+        R right{};
+        if (left_parser->parse(s, index, left) &&
+            content_parser->parse(s, index, value) &&
+            right_parser->parse(s, index, right))
+            return true;
+        index = start;
+        return false;
+    }
+};
+
+
+// -----
+
+
+template<typename T, typename S>
+class typed_separated_by_parser_t : public typed_parser_t< std::vector<T> > {
+    const typed_parser_t<S> *separator_parser;
+    const typed_parser_t<T> *value_parser;
+
+public:
+    typed_separated_by_parser_t(const typed_parser_t<S> *_separator_parser, const typed_parser_t<T> *_value_parser)
+    : separator_parser(_separator_parser),
+      value_parser(_value_parser)
+    {}
+
+    // Like separated_by_parser_t, a trailing separator is consumed
+    bool parse(std::string_view s, std::size_t& index, std::vector<T>& value) const override
+    {
+        value.clear();
+        T aux{};
+        S separator{};
+        while (value_parser->parse(s, index, aux)) {
+            value.push_back(std::move(aux));
+            if (!separator_parser->parse(s, index, separator))
+                break;
+        }
+        return true;
+    }
+};
+
+
+// -----
+
+
+// Converts a typed result into the std::any tree the parser_t hierarchy
+// would have produced for the same grammar. Declared up front, so that the
+// overloads can call each other whatever the nesting.
+template<typename T>
+std::any typed_to_any(const T& value);
+template<typename T>
+std::any typed_to_any(const std::vector<T>& value);
+template<typename... Ts>
+std::any typed_to_any(const std::tuple<Ts...>& value);
+template<typename... Ts>
+std::any typed_to_any(const std::variant<Ts...>& value);
+
+template<typename T>
+std::any typed_to_any(const T& value)
+{
+    if constexpr (std::is_same_v<T, std::string_view>) {
+        return std::string(value);
+    } else if constexpr (std::is_same_v<T, char>) {
+        return std::string(1, value);
+    } else if constexpr (std::is_same_v<T, std::any>) {
+        return value;
+    } else {
+        return std::any(value);
+    }
+}
+
+template<typename T>
+std::any typed_to_any(const std::vector<T>& value)
+{
+    std::vector<std::any> result;
+    result.reserve(value.size());
+    for (const T& x : value)
+        result.emplace_back(typed_to_any(x));
+    return result;
+}
+
+template<typename... Ts>
+std::any typed_to_any(const std::tuple<Ts...>& value)
+{
+    std::vector<std::any> result;
+    result.reserve(sizeof...(Ts));
+    std::apply([&](const Ts&... xs) { (result.emplace_back(typed_to_any(xs)), ...); }, value);
+    return result;
+}
+
+// The alternative that matched, as choice_of_parser_t would return it
+template<typename... Ts>
+std::any typed_to_any(const std::variant<Ts...>& value)
+{
+    return std::visit([](const auto& x) { return typed_to_any(x); }, value);
+}
+
+
+// Runs a typed parser as part of a parser_t grammar
+template<typename T>
+class typed_adapter_parser_t : public parser_t {
+    const typed_parser_t<T> *parser;
+
+public:
+    typed_adapter_parser_t(const typed_parser_t<T> *_parser)
+    : parser(_parser)
+    {}
+
+    parser_state_t run(parser_state_t parser_state) const
+    {
+        if (parser_state.error.has_value())
+            return parser_state;
+
+        T value{};
+        std::size_t index = parser_state.index;
+        if (index <= parser_state.target_string.size() && parser->parse(parser_state.target_string, index, value)) {
+            return parser_state
+                .set_result(typed_to_any(value))
+                .set_index(index);
+        }
+
+        return parser_state
+            .set_result("")
+            .fail(this);
+    }
+
+    std::string get_name() const
+    {
+        return "typed_adapter_parser_t";
+    }
+
+    std::string describe_error(const parse_error_t& error, std::string_view target_string) const
+    {
+        return "typed_adapter_parser_t::run(): Couldn't match the typed parser in \"" + string_at_most<true>(target_string, 10, error.index) + "\"";
+    }
+};
+
+
+// Runs a parser_t as part of a typed grammar; its result stays a std::any
+class typed_legacy_parser_t : public typed_parser_t<std::any> {
+    const parser_t *parser;
+
+public:
+    typed_legacy_parser_t(const parser_t *_parser);
+    bool parse(std::string_view s, std::size_t& index, std::any& value) const override;
+};
+
+
+// -----
+
+
+// Helpers deducing the result types, e.g.
+//   typed_sequence_of(new typed_string_parser_t("("), p_value)
+template<typename... Ps>
+auto typed_sequence_of(const Ps*... parsers)
+{
+    return new typed_sequence_of_parser_t<typename Ps::result_type...>(parsers...);
+}
+
+template<typename P, typename... Ps>
+auto typed_choice_of(const P* parser, const Ps*... parsers)
+{
+    using T = typename P::result_type;
+    static_assert((std::is_same_v<typename Ps::result_type, T> && ...), "typed_choice_of(): the alternatives must have the same result_type");
+    return new typed_choice_of_parser_t<T>({static_cast<const typed_parser_t<T>*>(parser), static_cast<const typed_parser_t<T>*>(parsers)...});
+}
+
+template<typename P>
+auto typed_many(const P* parser)
+{
+    return new typed_many_parser_t<typename P::result_type>(parser);
+}
+
+template<typename P>
+auto typed_many1(const P* parser)
+{
+    return new typed_many_parser_t<typename P::result_type>(parser, 1);
+}
+
+template<typename P, typename F>
+auto typed_map(const P* parser, F f)
+{
+    using T = typename P::result_type;
+    using U = std::decay_t< std::invoke_result_t<F, T&&> >;
+    return new typed_map_parser_t<T, U>(parser, std::function<U(T&&)>(std::move(f)));
+}
+
+template<typename PL, typename PR, typename P>
+auto typed_between(const PL* left_parser, const PR* right_parser, const P* content_parser)
+{
+    return new typed_between_parser_t<typename PL::result_type, typename P::result_type, typename PR::result_type>(left_parser, right_parser, content_parser);
+}
+
+template<typename PS, typename P>
+auto typed_separated_by(const PS* separator_parser, const P* value_parser)
+{
+    return new typed_separated_by_parser_t<typename P::result_type, typename PS::result_type>(separator_parser, value_parser);
+}
+
+template<typename P>
+auto typed_adapter(const P* parser)
+{
+    return new typed_adapter_parser_t<typename P::result_type>(parser);
+}
+
+// The same helpers, allocating the nodes in a grammar_t
+template<typename... Ps>
+auto typed_sequence_of(grammar_t& g, const Ps*... parsers)
+{
+    return g.make< typed_sequence_of_parser_t<typename Ps::result_type...> >(parsers...);
+}
+
+template<typename P, typename... Ps>
+auto typed_choice_of(grammar_t& g, const P* parser, const Ps*... parsers)
+{
+    using T = typename P::result_type;
+    static_assert((std::is_same_v<typename Ps::result_type, T> && ...), "typed_choice_of(): the alternatives must have the same result_type");
+    return g.make< typed_choice_of_parser_t<T> >(std::vector<const typed_parser_t<T>*>{static_cast<const typed_parser_t<T>*>(parser), static_cast<const typed_parser_t<T>*>(parsers)...});
+}
+
+template<typename P>
+auto typed_many(grammar_t& g, const P* parser)
+{
+    return g.make< typed_many_parser_t<typename P::result_type> >(parser);
+}
+
+template<typename P>
+auto typed_many1(grammar_t& g, const P* parser)
+{
+    return g.make< typed_many_parser_t<typename P::result_type> >(parser, 1);
+}
+
+template<typename P, typename F>
+auto typed_map(grammar_t& g, const P* parser, F f)
+{
+    using T = typename P::result_type;
+    using U = std::decay_t< std::invoke_result_t<F, T&&> >;
+    return g.make< typed_map_parser_t<T, U> >(parser, std::function<U(T&&)>(std::move(f)));
+}
+
+template<typename PL, typename PR, typename P>
+auto typed_between(grammar_t& g, const PL* left_parser, const PR* right_parser, const P* content_parser)
+{
+    return g.make< typed_between_parser_t<typename PL::result_type, typename P::result_type, typename PR::result_type> >(left_parser, right_parser, content_parser);
+}
+
+template<typename PS, typename P>
+auto typed_separated_by(grammar_t& g, const PS* separator_parser, const P* value_parser)
+{
+    return g.make< typed_separated_by_parser_t<typename P::result_type, typename PS::result_type> >(separator_parser, value_parser);
+}
+
+template<typename P>
+auto typed_adapter(grammar_t& g, const P* parser)
+{
+    return g.make< typed_adapter_parser_t<typename P::result_type> >(parser);
+}
+
+
+// -----
+} // namespace wi
+#endif // _WI_TYPED_PARSER_HPP_
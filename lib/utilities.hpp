@@ -23,7 +23,10 @@
 #ifndef _WI_UTILITIES_HPP_
 #define _WI_UTILITIES_HPP_ "1.0.2b"
 
+#include <memory_resource>
+#include <string_view>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -34,28 +37,77 @@ namespace wi {
 // -----
 
 
-bool string_starts_with(std::string s, std::string prefix, std::size_t index = 0);
+// A slice [begin, end) of the parsed input, returned by the leaf parsers when
+// the parse asks for spans instead of strings. The text is a view into the
+// input, so it is only valid while the input is alive: while any state of
+// the parse is, or, if the span holds the input itself (see
+// parse_options_t::spans_keep_input), for as long as the span is.
+struct span_t {
+    std::size_t begin;
+    std::size_t end;
+    std::string_view text;
+    std::shared_ptr<const void> owner;
 
-std::vector<std::any> flatten_vector(std::any pot_v);
+    std::size_t size() const;
+    std::string str() const;
+};
 
-bool any_is_smart_string(std::any a);
 
-std::string smart_string_any_cast(std::any a);
+// -----
+
+
+// Result lists are std::vector<std::any>, or std::pmr::vector<std::any> when
+// the parse allocates them in an arena. This gives read-only access to either.
+class any_vector_view_t {
+    const std::any *data;
+    std::size_t length;
+
+public:
+    any_vector_view_t();
+    any_vector_view_t(const std::vector<std::any>& v);
+    any_vector_view_t(const std::pmr::vector<std::any>& v);
+
+    const std::any* begin() const;
+    const std::any* end() const;
+    const std::any& operator[](std::size_t i) const;
+    std::size_t size() const;
+};
+
+bool any_is_vector(const std::any& a);
+
+// An empty view if a is not a result list
+any_vector_view_t any_vector_view(const std::any& a);
+
+// Empties a. A result list holding other lists is torn down one list at a
+// time, instead of by one recursive destructor call per level of nesting,
+// which would overflow the stack on deeply nested results.
+void release_any(std::any& a);
+
+
+// -----
+
+
+bool string_starts_with(std::string_view s, std::string_view prefix, std::size_t index = 0);
+
+std::vector<std::any> flatten_vector(const std::any& pot_v);
+
+bool any_is_smart_string(const std::any& a);
+
+std::string smart_string_any_cast(const std::any& a);
 
 
 // -----
 
 
 template<bool>
-static std::string vector_to_string(std::vector<std::any>&);
+static std::string vector_to_string(any_vector_view_t);
 
-// This function is limited
+// This function is limited; spans are printed as strings
 template<bool use_quotes = false>
 static std::string any_to_string(const std::any& x)
 {
-    if (x.type() == typeid(std::vector<std::any>)) {
-        std::vector<std::any> v = std::any_cast< std::vector<std::any> >(x);
-        return vector_to_string<use_quotes>(v);
+    if (any_is_vector(x)) {
+        return vector_to_string<use_quotes>(any_vector_view(x));
     } else if (any_is_smart_string(x)) {
         std::string aux = smart_string_any_cast(x);
         if constexpr (use_quotes) {
@@ -72,7 +124,7 @@ static std::string any_to_string(const std::any& x)
 }
 
 template<bool use_quotes = false>
-static std::string vector_to_string(std::vector<std::any>& v)
+static std::string vector_to_string(any_vector_view_t v)
 {
     if (v.size() == 0)
         return "[]";
@@ -85,7 +137,7 @@ static std::string vector_to_string(std::vector<std::any>& v)
 }
 
 template<bool use_ellipsis = false>
-static std::string string_at_most(std::string s, std::size_t at_most, std::size_t from = 0)
+static std::string string_at_most(std::string_view s, std::size_t at_most, std::size_t from = 0)
 {
     if (at_most == 0 || from > s.size())
         return "";
@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WI_VM_HPP_
+#define _WI_VM_HPP_ "1.0.2b"
+
+#include "class_scanner.hpp"
+#include "first_set.hpp"
+#include "parser.hpp"
+
+#include <unordered_map>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <string>
+#include <vector>
+#include <any>
+
+
+namespace wi {
+// -----
+
+
+enum class vm_opcode_t : std::uint8_t {
+    end,             // the parse succeeded
+    fail,            // backtrack to the last choice, or fail the parse
+    match_string,    // literals[arg]
+    match_words,     // the choice_of_string_parser_t nodes[arg]
+    match_char,      // one character of scanners[arg]
+    match_chars,     // a non-empty run of scanners[arg]
+    match_maybe_chars, // a possibly empty run of scanners[arg]
+    test_set,        // jump to target unless first_sets[arg] is viable here
+    choice,          // push a backtrack entry resuming at target
+    commit,          // pop the backtrack entry, jump to target
+    partial_commit,  // move the backtrack entry here, jump to target
+    jump,
+    call,            // push the return address, jump to target
+    ret,
+    open_list,       // start collecting values
+    push_value,      // append the result to the values
+    close_list,      // the result is the values collected since open_list
+    close_list1,     // same, but fail if there are none (many1)
+    pop_value,       // the result is the last value appended
+    map,             // apply the function of the map_parser_t nodes[arg]
+    flatten,
+    chain,           // run the parser picked by the chain_parser_t nodes[arg]
+    native           // run nodes[arg] through parser_t::apply()
+};
+
+const char* vm_opcode_name(vm_opcode_t opcode);
+
+struct vm_instruction_t {
+    vm_opcode_t opcode;
+    std::uint32_t arg;
+    std::uint32_t target;
+};
+
+// The kinds of entries on the machine's stack
+enum vm_frame_kind_t : std::uint32_t {
+    call_frame,     // pc is the return address
+    choice_frame,   // pc is the alternative, index / values_size the state
+                    // to go back to (and the result, on the saved results)
+    list_frame      // values_size is where the list starts
+};
+
+// A few bytes per level of nesting; the results to go back to, which only
+// matter when some node forwards them, are kept apart
+struct vm_frame_t {
+    vm_frame_kind_t kind;
+    std::uint32_t pc;
+    std::size_t index;
+    std::size_t values_size;
+};
+
+// Where a vm_program_t stands between two instructions. run() keeps it for
+// the length of a call; resumable_parser_t keeps it from a feed to the next.
+struct vm_machine_t {
+    std::uint32_t pc = 0;
+    std::vector<vm_frame_t> stack;
+    std::vector<std::any> values;
+    std::vector<std::any> saved_results;
+    // The calls on the stack, bounded by max_vm_depth
+    std::size_t depth = 0;
+};
+
+enum class vm_status_t {
+    done,       // the program ended, or failed the parse outright
+    failed,     // the grammar did not match
+    suspended   // more input is needed (see vm_program_t::execute())
+};
+
+
+// -----
+
+
+// A grammar compiled into a flat instruction stream, run by a loop with an
+// explicit backtracking stack (a parsing machine in the style of LPeg):
+// choices push a backtrack entry and commit to an alternative once it
+// matched, every node reached more than once (recursive rules included)
+// becomes a subroutine entered with call, and the result lists are
+// collected on a single value stack. The alternatives of a choice are
+// guarded by their FIRST sets, as with the dispatch tables.
+//
+//   vm_program_t program(p_root);
+//   parser_state_t ps = parse(program, "(+ 1 2)");
+//
+// A successful parse yields the same result and index as running the
+// grammar. The functions of map_parser_t and chain_parser_t nodes are
+// called as usual; the parsers chosen by chains, the nodes marked with
+// set_memoize() and the node types the compiler does not know are run
+// natively, through apply(). A parse with parse_options_t::memoize runs
+// the original grammar, and so does a failed parse, to report the error
+// exactly as run() would. The stack lives on the heap, so the depth of
+// the input is bounded by parse_options_t::max_vm_depth rather than by the
+// machine stack.
+//
+// The program refers to some of the original nodes, which must outlive it.
+class vm_program_t {
+public:
+    vm_program_t(const parser_t *_root);
+
+    parser_state_t run(parser_state_t parser_state) const;
+
+    // Runs the machine from where it stands, until the program ends or
+    // fails; run() is a call on a fresh machine, which also reports the
+    // errors. With more_input set, the input may still grow past the end of
+    // the target string: an instruction whose outcome depends on the bytes
+    // that are not there yet is not run, and the machine and the state are
+    // left as they were before it, to be run again once they are.
+    vm_status_t execute(vm_machine_t& machine, parser_state_t& parser_state, bool more_input = false) const;
+
+    const parser_t* get_root() const;
+    const std::vector<vm_instruction_t>& get_instructions() const;
+    // One instruction per line, e.g. "12: choice -> 17"
+    std::string to_string() const;
+
+private:
+    const parser_t *root;
+    std::vector<vm_instruction_t> instructions;
+    std::vector<std::string> literals;
+    std::vector<class_scanner_t> scanners;
+    std::vector<first_set_t> first_sets;
+    std::vector<const parser_t*> nodes;
+    // Whether some node reads the result it was handed, in which case
+    // the backtrack entries keep a copy of it
+    bool forwards;
+
+    // Whether the outcome of a leaf instruction at index depends on bytes
+    // past the end of s
+    bool needs_input(const vm_instruction_t& instruction, std::string_view s, std::size_t index) const;
+
+    // Compilation only
+    std::unordered_map<const parser_t*, std::size_t> references;
+    std::unordered_map<const parser_t*, std::uint32_t> rules;
+    std::vector<const parser_t*> pending_rules;
+    std::vector<std::pair<std::uint32_t, const parser_t*>> calls;
+
+    std::uint32_t emit(vm_opcode_t opcode, std::uint32_t arg = 0, std::uint32_t target = 0);
+    std::uint32_t add_node(const parser_t *parser);
+    void compile(const parser_t *parser, const first_set_analysis_t& analysis);
+    void compile_node(const parser_t *parser, const first_set_analysis_t& analysis);
+    void compile_choice(const std::vector<const parser_t*>& parsers, const first_set_analysis_t& analysis);
+    void compile_many(const parser_t *parser, bool at_least_one, const first_set_analysis_t& analysis);
+};
+
+// Runs a program over the whole input, using a fresh parse context
+parser_state_t parse(const vm_program_t& program, std::string target_string, parse_options_t options = parse_options_t());
+parser_state_t parse(const vm_program_t& program, std::shared_ptr<const std::string> input, parse_options_t options = parse_options_t());
+
+
+// -----
+
+
+// A compiled grammar used as a node of another one
+class vm_parser_t : public parser_t {
+    vm_program_t program;
+
+public:
+    vm_parser_t(const parser_t *root);
+
+    parser_state_t run(parser_state_t parser_state) const;
+    std::string get_name() const;
+    first_set_t first_set(const first_set_analysis_t& analysis) const;
+    std::vector<const parser_t*> get_children() const;
+
+    const vm_program_t& get_program() const;
+};
+
+
+// -----
+} // namespace wi
+#endif // _WI_VM_HPP_
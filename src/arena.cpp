@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace wi {
+// -----
+
+
+parse_arena_t::parse_arena_t(std::size_t _block_size)
+: blocks(),
+  current(nullptr),
+  remaining(0),
+  block_size(_block_size),
+  allocations(0),
+  bytes_allocated(0),
+  bytes_reserved(0)
+{}
+
+parse_arena_t::~parse_arena_t()
+{
+    release();
+}
+
+void parse_arena_t::release()
+{
+    blocks.clear();
+    current = nullptr;
+    remaining = 0;
+}
+
+std::size_t parse_arena_t::get_allocations() const
+{
+    return allocations;
+}
+
+std::size_t parse_arena_t::get_bytes_allocated() const
+{
+    return bytes_allocated;
+}
+
+std::size_t parse_arena_t::get_block_count() const
+{
+    return blocks.size();
+}
+
+std::size_t parse_arena_t::get_bytes_reserved() const
+{
+    return bytes_reserved;
+}
+
+void* parse_arena_t::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    ++allocations;
+    bytes_allocated += bytes;
+
+    // Large requests get a block of their own, so that they neither waste
+    // the rest of the current block nor replace it
+    if (bytes + alignment > block_size / 2) {
+        std::size_t size = bytes + alignment;
+        blocks.push_back(block_t{std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+        bytes_reserved += size;
+        unsigned char *data = blocks.back().data.get();
+        return data + (alignment - (std::uintptr_t)data % alignment) % alignment;
+    }
+
+    std::size_t padding = (alignment - (std::uintptr_t)current % alignment) % alignment;
+    if (current == nullptr || padding + bytes > remaining) {
+        blocks.push_back(block_t{std::unique_ptr<unsigned char[]>(new unsigned char[block_size]), block_size});
+        bytes_reserved += block_size;
+        current = blocks.back().data.get();
+        remaining = block_size;
+        padding = (alignment - (std::uintptr_t)current % alignment) % alignment;
+    }
+
+    void *p = current + padding;
+    current += padding + bytes;
+    remaining -= padding + bytes;
+    return p;
+}
+
+void parse_arena_t::do_deallocate([[maybe_unused]] void *p, [[maybe_unused]] std::size_t bytes, [[maybe_unused]] std::size_t alignment)
+{}
+
+bool parse_arena_t::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+
+// -----
+} // namespace wi
@@ -0,0 +1,382 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "batch.hpp"
+
+#include <algorithm>
+
+namespace wi {
+// -----
+
+
+work_stealing_pool_t::work_stealing_pool_t(std::size_t threads)
+: worker_count(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+  shares(new share_t[worker_count]),
+  threads(),
+  task(nullptr),
+  generation(0),
+  running(0),
+  stopping(false),
+  failure(),
+  failed(false)
+{
+    for (std::size_t worker = 1; worker < worker_count; ++worker)
+        this->threads.emplace_back(&work_stealing_pool_t::thread_main, this, worker);
+}
+
+work_stealing_pool_t::~work_stealing_pool_t()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+std::size_t work_stealing_pool_t::get_thread_count() const
+{
+    return worker_count;
+}
+
+void work_stealing_pool_t::for_each(std::size_t count, const std::function<void(std::size_t)>& _task)
+{
+    std::lock_guard<std::mutex> call_guard(calls);
+    if (count == 0)
+        return;
+
+    // The workers are all idle, waiting for the next generation
+    for (std::size_t worker = 0; worker < worker_count; ++worker) {
+        shares[worker].begin = count * worker / worker_count;
+        shares[worker].end = count * (worker + 1) / worker_count;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        task = &_task;
+        running = worker_count - 1;
+        failure = nullptr;
+        failed = false;
+        ++generation;
+    }
+    wake.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this]() { return running == 0; });
+    task = nullptr;
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+bool work_stealing_pool_t::take(std::size_t worker, std::size_t& index)
+{
+    share_t& own = shares[worker];
+    {
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.begin < own.end) {
+            index = own.begin++;
+            return true;
+        }
+    }
+
+    for (std::size_t k = 1; k < worker_count; ++k) {
+        share_t& victim = shares[(worker + k) % worker_count];
+        std::size_t begin, end;
+        {
+            std::lock_guard<std::mutex> guard(victim.lock);
+            std::size_t left = victim.end - victim.begin;
+            if (left == 0)
+                continue;
+            end = victim.end;
+            begin = end - (left + 1) / 2;
+            victim.end = begin;
+        }
+        // Keeps the first stolen index and makes the rest its own share,
+        // which the others may steal from in turn
+        std::lock_guard<std::mutex> guard(own.lock);
+        own.begin = begin + 1;
+        own.end = end;
+        index = begin;
+        return true;
+    }
+    return false;
+}
+
+void work_stealing_pool_t::work(std::size_t worker)
+{
+    std::size_t index;
+    while (!failed.load(std::memory_order_relaxed) && take(worker, index)) {
+        try {
+            (*task)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!failure)
+                failure = std::current_exception();
+            failed = true;
+        }
+    }
+}
+
+void work_stealing_pool_t::thread_main(std::size_t worker)
+{
+    std::size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&]() { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        work(worker);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (--running == 0)
+                done.notify_all();
+        }
+    }
+}
+
+
+// -----
+
+
+std::vector<parser_state_t> parse_batch(const parser_t* parser, const std::vector<std::string_view>& documents, work_stealing_pool_t& pool, const parse_options_t& options)
+{
+    std::vector<parser_state_t> results(documents.size());
+    pool.for_each(documents.size(), [&](std::size_t i) {
+        parser_state_t parser_state;
+        parser_state.target_string = documents[i];
+        results[i] = parse(parser, std::move(parser_state), options);
+    });
+    return results;
+}
+
+std::vector<parser_state_t> parse_batch(const parser_t* parser, const std::vector<std::string_view>& documents, std::size_t threads, const parse_options_t& options)
+{
+    work_stealing_pool_t pool(threads);
+    return parse_batch(parser, documents, pool, options);
+}
+
+
+// -----
+
+
+record_boundary_t after_delimiter(char delimiter)
+{
+    return [delimiter](std::string_view input, std::size_t index) {
+        return index > 0 && input[index - 1] == delimiter;
+    };
+}
+
+namespace {
+
+// The elements starting in input[begin, limit)
+struct chunk_t {
+    std::size_t begin;
+    std::size_t limit;
+    std::vector<std::any> elements;
+    // Where the next element would begin (at or past limit), or, if the list
+    // ended in the chunk, the index it ended at
+    std::size_t stop;
+    bool ended;
+    parse_error_t error;
+    // Whether the error went past max_depth, which fails the whole list
+    bool too_deep;
+};
+
+class chunk_parser_t {
+    const parser_t *value_parser;
+    const parser_t *separator_parser;
+    std::string_view input;
+    parse_options_t options;
+
+public:
+    chunk_parser_t(const parser_t *list_parser, std::string_view _input, const parse_options_t& _options)
+    : value_parser(nullptr),
+      separator_parser(nullptr),
+      input(_input),
+      options(_options)
+    {
+        if (const separated_by_parser_t *separated_by = dynamic_cast<const separated_by_parser_t*>(list_parser)) {
+            value_parser = separated_by->get_value_parser();
+            separator_parser = separated_by->get_seaparator_parser();
+        } else if (const many_parser_t *many = dynamic_cast<const many_parser_t*>(list_parser)) {
+            value_parser = many->get_parser();
+        } else {
+            throw std::string("parse_chunked(): Expected a many_parser_t, many1_parser_t or separated_by_parser_t");
+        }
+        if (value_parser == nullptr || (separator_parser == nullptr && dynamic_cast<const separated_by_parser_t*>(list_parser)))
+            throw std::string("parse_chunked(): The list has a NULL parser");
+        if (options.on_event)
+            throw std::string("parse_chunked(): Event mode is not supported");
+        options.use_arena = false;
+    }
+
+    void parse(chunk_t& chunk) const
+    {
+        std::shared_ptr<parse_context_t> context = std::make_shared<parse_context_t>(options);
+        // The last chunk runs until the list ends
+        bool last = chunk.limit >= input.size();
+        std::size_t index = chunk.begin;
+        chunk.ended = true;
+        chunk.too_deep = false;
+        while (1) {
+            if (!last && index >= chunk.limit) {
+                chunk.ended = false;
+                break;
+            }
+            parser_state_t value_state = attempt(value_parser, index, context);
+            if (value_state.error.has_value()) {
+                chunk.error = value_state.error;
+                chunk.too_deep = context->depth_error.has_value();
+                break;
+            }
+            chunk.elements.emplace_back(std::move(value_state.result));
+            std::size_t next = value_state.index;
+            if (separator_parser != nullptr) {
+                parser_state_t separator_state = attempt(separator_parser, next, context);
+                if (separator_state.error.has_value()) {
+                    index = next;
+                    chunk.error = separator_state.error;
+                    chunk.too_deep = context->depth_error.has_value();
+                    break;
+                }
+                next = separator_state.index;
+            }
+            // An element matching nothing would be matched forever
+            if (next == index)
+                break;
+            index = next;
+        }
+        chunk.stop = index;
+    }
+
+private:
+    parser_state_t attempt(const parser_t *parser, std::size_t index, const std::shared_ptr<parse_context_t>& context) const
+    {
+        // The memo entries of the previous elements are never read again
+        if (context->memo_size() != 0)
+            context->clear_memo();
+        context->depth_error.reset();
+
+        parser_state_t parser_state;
+        parser_state.target_string = input;
+        parser_state.index = index;
+        parser_state.set_context(context);
+        parser_state = parser->apply(std::move(parser_state));
+        if (parser_state.error.has_value() && context->depth_error.has_value())
+            parser_state.error = context->depth_error;
+        return parser_state;
+    }
+};
+
+} // namespace
+
+chunked_result_t parse_chunked(const parser_t* list_parser, std::string_view input, record_boundary_t is_boundary,
+                               work_stealing_pool_t& pool, const parse_options_t& options, std::size_t chunk_size)
+{
+    chunk_parser_t chunk_parser(list_parser, input, options);
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+
+    std::vector<chunk_t> chunks;
+    std::size_t begin = 0;
+    while (1) {
+        std::size_t limit = begin + chunk_size;
+        while (limit < input.size() && !is_boundary(input, limit))
+            ++limit;
+        limit = std::min(limit, input.size());
+        chunks.push_back(chunk_t{begin, limit, {}, 0, false, parse_error_t(), false});
+        if (limit == input.size())
+            break;
+        begin = limit;
+    }
+
+    pool.for_each(chunks.size(), [&](std::size_t i) {
+        chunk_parser.parse(chunks[i]);
+    });
+
+    chunked_result_t chunked_result{parser_state_t(), parse_error_t(), chunks.size(), 0};
+    std::vector<std::any> elements;
+    std::size_t index = 0;
+    std::size_t next_chunk = 0;
+    parse_error_t depth_error;
+    while (1) {
+        // The chunks an element ran into are of no use
+        while (next_chunk < chunks.size() && chunks[next_chunk].begin < index)
+            ++next_chunk;
+
+        chunk_t resynchronized;
+        chunk_t *chunk = nullptr;
+        if (next_chunk < chunks.size() && chunks[next_chunk].begin == index) {
+            chunk = &chunks[next_chunk++];
+        } else {
+            resynchronized.begin = index;
+            resynchronized.limit = next_chunk < chunks.size() ? chunks[next_chunk].begin : input.size();
+            chunk_parser.parse(resynchronized);
+            chunk = &resynchronized;
+            ++chunked_result.resynchronized;
+        }
+
+        for (std::any& element : chunk->elements)
+            elements.emplace_back(std::move(element));
+        chunk->elements.clear();
+        index = chunk->stop;
+        if (chunk->ended) {
+            if (index < input.size())
+                chunked_result.stop_error = chunk->error;
+            if (chunk->too_deep)
+                depth_error = chunk->error;
+            break;
+        }
+    }
+
+    parser_state_t& parser_state = chunked_result.state;
+    parser_state.target_string = input;
+    parser_state.set_context(std::make_shared<parse_context_t>(options));
+    if (depth_error.has_value()) {
+        // Going past max_depth fails the whole list, as it does in run()
+        parser_state.index = depth_error.index;
+        parser_state.error = depth_error;
+    } else if (elements.empty() && dynamic_cast<const many1_parser_t*>(list_parser) != nullptr) {
+        // The first element failed, so this is quick, and reports the error
+        // exactly as run() does
+        parser_state = list_parser->apply(std::move(parser_state));
+    } else {
+        parser_state.index = index;
+        parser_state.set_result(std::move(elements));
+    }
+    return chunked_result;
+}
+
+chunked_result_t parse_chunked(const parser_t* list_parser, std::string_view input, record_boundary_t is_boundary,
+                               std::size_t threads, const parse_options_t& options, std::size_t chunk_size)
+{
+    work_stealing_pool_t pool(threads);
+    return parse_chunked(list_parser, input, is_boundary, pool, options, chunk_size);
+}
+
+
+// -----
+} // namespace wi
@@ -0,0 +1,327 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "char_class.hpp"
+
+#include <cctype>
+
+namespace wi {
+// -----
+
+
+namespace {
+
+// Adds the class denoted by a class escape (\s, \d, \w and their negations)
+bool add_class_escape(char_class_t& cls, char c)
+{
+    char_class_t aux;
+    switch (c) {
+    case 's': case 'S':
+        aux.add(' ').add_range('\t', '\r');
+        break;
+    case 'd': case 'D':
+        aux.add_range('0', '9');
+        break;
+    case 'w': case 'W':
+        aux.add_range('A', 'Z').add_range('a', 'z').add_range('0', '9').add('_');
+        break;
+    default:
+        return false;
+    }
+    if (c == 'S' || c == 'D' || c == 'W')
+        aux.negate();
+    cls.add_class(aux);
+    return true;
+}
+
+int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes the character escape starting right after the backslash at
+// pattern[i]; on success, i is moved past the escape
+bool character_escape(const std::string& pattern, std::size_t& i, unsigned char& c)
+{
+    if (i >= pattern.size())
+        return false;
+    switch (pattern[i]) {
+    case 't': c = '\t'; break;
+    case 'n': c = '\n'; break;
+    case 'r': c = '\r'; break;
+    case 'f': c = '\f'; break;
+    case 'v': c = '\v'; break;
+    case '0': c = '\0'; break;
+    case 'x': {
+        if (i + 2 >= pattern.size())
+            return false;
+        int hi = hex_value(pattern[i + 1]), lo = hex_value(pattern[i + 2]);
+        if (hi < 0 || lo < 0)
+            return false;
+        c = (unsigned char)(hi * 16 + lo);
+        i += 3;
+        return true;
+    }
+    default:
+        // Identity escapes: \\, \], \(, \., ...
+        if (std::isalnum((unsigned char)pattern[i]))
+            return false;
+        c = (unsigned char)pattern[i];
+    }
+    ++i;
+    return true;
+}
+
+// Compiles the supported subset of the ECMAScript syntax; returns false if
+// the pattern is anything else
+bool compile_pattern(const std::string& pattern, char_class_t& cls)
+{
+    std::size_t i = 0;
+    unsigned char c;
+
+    if (pattern.empty())
+        return false;
+
+    if (pattern == ".") {
+        cls.add('\n').add('\r').negate();
+        return true;
+    }
+
+    if (pattern[0] == '\\') {
+        i = 1;
+        if (i < pattern.size() && add_class_escape(cls, pattern[i]))
+            return pattern.size() == 2;
+        if (!character_escape(pattern, i, c))
+            return false;
+        cls.add(c);
+        return i == pattern.size();
+    }
+
+    if (pattern[0] != '[') {
+        if (pattern.size() != 1 || std::string("^$.*+?()[]{}|").find(pattern[0]) != std::string::npos)
+            return false;
+        cls.add((unsigned char)pattern[0]);
+        return true;
+    }
+
+    bool negated = false;
+    i = 1;
+    if (i < pattern.size() && pattern[i] == '^') {
+        negated = true;
+        ++i;
+    }
+
+    while (i < pattern.size() && pattern[i] != ']') {
+        // A class escape can't be the end of a range
+        if (pattern[i] == '\\' && i + 1 < pattern.size() && add_class_escape(cls, pattern[i + 1])) {
+            i += 2;
+            continue;
+        }
+
+        unsigned char first;
+        if (pattern[i] == '\\') {
+            ++i;
+            if (!character_escape(pattern, i, first))
+                return false;
+        } else if (pattern[i] == '[') {
+            return false; // [:alpha:] and friends
+        } else {
+            first = (unsigned char)pattern[i++];
+        }
+
+        if (i + 1 < pattern.size() && pattern[i] == '-' && pattern[i + 1] != ']') {
+            unsigned char last;
+            ++i;
+            if (pattern[i] == '\\') {
+                ++i;
+                if (!character_escape(pattern, i, last))
+                    return false;
+            } else {
+                last = (unsigned char)pattern[i++];
+            }
+            if (last < first)
+                return false;
+            cls.add_range(first, last);
+        } else {
+            cls.add(first);
+        }
+    }
+
+    if (i + 1 != pattern.size())
+        return false;
+    if (negated)
+        cls.negate();
+    return true;
+}
+
+std::string char_to_string(unsigned char c)
+{
+    switch (c) {
+    case '\t': return "\\t";
+    case '\n': return "\\n";
+    case '\r': return "\\r";
+    case '\f': return "\\f";
+    case '\v': return "\\v";
+    case '\\': case ']': case '[': case '^': case '-':
+        return std::string("\\") + (char)c;
+    }
+    if (c >= 0x20 && c < 0x7f)
+        return std::string(1, (char)c);
+    const char *digits = "0123456789abcdef";
+    return std::string("\\x") + digits[c >> 4] + digits[c & 15];
+}
+
+} // namespace
+
+
+// -----
+
+
+char_class_t::char_class_t()
+: bits{0, 0, 0, 0}
+{}
+
+char_class_t::char_class_t(const char *pattern)
+: char_class_t(std::string(pattern))
+{}
+
+char_class_t::char_class_t(const std::string& pattern)
+: bits{0, 0, 0, 0}
+{
+    if (!compile_pattern(pattern, *this))
+        *this = char_class_t(std::regex(pattern));
+}
+
+char_class_t::char_class_t(const std::regex& rexp)
+: bits{0, 0, 0, 0}
+{
+    // This is exactly what matching a single character against the regex
+    // used to do, only done once per byte value instead of once per input
+    std::string aux(1, '\0');
+    for (unsigned c = 0; c < 256; ++c) {
+        aux[0] = (char)c;
+        if (std::regex_search(aux, rexp))
+            add((unsigned char)c);
+    }
+}
+
+char_class_t& char_class_t::add(unsigned char c)
+{
+    bits[c >> 6] |= std::uint64_t(1) << (c & 63);
+    return *this;
+}
+
+char_class_t& char_class_t::add_range(unsigned char first, unsigned char last)
+{
+    for (unsigned c = first; c <= last; ++c)
+        add((unsigned char)c);
+    return *this;
+}
+
+char_class_t& char_class_t::add_class(const char_class_t& other)
+{
+    for (int i = 0; i < 4; ++i)
+        bits[i] |= other.bits[i];
+    return *this;
+}
+
+char_class_t& char_class_t::negate()
+{
+    for (int i = 0; i < 4; ++i)
+        bits[i] = ~bits[i];
+    return *this;
+}
+
+char_class_t& char_class_t::clear()
+{
+    for (int i = 0; i < 4; ++i)
+        bits[i] = 0;
+    return *this;
+}
+
+bool char_class_t::empty() const
+{
+    return (bits[0] | bits[1] | bits[2] | bits[3]) == 0;
+}
+
+std::size_t char_class_t::size() const
+{
+    std::size_t result = 0;
+    for (int i = 0; i < 4; ++i)
+        result += __builtin_popcountll(bits[i]);
+    return result;
+}
+
+const std::uint64_t* char_class_t::get_bits() const
+{
+    return bits;
+}
+
+bool char_class_t::operator==(const char_class_t& other) const
+{
+    for (int i = 0; i < 4; ++i) {
+        if (bits[i] != other.bits[i])
+            return false;
+    }
+    return true;
+}
+
+bool char_class_t::operator!=(const char_class_t& other) const
+{
+    return !(*this == other);
+}
+
+std::string char_class_t::to_string() const
+{
+    // Large classes read better as the negation of their complement
+    if (size() > 128) {
+        char_class_t complement = *this;
+        std::string aux = complement.negate().to_string();
+        return "[^" + aux.substr(1);
+    }
+
+    std::string result = "[";
+    for (unsigned c = 0; c < 256; ++c) {
+        if (!contains((unsigned char)c))
+            continue;
+        unsigned last = c;
+        while (last + 1 < 256 && contains((unsigned char)(last + 1)))
+            ++last;
+        result += char_to_string((unsigned char)c);
+        if (last >= c + 2)
+            result += "-";
+        if (last >= c + 1)
+            result += char_to_string((unsigned char)last);
+        c = last;
+    }
+    return result + "]";
+}
+
+
+// -----
+} // namespace wi
@@ -0,0 +1,258 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "class_scanner.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define _WI_SCAN_X86_
+#include <immintrin.h>
+#endif
+
+namespace wi {
+// -----
+
+
+namespace {
+
+std::size_t scan_scalar(const char_class_t& char_class, const char *s, std::size_t from, std::size_t size)
+{
+    while (from < size && char_class.contains((unsigned char)s[from]))
+        ++from;
+    return from;
+}
+
+#ifdef _WI_SCAN_X86_
+
+// For a byte c, low_nibble_masks[c >> 7][c & 15] holds bit ((c >> 4) & 7)
+// if c is a member of the class. The lookup of the high nibble bit is done
+// with a second shuffle, through the table below.
+const std::uint8_t high_nibble_bits[16] = {
+    1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+};
+
+// Tests the 16 bytes at s; returns a bit mask of the non-members
+__attribute__((target("ssse3")))
+unsigned outside_16(const std::uint8_t (*masks)[16], const char *s)
+{
+    const __m128i mask_low = _mm_load_si128((const __m128i*)masks[0]);
+    const __m128i mask_high = _mm_load_si128((const __m128i*)masks[1]);
+    const __m128i bits = _mm_loadu_si128((const __m128i*)high_nibble_bits);
+    __m128i v = _mm_loadu_si128((const __m128i*)s);
+    __m128i t = _mm_or_si128(_mm_shuffle_epi8(mask_low, v),
+                             _mm_shuffle_epi8(mask_high, _mm_xor_si128(v, _mm_set1_epi8((char)0x80))));
+    __m128i h = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(t, h), _mm_setzero_si128()));
+}
+
+__attribute__((target("ssse3")))
+std::size_t scan_ssse3(const char_class_t& char_class, const std::uint8_t (*masks)[16], const char *s, std::size_t from, std::size_t size)
+{
+    const __m128i mask_low = _mm_load_si128((const __m128i*)masks[0]);
+    const __m128i mask_high = _mm_load_si128((const __m128i*)masks[1]);
+    const __m128i bits = _mm_loadu_si128((const __m128i*)high_nibble_bits);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i top = _mm_set1_epi8((char)0x80);
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; from + 16 <= size; from += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + from));
+        // pshufb yields 0 for indices with the top bit set, so each table
+        // only answers for its half of the byte values
+        __m128i t = _mm_or_si128(_mm_shuffle_epi8(mask_low, v),
+                                 _mm_shuffle_epi8(mask_high, _mm_xor_si128(v, top)));
+        __m128i h = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        unsigned outside = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(t, h), zero));
+        if (outside != 0)
+            return from + __builtin_ctz(outside);
+    }
+    return scan_scalar(char_class, s, from, size);
+}
+
+__attribute__((target("avx2")))
+std::size_t scan_avx2(const char_class_t& char_class, const std::uint8_t (*masks)[16], const char *s, std::size_t from, std::size_t size)
+{
+    // Most runs are short, so probe them with a narrow vector first
+    if (from + 16 <= size) {
+        unsigned outside = outside_16(masks, s + from);
+        if (outside != 0)
+            return from + __builtin_ctz(outside);
+        from += 16;
+    }
+
+    const __m256i mask_low = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)masks[0]));
+    const __m256i mask_high = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)masks[1]));
+    const __m256i bits = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)high_nibble_bits));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i top = _mm256_set1_epi8((char)0x80);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (; from + 32 <= size; from += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + from));
+        __m256i t = _mm256_or_si256(_mm256_shuffle_epi8(mask_low, v),
+                                    _mm256_shuffle_epi8(mask_high, _mm256_xor_si256(v, top)));
+        __m256i h = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        unsigned outside = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(t, h), zero));
+        if (outside != 0)
+            return from + __builtin_ctz(outside);
+    }
+    return scan_ssse3(char_class, masks, s, from, size);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+std::size_t scan_avx512(const char_class_t& char_class, const std::uint8_t (*masks)[16], const char *s, std::size_t from, std::size_t size)
+{
+    if (from + 16 <= size) {
+        unsigned outside = outside_16(masks, s + from);
+        if (outside != 0)
+            return from + __builtin_ctz(outside);
+        from += 16;
+    }
+
+    const __m512i mask_low = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128((const __m128i*)masks[0]));
+    const __m512i mask_high = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128((const __m128i*)masks[1]));
+    const __m512i bits = _mm512_maskz_broadcast_i32x4(0xffff, _mm_loadu_si128((const __m128i*)high_nibble_bits));
+    const __m512i nibble = _mm512_set1_epi8(0x0f);
+    const __m512i top = _mm512_set1_epi8((char)0x80);
+
+    for (; from + 64 <= size; from += 64) {
+        __m512i v = _mm512_loadu_si512((const void*)(s + from));
+        __m512i t = _mm512_or_si512(_mm512_shuffle_epi8(mask_low, v),
+                                    _mm512_shuffle_epi8(mask_high, _mm512_xor_si512(v, top)));
+        __m512i h = _mm512_shuffle_epi8(bits, _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble));
+        std::uint64_t outside = ~(std::uint64_t)_mm512_test_epi8_mask(t, h);
+        if (outside != 0)
+            return from + __builtin_ctzll(outside);
+    }
+    return scan_avx2(char_class, masks, s, from, size);
+}
+
+#endif // _WI_SCAN_X86_
+
+} // namespace
+
+
+// -----
+
+
+const char* scan_isa_name(scan_isa_t isa)
+{
+    switch (isa) {
+    case scan_isa_t::scalar: return "scalar";
+    case scan_isa_t::ssse3: return "ssse3";
+    case scan_isa_t::avx2: return "avx2";
+    case scan_isa_t::avx512: return "avx512";
+    }
+    return "??";
+}
+
+bool scan_isa_supported(scan_isa_t isa)
+{
+#ifdef _WI_SCAN_X86_
+    switch (isa) {
+    case scan_isa_t::scalar: return true;
+    case scan_isa_t::ssse3: return __builtin_cpu_supports("ssse3");
+    case scan_isa_t::avx2: return __builtin_cpu_supports("avx2");
+    case scan_isa_t::avx512: return __builtin_cpu_supports("avx512bw");
+    }
+    return false;
+#else
+    return isa == scan_isa_t::scalar;
+#endif
+}
+
+scan_isa_t scan_best_isa()
+{
+    static const scan_isa_t best = []() {
+        for (scan_isa_t isa : {scan_isa_t::avx512, scan_isa_t::avx2, scan_isa_t::ssse3}) {
+            if (scan_isa_supported(isa))
+                return isa;
+        }
+        return scan_isa_t::scalar;
+    }();
+    return best;
+}
+
+
+// -----
+
+
+class_scanner_t::class_scanner_t()
+: class_scanner_t(char_class_t())
+{}
+
+class_scanner_t::class_scanner_t(char_class_t _char_class)
+: char_class(_char_class),
+  low_nibble_masks{},
+  isa(scan_best_isa())
+{
+    for (unsigned c = 0; c < 256; ++c) {
+        if (char_class.contains((unsigned char)c))
+            low_nibble_masks[c >> 7][c & 15] |= (std::uint8_t)(1 << ((c >> 4) & 7));
+    }
+}
+
+std::size_t class_scanner_t::scan(std::string_view s, std::size_t from) const
+{
+    return scan(s, from, isa);
+}
+
+std::size_t class_scanner_t::scan(std::string_view s, std::size_t from, scan_isa_t _isa) const
+{
+    if (from >= s.size())
+        return s.size();
+    // Most runs are short: don't bother with vectors before the first miss
+    if (!char_class.contains((unsigned char)s[from]))
+        return from;
+
+    switch (_isa) {
+#ifdef _WI_SCAN_X86_
+    case scan_isa_t::avx512:
+        return scan_avx512(char_class, low_nibble_masks, s.data(), from, s.size());
+    case scan_isa_t::avx2:
+        return scan_avx2(char_class, low_nibble_masks, s.data(), from, s.size());
+    case scan_isa_t::ssse3:
+        return scan_ssse3(char_class, low_nibble_masks, s.data(), from, s.size());
+#endif
+    default:
+        return scan_scalar(char_class, s.data(), from, s.size());
+    }
+}
+
+const char_class_t& class_scanner_t::get_char_class() const
+{
+    return char_class;
+}
+
+scan_isa_t class_scanner_t::get_isa() const
+{
+    return isa;
+}
+
+class_scanner_t& class_scanner_t::set_isa(scan_isa_t _isa)
+{
+    isa = scan_isa_supported(_isa) ? _isa : scan_best_isa();
+    return *this;
+}
+
+
+// -----
+} // namespace wi
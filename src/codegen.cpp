@@ -0,0 +1,382 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "codegen.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+
+namespace wi {
+// -----
+
+
+namespace {
+
+// A C++ string literal holding exactly the bytes of s; anything that is not
+// printable ASCII becomes a 3-digit octal escape, which cannot run into the
+// next character
+std::string cpp_string_literal(std::string_view s)
+{
+    std::stringstream ss;
+    ss << "\"";
+    for (char c : s) {
+        unsigned char u = (unsigned char)c;
+        if (c == '"' || c == '\\')
+            ss << '\\' << c;
+        else if (u >= 0x20 && u < 0x7F && c != '?')
+            ss << c;
+        else
+            ss << '\\' << std::oct << std::setw(3) << std::setfill('0') << (unsigned)u << std::dec;
+    }
+    ss << "\"";
+    return ss.str();
+}
+
+// The code of the helpers every generated parser uses
+const char *generated_helpers = R"(inline bool in_class(const std::uint64_t *bits, char c)
+{
+    unsigned char u = (unsigned char)c;
+    return (bits[u >> 6] >> (u & 63)) & 1;
+}
+
+inline bool starts_with(std::string_view s, std::string_view prefix, std::size_t index)
+{
+    return index + prefix.size() <= s.size() && s.compare(index, prefix.size(), prefix) == 0;
+}
+
+inline void flatten_into(const std::any& value, std::vector<std::any>& results)
+{
+    if (const std::vector<std::any> *values = std::any_cast< std::vector<std::any> >(&value)) {
+        for (const std::any& x : *values)
+            flatten_into(x, results);
+    } else {
+        results.push_back(value);
+    }
+}
+
+inline std::vector<std::any> flatten(const std::any& value)
+{
+    std::vector<std::any> results;
+    flatten_into(value, results);
+    return results;
+}
+)";
+
+} // namespace
+
+
+// -----
+
+
+cpp_generator_t::cpp_generator_t(codegen_options_t _options)
+: options(_options),
+  nodes(),
+  ids(),
+  classes(),
+  map_functions(),
+  forwards(false)
+{}
+
+const std::vector<std::pair<std::string, const map_parser_t*>>& cpp_generator_t::get_map_functions() const
+{
+    return map_functions;
+}
+
+std::string cpp_generator_t::generate(const parser_t *root)
+{
+    if (root == nullptr)
+        throw std::string("cpp_generator_t::generate(): root is NULL");
+
+    nodes.clear();
+    ids.clear();
+    classes.clear();
+    map_functions.clear();
+    forwards = false;
+    visit_grammar(root, [&](const parser_t *parser) {
+        ids[parser] = nodes.size();
+        nodes.push_back(parser);
+        if (parser->forwards_result())
+            forwards = true;
+    });
+
+    // Alternatives that cannot start with the next byte are skipped, as with
+    // the dispatch tables
+    first_set_analysis_t analysis(root);
+    std::stringstream body;
+    for (std::size_t id = 0; id < nodes.size(); ++id)
+        generate_node(body, id, analysis);
+
+    std::string guard = options.namespace_name;
+    std::transform(guard.begin(), guard.end(), guard.begin(), [](unsigned char c) { return std::toupper(c); });
+    guard = "_" + guard + "_HPP_";
+
+    std::stringstream ss;
+    ss << "// Generated by WiParser (cpp_generator_t) from a grammar of "
+       << nodes.size() << " nodes; do not edit.\n\n";
+    ss << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+    ss << "#include <string_view>\n#include <algorithm>\n#include <cstdint>\n#include <cstddef>\n"
+       << "#include <utility>\n#include <string>\n#include <vector>\n#include <any>\n\n\n";
+    ss << "namespace " << options.namespace_name << " {\n\n";
+    if (!map_functions.empty()) {
+        ss << "// The functions of the maps, to be defined by the user\n";
+        for (const auto& [name, map] : map_functions)
+            ss << "std::any " << name << "(std::any value);\n";
+        ss << "\n";
+    }
+
+    ss << "namespace detail {\n\n" << generated_helpers << "\n";
+    for (const auto& [bits, id] : classes) {
+        ss << "inline constexpr std::uint64_t class_" << id << "[4] = {";
+        for (std::size_t k = 0; k < bits.size(); ++k)
+            ss << (k == 0 ? "" : ", ") << "0x" << std::hex << bits[k] << std::dec << "ull";
+        ss << "};\n";
+    }
+    ss << "\n";
+    for (std::size_t id = 0; id < nodes.size(); ++id)
+        ss << "inline bool node_" << id << "(std::string_view s, std::size_t& i, std::any& r);\n";
+    ss << "\n" << body.str();
+    ss << "} // namespace detail\n\n";
+
+    ss << "// Matches input[index...]; on success, moves index past the match and\n"
+       << "// stores the result\n"
+       << "inline bool parse(std::string_view input, std::size_t& index, std::any& result)\n"
+       << "{\n"
+       << "    std::size_t i = index;\n"
+       << (forwards ? "    std::any r = result;\n" : "    std::any r;\n")
+       << "    if (!detail::node_0(input, i, r))\n"
+       << "        return false;\n"
+       << "    index = i;\n"
+       << "    result = std::move(r);\n"
+       << "    return true;\n"
+       << "}\n\n";
+    ss << "} // namespace " << options.namespace_name << "\n";
+    ss << "#endif // " << guard << "\n";
+    return ss.str();
+}
+
+std::string cpp_generator_t::call(const parser_t *parser) const
+{
+    if (parser == nullptr)
+        throw std::string("cpp_generator_t::generate(): the grammar contains a NULL parser");
+    return "node_" + std::to_string(ids.at(parser)) + "(s, i, r)";
+}
+
+std::string cpp_generator_t::class_name(const char_class_t& char_class)
+{
+    std::vector<std::uint64_t> bits(char_class.get_bits(), char_class.get_bits() + 4);
+    auto it = classes.find(bits);
+    if (it == classes.end())
+        it = classes.emplace(bits, classes.size()).first;
+    return "class_" + std::to_string(it->second);
+}
+
+void cpp_generator_t::generate_node(std::stringstream& ss, std::size_t id, const first_set_analysis_t& analysis)
+{
+    const parser_t *parser = nodes[id];
+    // A result read by a later node is copied, otherwise it is moved
+    const char *take = forwards ? "r" : "std::move(r)";
+
+    ss << "// #" << id << " " << parser->get_name() << "\n";
+    if (dynamic_cast<const do_nothing_parser_t*>(parser) != nullptr) {
+        ss << "inline bool node_" << id << "(std::string_view, std::size_t&, std::any&)\n{\n"
+           << "    return true;\n}\n\n";
+        return;
+    }
+    ss << "inline bool node_" << id << "(std::string_view s, std::size_t& i, std::any& r)\n{\n";
+
+    if (const lazy_parser_t *lazy = dynamic_cast<const lazy_parser_t*>(parser)) {
+        ss << "    return " << call(lazy->get_parser()) << ";\n";
+
+    } else if (const map_parser_t *map = dynamic_cast<const map_parser_t*>(parser)) {
+        if (map->is_identity()) {
+            ss << "    return " << call(map->get_parser()) << ";\n";
+        } else {
+            std::string name = "map_" + std::to_string(id);
+            map_functions.push_back({name, map});
+            ss << "    if (!" << call(map->get_parser()) << ")\n"
+               << "        return false;\n"
+               << "    r = " << name << "(std::move(r));\n"
+               << "    return true;\n";
+        }
+
+    } else if (const flatten_parser_t *flatten = dynamic_cast<const flatten_parser_t*>(parser)) {
+        ss << "    if (!" << call(flatten->get_parser()) << ")\n"
+           << "        return false;\n"
+           << "    r = flatten(r);\n"
+           << "    return true;\n";
+
+    } else if (const sequence_of_parser_t *sequence = dynamic_cast<const sequence_of_parser_t*>(parser)) {
+        const std::vector<const parser_t*>& parsers = sequence->get_parsers();
+        ss << "    std::vector<std::any> results;\n"
+           << "    results.reserve(" << parsers.size() << ");\n";
+        for (std::size_t i = 0; i < parsers.size(); ++i) {
+            // The same node may appear several times; only the last one may
+            // move the result away
+            ss << "    if (!" << call(parsers[i]) << ")\n"
+               << "        return false;\n"
+               << "    results.push_back(" << (i + 1 == parsers.size() ? "std::move(r)" : take) << ");\n";
+        }
+        ss << "    r = std::move(results);\n"
+           << "    return true;\n";
+
+    } else if (const choice_of_parser_t *choice = dynamic_cast<const choice_of_parser_t*>(parser)) {
+        ss << "    const std::size_t start = i;\n";
+        if (forwards)
+            ss << "    const std::any incoming = r;\n";
+        for (const parser_t *child : choice->get_parsers()) {
+            first_set_t first = analysis.get(child);
+            std::string indent = "    ";
+            if (!first.nullable) {
+                ss << "    if (i < s.size() && in_class(" << class_name(first.bytes) << ", s[i])) {\n";
+                indent = "        ";
+            }
+            ss << indent << "if (" << call(child) << ")\n"
+               << indent << "    return true;\n"
+               << indent << "i = start;\n";
+            if (forwards)
+                ss << indent << "r = incoming;\n";
+            if (!first.nullable)
+                ss << "    }\n";
+        }
+        ss << "    return false;\n";
+
+    } else if (const many_parser_t *many = dynamic_cast<const many_parser_t*>(parser)) {
+        ss << "    std::vector<std::any> results;\n"
+           << "    while (1) {\n"
+           << "        const std::size_t start = i;\n"
+           << "        if (!" << call(many->get_parser()) << ") {\n"
+           << "            i = start;\n"
+           << "            break;\n"
+           << "        }\n"
+           << "        results.push_back(" << take << ");\n"
+           << "    }\n";
+        if (dynamic_cast<const many1_parser_t*>(parser) != nullptr)
+            ss << "    if (results.empty())\n"
+               << "        return false;\n";
+        ss << "    r = std::move(results);\n"
+           << "    return true;\n";
+
+    } else if (const between_parser_t *between = dynamic_cast<const between_parser_t*>(parser)) {
+        ss << "    if (!" << call(between->get_left_parser()) << " || !" << call(between->get_content_parser()) << ")\n"
+           << "        return false;\n"
+           << "    std::any content = " << take << ";\n"
+           << "    if (!" << call(between->get_right_parser()) << ")\n"
+           << "        return false;\n"
+           << "    r = std::move(content);\n"
+           << "    return true;\n";
+
+    } else if (const separated_by_parser_t *separated_by = dynamic_cast<const separated_by_parser_t*>(parser)) {
+        if (separated_by->get_value_parser() == nullptr || separated_by->get_seaparator_parser() == nullptr) {
+            // An error for run() as well
+            ss << "    return false;\n";
+        } else {
+            ss << "    std::vector<std::any> results;\n"
+               << "    while (1) {\n"
+               << "        std::size_t start = i;\n"
+               << "        if (!" << call(separated_by->get_value_parser()) << ") {\n"
+               << "            i = start;\n"
+               << "            break;\n"
+               << "        }\n"
+               << "        results.push_back(" << take << ");\n"
+               << "        start = i;\n"
+               << "        if (!" << call(separated_by->get_seaparator_parser()) << ") {\n"
+               << "            i = start;\n"
+               << "            break;\n"
+               << "        }\n"
+               << "    }\n"
+               << "    r = std::move(results);\n"
+               << "    return true;\n";
+        }
+
+    } else if (const string_parser_t *string = dynamic_cast<const string_parser_t*>(parser)) {
+        std::string literal = cpp_string_literal(string->get_string());
+        std::size_t size = string->get_string().size();
+        ss << "    if (s.size() == 0 || !starts_with(s, std::string_view(" << literal << ", " << size << "), i))\n"
+           << "        return false;\n"
+           << "    r = std::string(" << literal << ", " << size << ");\n"
+           << "    i += " << size << ";\n"
+           << "    return true;\n";
+
+    } else if (const choice_of_string_parser_t *words = dynamic_cast<const choice_of_string_parser_t*>(parser)) {
+        // The first listed word that matches or, in longest mode, the first
+        // one of the longest words that match
+        std::vector<std::string> order = words->get_words();
+        if (words->get_match_mode() == choice_of_string_parser_t::match_mode_t::longest) {
+            std::stable_sort(order.begin(), order.end(), [](const std::string& a, const std::string& b) {
+                return a.size() > b.size();
+            });
+        }
+        ss << "    if (s.size() == 0 || i > s.size())\n"
+           << "        return false;\n";
+        for (const std::string& word : order) {
+            std::string literal = cpp_string_literal(word);
+            ss << "    if (starts_with(s, std::string_view(" << literal << ", " << word.size() << "), i)) {\n"
+               << "        r = std::string(" << literal << ", " << word.size() << ");\n"
+               << "        i += " << word.size() << ";\n"
+               << "        return true;\n"
+               << "    }\n";
+        }
+        ss << "    return false;\n";
+
+    } else if (const char_parser_t *char_parser = dynamic_cast<const char_parser_t*>(parser)) {
+        ss << "    if (i >= s.size() || !in_class(" << class_name(char_parser->get_char_class()) << ", s[i]))\n"
+           << "        return false;\n"
+           << "    r = std::string(1, s[i]);\n"
+           << "    ++i;\n"
+           << "    return true;\n";
+
+    } else if (const chars_parser_t *chars = dynamic_cast<const chars_parser_t*>(parser)) {
+        ss << "    std::size_t end = i;\n"
+           << "    while (end < s.size() && in_class(" << class_name(chars->get_char_class()) << ", s[end]))\n"
+           << "        ++end;\n"
+           << "    if (end == i || i >= s.size())\n"
+           << "        return false;\n"
+           << "    r = std::string(s.substr(i, end - i));\n"
+           << "    i = end;\n"
+           << "    return true;\n";
+
+    } else if (const maybe_chars_parser_t *maybe_chars = dynamic_cast<const maybe_chars_parser_t*>(parser)) {
+        ss << "    const std::size_t begin = std::min(i, s.size());\n"
+           << "    std::size_t end = begin;\n"
+           << "    while (end < s.size() && in_class(" << class_name(maybe_chars->get_char_class()) << ", s[end]))\n"
+           << "        ++end;\n"
+           << "    r = std::string(s.substr(begin, end - begin));\n"
+           << "    i = std::max(end, i);\n"
+           << "    return true;\n";
+
+    } else {
+        // chain_parser_t included: its parser is only known at run time
+        throw std::string("cpp_generator_t::generate(): can't generate code for ") + parser->get_name();
+    }
+
+    ss << "}\n\n";
+}
+
+std::string generate_cpp(const parser_t *root, codegen_options_t options)
+{
+    return cpp_generator_t(options).generate(root);
+}
+
+
+// -----
+} // namespace wi
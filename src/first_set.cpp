@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "first_set.hpp"
+#include "parser.hpp"
+
+#include <unordered_set>
+
+namespace wi {
+// -----
+
+
+first_set_t first_set_t::any()
+{
+    first_set_t result;
+    result.bytes.negate();
+    result.nullable = true;
+    return result;
+}
+
+bool first_set_t::viable(std::size_t slot) const
+{
+    return nullable || (slot < 256 && bytes.contains((unsigned char)slot));
+}
+
+bool first_set_t::operator==(const first_set_t& other) const
+{
+    return nullable == other.nullable && bytes == other.bytes;
+}
+
+bool first_set_t::operator!=(const first_set_t& other) const
+{
+    return !(*this == other);
+}
+
+
+// -----
+
+
+first_set_analysis_t::first_set_analysis_t(const parser_t *root)
+: nodes(),
+  sets(),
+  iterations(0)
+{
+    // Post-order, so that most children are done before their parents and
+    // the fixpoint only takes extra passes for the recursive parts
+    std::unordered_set<const parser_t*> visited;
+    std::vector< std::pair<const parser_t*, bool> > stack;
+    if (root != nullptr)
+        stack.push_back({root, false});
+    while (!stack.empty()) {
+        auto [parser, expanded] = stack.back();
+        stack.pop_back();
+        if (expanded) {
+            nodes.push_back(parser);
+            continue;
+        }
+        if (!visited.insert(parser).second)
+            continue;
+        stack.push_back({parser, true});
+        for (const parser_t *child : parser->get_children()) {
+            if (child != nullptr && visited.count(child) == 0)
+                stack.push_back({child, false});
+        }
+    }
+
+    for (const parser_t *parser : nodes)
+        sets[parser] = first_set_t();
+
+    // Every rule is monotone and the sets can only grow, so this ends
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        ++iterations;
+        for (const parser_t *parser : nodes) {
+            first_set_t first = parser->first_set(*this);
+            first_set_t& current = sets[parser];
+            if (first != current) {
+                current = first;
+                changed = true;
+            }
+        }
+    }
+}
+
+first_set_t first_set_analysis_t::get(const parser_t *parser) const
+{
+    auto it = sets.find(parser);
+    if (it == sets.end())
+        return first_set_t::any();
+    return it->second;
+}
+
+std::size_t first_set_analysis_t::node_count() const
+{
+    return nodes.size();
+}
+
+std::size_t first_set_analysis_t::get_iterations() const
+{
+    return iterations;
+}
+
+void first_set_analysis_t::build_dispatch_tables() const
+{
+    for (const parser_t *parser : nodes) {
+        const choice_of_parser_t *choice = dynamic_cast<const choice_of_parser_t*>(parser);
+        if (choice == nullptr)
+            continue;
+        std::vector<first_set_t> alternative_sets;
+        for (const parser_t *alternative : choice->get_children())
+            alternative_sets.push_back(get(alternative));
+        choice->set_dispatch_table(std::make_shared<const dispatch_table_t>(alternative_sets));
+    }
+}
+
+
+// -----
+
+
+dispatch_table_t::dispatch_table_t(const std::vector<first_set_t>& alternative_sets)
+: offsets(),
+  alternatives()
+{
+    for (std::size_t slot = 0; slot <= 256; ++slot) {
+        offsets[slot] = (std::uint32_t)alternatives.size();
+        for (std::size_t i = 0; i < alternative_sets.size(); ++i) {
+            if (alternative_sets[i].viable(slot))
+                alternatives.push_back((std::uint32_t)i);
+        }
+    }
+    offsets[257] = (std::uint32_t)alternatives.size();
+}
+
+
+// -----
+
+
+void build_dispatch_tables(const parser_t *root)
+{
+    first_set_analysis_t(root).build_dispatch_tables();
+}
+
+
+// -----
+} // namespace wi
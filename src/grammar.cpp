@@ -0,0 +1,193 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "grammar.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <sstream>
+
+namespace wi {
+// -----
+
+
+grammar_t::grammar_t(std::size_t _block_size)
+: block_size(_block_size),
+  blocks(),
+  destructors(),
+  node_count(0),
+  bytes_used(0)
+{}
+
+grammar_t::grammar_t(grammar_t&& other)
+: block_size(other.block_size),
+  blocks(std::move(other.blocks)),
+  destructors(std::move(other.destructors)),
+  node_count(other.node_count),
+  bytes_used(other.bytes_used)
+{
+    other.blocks.clear();
+    other.destructors.clear();
+    other.node_count = 0;
+    other.bytes_used = 0;
+}
+
+grammar_t& grammar_t::operator=(grammar_t&& other)
+{
+    if (this == &other)
+        return *this;
+    clear();
+    block_size = other.block_size;
+    blocks = std::move(other.blocks);
+    destructors = std::move(other.destructors);
+    node_count = other.node_count;
+    bytes_used = other.bytes_used;
+    other.blocks.clear();
+    other.destructors.clear();
+    other.node_count = 0;
+    other.bytes_used = 0;
+    return *this;
+}
+
+grammar_t::~grammar_t()
+{
+    clear();
+}
+
+void* grammar_t::allocate(std::size_t size, std::size_t align)
+{
+    if (!blocks.empty()) {
+        block_t& block = blocks.back();
+        std::size_t offset = (block.used + align - 1) & ~(align - 1);
+        if (offset + size <= block.size) {
+            block.used = offset + size;
+            bytes_used += size;
+            return block.data.get() + offset;
+        }
+    }
+
+    // Blocks come from operator new[], aligned to
+    // __STDCPP_DEFAULT_NEW_ALIGNMENT__ only (make() rejects more demanding
+    // nodes); oversized nodes get a block of their own
+    std::size_t new_size = std::max(block_size, size);
+    blocks.push_back(block_t{std::unique_ptr<unsigned char[]>(new unsigned char[new_size]), new_size, size});
+    bytes_used += size;
+    return blocks.back().data.get();
+}
+
+parser_t* grammar_t::map(const parser_t *parser, std::function<std::any(std::any)> f)
+{
+    return make<map_parser_t>(parser, f);
+}
+
+parser_t* grammar_t::chain(const parser_t *parser, std::function<parser_t*(std::any)> f)
+{
+    return make<chain_parser_t>(parser, f);
+}
+
+grammar_t& grammar_t::clear()
+{
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+        it->destroy(it->node);
+    destructors.clear();
+    blocks.clear();
+    node_count = 0;
+    bytes_used = 0;
+    return *this;
+}
+
+std::size_t grammar_t::get_node_count() const
+{
+    return node_count;
+}
+
+std::size_t grammar_t::get_bytes_used() const
+{
+    return bytes_used;
+}
+
+std::size_t grammar_t::get_bytes_reserved() const
+{
+    std::size_t result = 0;
+    for (const block_t& block : blocks)
+        result += block.size;
+    return result;
+}
+
+
+
+// -----
+
+
+void visit_grammar(const parser_t *root, const std::function<void(const parser_t*)>& f)
+{
+    if (root == nullptr)
+        return;
+    std::unordered_set<const parser_t*> visited = {root};
+    std::vector<const parser_t*> stack = {root};
+    while (!stack.empty()) {
+        const parser_t *parser = stack.back();
+        stack.pop_back();
+        f(parser);
+        std::vector<const parser_t*> children = parser->get_children();
+        // Reversed, so that the first child is visited first
+        for (auto it = children.rbegin(); it != children.rend(); ++it) {
+            if (*it != nullptr && visited.insert(*it).second)
+                stack.push_back(*it);
+        }
+    }
+}
+
+std::string dump_grammar(const parser_t *root)
+{
+    std::vector<const parser_t*> nodes;
+    std::unordered_map<const parser_t*, std::size_t> ids;
+    visit_grammar(root, [&](const parser_t *parser) {
+        ids[parser] = nodes.size();
+        nodes.push_back(parser);
+    });
+
+    std::stringstream ss;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        ss << "#" << i << " " << nodes[i]->get_name();
+        std::vector<const parser_t*> children = nodes[i]->get_children();
+        if (!children.empty()) {
+            ss << " ->";
+            for (const parser_t *child : children) {
+                if (child == nullptr)
+                    ss << " null";
+                else
+                    ss << " #" << ids[child];
+            }
+        } else {
+            std::string expected = nodes[i]->describe_expected();
+            if (!expected.empty())
+                ss << ": " << expected;
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+// -----
+} // namespace wi
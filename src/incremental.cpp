@@ -0,0 +1,570 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#include "incremental.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace wi {
+// -----
+
+
+struct incremental_parser_t::text_node_t {
+    std::string bytes;
+    std::uint32_t priority;
+    std::unique_ptr<text_node_t> left;
+    std::unique_ptr<text_node_t> right;
+    // Of the subtree
+    std::size_t size;
+    std::size_t count;
+
+    std::size_t get_length() const
+    {
+        return bytes.size();
+    }
+
+    void update()
+    {
+        size = (left ? left->size : 0) + bytes.size() + (right ? right->size : 0);
+        count = (left ? left->count : 0) + 1 + (right ? right->count : 0);
+    }
+};
+
+struct incremental_parser_t::element_node_t {
+    std::any result;
+    // From the end of the previous element (or the beginning of the text):
+    // the bytes of its separator and value, and how far they looked
+    std::size_t length;
+    std::size_t extent;
+    std::uint32_t priority;
+    std::unique_ptr<element_node_t> left;
+    std::unique_ptr<element_node_t> right;
+    // Of the subtree; reach is how far its elements looked, from where the
+    // first one begins
+    std::size_t size;
+    std::size_t count;
+    std::size_t reach;
+
+    std::size_t get_length() const
+    {
+        return length;
+    }
+
+    void update()
+    {
+        std::size_t left_size = left ? left->size : 0;
+        size = left_size + length + (right ? right->size : 0);
+        count = (left ? left->count : 0) + 1 + (right ? right->count : 0);
+        reach = std::max(left ? left->reach : 0, left_size + extent);
+        if (right)
+            reach = std::max(reach, left_size + length + right->reach);
+    }
+};
+
+
+// -----
+
+
+namespace {
+
+// The text is kept in pieces of at most this many bytes
+const std::size_t piece_size = 1024;
+// The text read around an edit at first; more is read as the attempts need
+const std::size_t window_size = 256;
+
+std::uint32_t next_priority(std::uint32_t& seed)
+{
+    // xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+// The trees are treaps: in order of position, and in heap order of random
+// priorities, which keeps them balanced (expectedly) through any edits
+template<typename N>
+std::size_t size_of(const std::unique_ptr<N>& node)
+{
+    return node ? node->size : 0;
+}
+
+template<typename N>
+std::size_t count_of(const std::unique_ptr<N>& node)
+{
+    return node ? node->count : 0;
+}
+
+template<typename N>
+std::unique_ptr<N> merge(std::unique_ptr<N> left, std::unique_ptr<N> right)
+{
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+    if (left->priority > right->priority) {
+        left->right = merge(std::move(left->right), std::move(right));
+        left->update();
+        return left;
+    }
+    right->left = merge(std::move(left), std::move(right->left));
+    right->update();
+    return right;
+}
+
+// The first count nodes, and the others
+template<typename N>
+std::pair<std::unique_ptr<N>, std::unique_ptr<N>> split(std::unique_ptr<N> node, std::size_t count)
+{
+    if (!node)
+        return {nullptr, nullptr};
+    std::size_t left_count = count_of(node->left);
+    if (count <= left_count) {
+        std::pair<std::unique_ptr<N>, std::unique_ptr<N>> parts = split(std::move(node->left), count);
+        node->left = std::move(parts.second);
+        node->update();
+        return {std::move(parts.first), std::move(node)};
+    }
+    std::pair<std::unique_ptr<N>, std::unique_ptr<N>> parts = split(std::move(node->right), count - left_count - 1);
+    node->right = std::move(parts.first);
+    node->update();
+    return {std::move(node), std::move(parts.second)};
+}
+
+// How many nodes begin before position
+template<typename N>
+std::size_t count_before(const N *node, std::size_t position)
+{
+    std::size_t count = 0;
+    std::size_t base = 0;
+    while (node != nullptr) {
+        std::size_t begin = base + size_of(node->left);
+        if (begin < position) {
+            count += count_of(node->left) + 1;
+            base = begin + node->get_length();
+            node = node->right.get();
+        } else {
+            node = node->left.get();
+        }
+    }
+    return count;
+}
+
+// The index of the first element that looked past offset, or the number of
+// elements if none did
+template<typename N>
+std::size_t first_reaching(const N *node, std::size_t offset)
+{
+    std::size_t index = 0;
+    std::size_t base = 0;
+    while (node != nullptr) {
+        std::size_t left_size = size_of(node->left);
+        if (node->left && base + node->left->reach > offset) {
+            node = node->left.get();
+        } else if (base + left_size + node->extent > offset) {
+            return index + count_of(node->left);
+        } else {
+            index += count_of(node->left) + 1;
+            base += left_size + node->length;
+            node = node->right.get();
+        }
+    }
+    return index;
+}
+
+template<typename N>
+std::unique_ptr<N> make_pieces(std::string_view bytes, std::uint32_t& seed)
+{
+    std::unique_ptr<N> pieces;
+    for (std::size_t i = 0; i < bytes.size(); i += piece_size) {
+        std::unique_ptr<N> piece = std::make_unique<N>();
+        piece->bytes = std::string(bytes.substr(i, piece_size));
+        piece->priority = next_priority(seed);
+        piece->update();
+        pieces = merge(std::move(pieces), std::move(piece));
+    }
+    return pieces;
+}
+
+// The text before position, and from it on, a piece being cut in two if it
+// spans it
+template<typename N>
+std::pair<std::unique_ptr<N>, std::unique_ptr<N>> split_text(std::unique_ptr<N> text, std::size_t position, std::uint32_t& seed)
+{
+    std::size_t count = count_before(text.get(), position);
+    std::pair<std::unique_ptr<N>, std::unique_ptr<N>> parts = split(std::move(text), count);
+    if (size_of(parts.first) > position) {
+        std::pair<std::unique_ptr<N>, std::unique_ptr<N>> last = split(std::move(parts.first), count - 1);
+        std::size_t cut = position - size_of(last.first);
+        std::unique_ptr<N> rest = std::make_unique<N>();
+        rest->bytes = last.second->bytes.substr(cut);
+        rest->priority = next_priority(seed);
+        rest->update();
+        last.second->bytes.resize(cut);
+        last.second->update();
+        parts.first = merge(std::move(last.first), std::move(last.second));
+        parts.second = merge(std::move(rest), std::move(parts.second));
+    }
+    return parts;
+}
+
+// Appends the bytes [begin, end) of the text to out, the subtree starting
+// at base
+template<typename N>
+void read_text(const N *node, std::size_t base, std::size_t begin, std::size_t end, std::string& out)
+{
+    if (node == nullptr || begin >= end)
+        return;
+    std::size_t piece_begin = base + size_of(node->left);
+    std::size_t piece_end = piece_begin + node->bytes.size();
+    if (begin < piece_begin)
+        read_text(node->left.get(), base, begin, end, out);
+    if (begin < piece_end && piece_begin < end) {
+        std::size_t from = std::max(begin, piece_begin);
+        out.append(node->bytes, from - piece_begin, std::min(end, piece_end) - from);
+    }
+    if (end > piece_end)
+        read_text(node->right.get(), piece_end, begin, end, out);
+}
+
+template<typename N>
+void collect_results(const N *node, std::vector<std::any>& results)
+{
+    if (node == nullptr)
+        return;
+    collect_results(node->left.get(), results);
+    results.push_back(node->result);
+    collect_results(node->right.get(), results);
+}
+
+} // namespace
+
+
+// -----
+
+
+incremental_parser_t::incremental_parser_t(const parser_t *_list_parser, std::string _text, parse_options_t _options)
+: list_parser(_list_parser),
+  value_parser(nullptr),
+  separator_parser(nullptr),
+  at_least_one(false),
+  forwards(false),
+  options(std::move(_options)),
+  seed(2463534242u),
+  text(),
+  elements(),
+  tail{0, 0, parse_error_t()},
+  stats(),
+  text_copy(),
+  parser_state()
+{
+    if (const separated_by_parser_t *separated_by = dynamic_cast<const separated_by_parser_t*>(list_parser)) {
+        value_parser = separated_by->get_value_parser();
+        separator_parser = separated_by->get_seaparator_parser();
+        if (separator_parser == nullptr)
+            throw std::string("incremental_parser_t::incremental_parser_t(): The list has a NULL parser");
+    } else if (const many_parser_t *many = dynamic_cast<const many_parser_t*>(list_parser)) {
+        value_parser = many->get_parser();
+        at_least_one = dynamic_cast<const many1_parser_t*>(list_parser) != nullptr;
+    } else {
+        throw std::string("incremental_parser_t::incremental_parser_t(): Expected a many_parser_t, many1_parser_t or separated_by_parser_t");
+    }
+    if (value_parser == nullptr)
+        throw std::string("incremental_parser_t::incremental_parser_t(): The list has a NULL parser");
+    if (options.on_event)
+        throw std::string("incremental_parser_t::incremental_parser_t(): Event mode is not supported");
+    // Spans would view the text they were parsed from, and the arena is
+    // released with its context
+    options.span_results = false;
+    options.use_arena = false;
+
+    parse_context_t context(options);
+    forwards = !context.is_memoizable(value_parser) || (separator_parser != nullptr && !context.is_memoizable(separator_parser));
+
+    text = make_pieces<text_node_t>(_text, seed);
+    update(0, 0, 0, true);
+    text_copy = std::make_shared<const std::string>(std::move(_text));
+}
+
+incremental_parser_t::~incremental_parser_t()
+{}
+
+void incremental_parser_t::edit(const text_edit_t& text_edit)
+{
+    std::size_t size = size_of(text);
+    if (text_edit.offset > size || text_edit.removed > size - text_edit.offset)
+        throw std::string("incremental_parser_t::edit(): The edit is out of the text");
+    if (text_edit.removed == 0 && text_edit.inserted.empty()) {
+        stats = incremental_stats_t{count_of(elements), 0, 0};
+        return;
+    }
+
+    std::pair<std::unique_ptr<text_node_t>, std::unique_ptr<text_node_t>> before = split_text(std::move(text), text_edit.offset, seed);
+    std::pair<std::unique_ptr<text_node_t>, std::unique_ptr<text_node_t>> after = split_text(std::move(before.second), text_edit.removed, seed);
+
+    // The inserted bytes are joined with the pieces around them, so that
+    // edits do not leave the text in ever smaller pieces
+    std::string joined;
+    if (before.first) {
+        std::size_t count = before.first->count;
+        std::pair<std::unique_ptr<text_node_t>, std::unique_ptr<text_node_t>> last = split(std::move(before.first), count - 1);
+        joined = std::move(last.second->bytes);
+        before.first = std::move(last.first);
+    }
+    joined += text_edit.inserted;
+    if (after.second) {
+        std::pair<std::unique_ptr<text_node_t>, std::unique_ptr<text_node_t>> next = split(std::move(after.second), 1);
+        joined += next.first->bytes;
+        after.second = std::move(next.second);
+    }
+    text = merge(merge(std::move(before.first), make_pieces<text_node_t>(joined, seed)), std::move(after.second));
+
+    // A leaf fails differently on an empty text than at its end
+    update(text_edit.offset, text_edit.removed, text_edit.inserted.size(), size == 0 || size_of(text) == 0);
+}
+
+std::size_t incremental_parser_t::get_element_count() const
+{
+    return count_of(elements);
+}
+
+const std::any& incremental_parser_t::get_element(std::size_t i) const
+{
+    if (i >= count_of(elements))
+        throw std::string("incremental_parser_t::get_element(): There is no element " + std::to_string(i));
+    const element_node_t *node = elements.get();
+    while (1) {
+        std::size_t left_count = count_of(node->left);
+        if (i == left_count)
+            return node->result;
+        if (i < left_count) {
+            node = node->left.get();
+        } else {
+            i -= left_count + 1;
+            node = node->right.get();
+        }
+    }
+}
+
+const parser_state_t& incremental_parser_t::get_state() const
+{
+    if (parser_state.has_value())
+        return *parser_state;
+
+    get_text();
+    parser_state_t state(text_copy);
+    state.set_context(std::make_shared<parse_context_t>(options));
+    std::size_t list_end = size_of(elements);
+    if (tail.error.has_value()) {
+        // Going past max_depth failed the whole list
+        state.error = tail.error;
+        state.error.index += list_end;
+        state.index = state.error.index;
+    } else if (at_least_one && !elements) {
+        // The first element failed, so this is quick, and reports the error
+        // exactly as run() does
+        state = list_parser->apply(std::move(state));
+    } else {
+        std::vector<std::any> results;
+        results.reserve(count_of(elements));
+        collect_results(elements.get(), results);
+        state.index = list_end + tail.length;
+        state.set_result(std::move(results));
+    }
+    parser_state = std::move(state);
+    return *parser_state;
+}
+
+std::string_view incremental_parser_t::get_text() const
+{
+    if (!text_copy) {
+        std::string bytes;
+        bytes.reserve(size_of(text));
+        read_text(text.get(), 0, 0, size_of(text), bytes);
+        text_copy = std::make_shared<const std::string>(std::move(bytes));
+    }
+    return *text_copy;
+}
+
+std::size_t incremental_parser_t::get_text_size() const
+{
+    return size_of(text);
+}
+
+const incremental_stats_t& incremental_parser_t::get_stats() const
+{
+    return stats;
+}
+
+void incremental_parser_t::update(std::size_t offset, std::size_t removed, std::size_t inserted, bool reparse_all)
+{
+    text_copy.reset();
+    parser_state.reset();
+
+    // The elements before the first one that looked at the edited bytes
+    // (or, for an insertion, at the byte it went before) are kept, as is
+    // everything if the end of the list did not look that far either
+    std::size_t count = count_of(elements);
+    std::size_t first = reparse_all ? 0 : first_reaching(elements.get(), offset);
+    if (!reparse_all && first == count && size_of(elements) + tail.extent <= offset) {
+        stats = incremental_stats_t{count, 0, 0};
+        return;
+    }
+    std::pair<std::unique_ptr<element_node_t>, std::unique_ptr<element_node_t>> parts = split(std::move(elements), first);
+    std::unique_ptr<element_node_t> parsed = std::move(parts.first);
+    std::size_t parsed_count = 0;
+    // The elements from the first one on, and where (in the text before
+    // the edit) and at which index the first of them begins
+    std::unique_ptr<element_node_t> old = std::move(parts.second);
+    std::size_t old_begin = size_of(parsed);
+    std::size_t old_index = first;
+    bool resync = !reparse_all && !forwards;
+
+    // The attempts run over a window of the text, read as they need it. It
+    // starts a byte before them, so that it is only empty for an empty text.
+    std::size_t text_size = size_of(text);
+    std::size_t index = old_begin;
+    std::size_t window_begin = index - std::min<std::size_t>(index, 1);
+    std::string window;
+    read_text(text.get(), 0, window_begin, std::min(text_size, window_begin + (reparse_all ? text_size : window_size)), window);
+
+    // Runs a parser at position of the text, with the indices of its state
+    // in the text; end is moved to one past the last byte it looked at, and
+    // too_deep tells whether it went past max_depth
+    std::size_t end = 0;
+    bool too_deep = false;
+    auto attempt = [&](const parser_t *parser, std::size_t position, const std::any& incoming) {
+        while (1) {
+            std::shared_ptr<parse_context_t> context = std::make_shared<parse_context_t>(options);
+            parser_state_t attempt_state;
+            attempt_state.target_string = window;
+            attempt_state.index = position - window_begin;
+            attempt_state.result = incoming;
+            attempt_state.set_context(context);
+            attempt_state = parser->apply(std::move(attempt_state));
+
+            // As in parse_stream(), the other checks are for the custom
+            // parsers that do not report how far they looked
+            const furthest_failure_t& furthest = context->get_furthest_failure();
+            std::size_t size = window.size();
+            bool reached_end = context->lookahead > size
+                || (attempt_state.error.has_value() ? attempt_state.error.index >= size : attempt_state.index >= size)
+                || (furthest.has_value() && furthest.index >= size);
+            if (reached_end && window_begin + size < text_size) {
+                read_text(text.get(), 0, window_begin + size, std::min(text_size, window_begin + 2 * size + window_size), window);
+                continue;
+            }
+
+            std::size_t looked = std::max(context->lookahead, attempt_state.index);
+            if (attempt_state.error.has_value())
+                looked = std::max(looked, attempt_state.error.index + 1);
+            if (furthest.has_value())
+                looked = std::max(looked, furthest.index + 1);
+            end = std::max(end, window_begin + looked);
+            too_deep = context->depth_error.has_value();
+            attempt_state.index += window_begin;
+            if (attempt_state.error.has_value())
+                attempt_state.error.index += window_begin;
+            return attempt_state;
+        }
+    };
+
+    // The incoming result of the next attempt, which only the elements that
+    // forward it read
+    std::any incoming = parser_state_t().result;
+    if (forwards && parsed) {
+        const element_node_t *last = parsed.get();
+        while (last->right)
+            last = last->right.get();
+        incoming = last->result;
+    }
+
+    while (1) {
+        std::size_t element_count = first + parsed_count;
+        // Past the edit, an element that ends where one of the previous
+        // parse began goes on as that one did: the rest is kept. They must
+        // both be followed by a separator, or both be the first one.
+        if (resync && index >= offset + inserted) {
+            std::size_t old_position = index - inserted + removed;
+            if (old_position >= old_begin) {
+                std::size_t skipped = count_before(old.get(), old_position - old_begin);
+                std::pair<std::unique_ptr<element_node_t>, std::unique_ptr<element_node_t>> rest = split(std::move(old), skipped);
+                old_begin += size_of(rest.first);
+                old_index += skipped;
+                old = std::move(rest.second);
+            }
+            if (old_position == old_begin && (separator_parser == nullptr || (old_index == 0) == (element_count == 0))) {
+                // The end of the list is kept as well
+                elements = merge(std::move(parsed), std::move(old));
+                stats = incremental_stats_t{count_of(elements) - parsed_count, parsed_count, window.size()};
+                return;
+            }
+        }
+
+        std::size_t begin = index;
+        std::size_t position = begin;
+        end = begin;
+        if (separator_parser != nullptr && element_count != 0) {
+            parser_state_t separator_state = attempt(separator_parser, position, incoming);
+            if (separator_state.error.has_value()) {
+                tail = tail_t{0, end - begin, too_deep ? separator_state.error : parse_error_t()};
+                break;
+            }
+            position = separator_state.index;
+            if (forwards)
+                incoming = std::move(separator_state.result);
+        }
+        parser_state_t value_state = attempt(value_parser, position, incoming);
+        if (value_state.error.has_value()) {
+            tail = tail_t{position - begin, end - begin, too_deep ? value_state.error : parse_error_t()};
+            break;
+        }
+
+        std::unique_ptr<element_node_t> element = std::make_unique<element_node_t>();
+        element->result = std::move(value_state.result);
+        element->length = value_state.index - begin;
+        element->extent = end - begin;
+        element->priority = next_priority(seed);
+        element->update();
+        if (forwards)
+            incoming = element->result;
+        parsed = merge(std::move(parsed), std::move(element));
+        ++parsed_count;
+        index = value_state.index;
+        // An element matching nothing would be matched forever (the first
+        // one of a separated_by_parser_t is not repeated)
+        if (index == begin && (separator_parser == nullptr || element_count != 0)) {
+            tail = tail_t{0, end - begin, parse_error_t()};
+            break;
+        }
+    }
+    if (tail.error.has_value())
+        tail.error.index -= index;
+
+    elements = std::move(parsed);
+    stats = incremental_stats_t{count_of(elements) - parsed_count, parsed_count, window.size()};
+}
+
+
+// -----
+} // namespace wi
@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "mapped_file.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <memory>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace wi {
+// -----
+
+
+mapped_file_t::mapped_file_t(const std::string& path)
+: data(nullptr),
+  size(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw "mapped_file_t::mapped_file_t(): Unable to open " + path + ": " + std::strerror(errno);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw "mapped_file_t::mapped_file_t(): Unable to stat " + path + ": " + std::strerror(error);
+    }
+
+    // Empty files cannot be mapped, and need not be
+    size = (std::size_t)st.st_size;
+    if (size != 0) {
+        void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw "mapped_file_t::mapped_file_t(): Unable to map " + path + ": " + std::strerror(error);
+        }
+        ::madvise(address, size, MADV_SEQUENTIAL);
+        data = (const char*)address;
+    }
+    // The mapping does not need the descriptor
+    ::close(fd);
+}
+
+mapped_file_t::~mapped_file_t()
+{
+    if (data != nullptr)
+        ::munmap((void*)data, size);
+}
+
+std::string_view mapped_file_t::get_view() const
+{
+    return std::string_view(data, size);
+}
+
+
+// -----
+
+
+parser_state_t parse_file(const parser_t* parser, const std::string& path, parse_options_t options)
+{
+    std::shared_ptr<const mapped_file_t> file = std::make_shared<const mapped_file_t>(path);
+    parser_state_t parser_state;
+    parser_state.target_string = file->get_view();
+    parser_state.input = file;
+
+    // The faults of this thread only, where the system can tell them apart
+#ifdef RUSAGE_THREAD
+    const int who = RUSAGE_THREAD;
+#else
+    const int who = RUSAGE_SELF;
+#endif
+    struct rusage before, after;
+    ::getrusage(who, &before);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // The results may be moved out of the states, so the spans into the
+    // mapping keep it too
+    options.spans_keep_input = true;
+    parser_state = parse(parser, std::move(parser_state), options);
+
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    ::getrusage(who, &after);
+    if (parse_context_t *context = parser_state.get_context().get()) {
+        context->stats.input_bytes = file->get_view().size();
+        context->stats.minor_page_faults = (std::size_t)(after.ru_minflt - before.ru_minflt);
+        context->stats.major_page_faults = (std::size_t)(after.ru_majflt - before.ru_majflt);
+        context->stats.seconds = std::chrono::duration<double>(stop - start).count();
+    }
+    return parser_state;
+}
+
+
+// -----
+} // namespace wi
@@ -0,0 +1,335 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "optimizer.hpp"
+
+namespace wi {
+// -----
+
+
+namespace {
+
+// Memoized and labeled nodes stay as they are, for the memo table and the
+// profiles to find them
+bool is_kept(const parser_t *parser)
+{
+    return parser->get_memoize() || !parser->get_label().empty();
+}
+
+} // namespace
+
+
+grammar_optimizer_t::grammar_optimizer_t(grammar_t& _g, optimize_options_t _options)
+: g(_g),
+  options(_options),
+  stats(),
+  shape_free(true),
+  recursive_lazies(),
+  done(),
+  in_progress(),
+  pending_lazies()
+{}
+
+const parser_t* grammar_optimizer_t::optimize(const parser_t *root)
+{
+    stats = optimize_stats_t();
+    shape_free = true;
+    recursive_lazies.clear();
+    done.clear();
+    in_progress.clear();
+    pending_lazies.clear();
+
+    std::vector<const lazy_parser_t*> lazies;
+    visit_grammar(root, [&](const parser_t *parser) {
+        ++stats.nodes_before;
+        if (parser->forwards_result())
+            shape_free = false;
+        if (const lazy_parser_t *lazy = dynamic_cast<const lazy_parser_t*>(parser))
+            lazies.push_back(lazy);
+    });
+    for (const lazy_parser_t *lazy : lazies) {
+        visit_grammar(lazy->get_parser(), [&](const parser_t *parser) {
+            if (parser == lazy)
+                recursive_lazies.insert(lazy);
+        });
+    }
+
+    const parser_t *result = rewrite(root, false);
+
+    visit_grammar(result, [&]([[maybe_unused]] const parser_t *parser) {
+        ++stats.nodes_after;
+    });
+    if (options.dispatch_tables)
+        build_dispatch_tables(result);
+    return result;
+}
+
+const optimize_stats_t& grammar_optimizer_t::get_stats() const
+{
+    return stats;
+}
+
+template<typename T, typename... Args>
+T* grammar_optimizer_t::make(const parser_t *original, Args&&... args)
+{
+    T *node = g.make<T>(std::forward<Args>(args)...);
+    node->set_memoize(original->get_memoize());
+    node->set_label(original->get_label());
+    return node;
+}
+
+const parser_t* grammar_optimizer_t::rewrite(const parser_t *parser, bool dropped)
+{
+    if (parser == nullptr)
+        return nullptr;
+    std::pair<const parser_t*, bool> key = {parser, dropped && shape_free};
+    auto it = done.find(key);
+    if (it != done.end())
+        return it->second;
+    // A cycle that does not go through a lazy_parser_t (e.g. a choice that
+    // was given itself as an alternative): keep using the original node
+    if (!in_progress.insert(key).second)
+        return parser;
+    const parser_t *result = rewrite_node(parser, key.second);
+    in_progress.erase(key);
+    done[key] = result;
+
+    auto pending = pending_lazies.find(key);
+    if (pending != pending_lazies.end()) {
+        for (lazy_parser_t *lazy : pending->second)
+            lazy->set_parser(result);
+        pending_lazies.erase(pending);
+    }
+    return result;
+}
+
+const parser_t* grammar_optimizer_t::rewrite_node(const parser_t *parser, bool dropped)
+{
+    bool keep = is_kept(parser);
+
+    if (const lazy_parser_t *lazy = dynamic_cast<const lazy_parser_t*>(parser)) {
+        if (lazy->get_parser() == nullptr)
+            return parser;
+        if (!keep && recursive_lazies.count(lazy) == 0) {
+            ++stats.inlined_lazies;
+            return rewrite(lazy->get_parser(), dropped);
+        }
+        // Registered before its target is rewritten, which leads back here.
+        // If the target is the node being rewritten (the cycle was entered
+        // from above the lazy), it is set once that node is done.
+        lazy_parser_t *result = make<lazy_parser_t>(parser);
+        done[{parser, dropped}] = result;
+        std::pair<const parser_t*, bool> target = {lazy->get_parser(), dropped};
+        if (in_progress.count(target) != 0)
+            pending_lazies[target].push_back(result);
+        else
+            result->set_parser(rewrite(lazy->get_parser(), dropped));
+        return result;
+    }
+
+    if (const map_parser_t *map = dynamic_cast<const map_parser_t*>(parser)) {
+        if (map->is_identity()) {
+            if (!keep) {
+                ++stats.removed_nodes;
+                return rewrite(map->get_parser(), dropped);
+            }
+            return make<map_parser_t>(parser, rewrite(map->get_parser(), dropped));
+        }
+        return make<map_parser_t>(parser, rewrite(map->get_parser(), false), map->get_f());
+    }
+
+    if (const chain_parser_t *chain = dynamic_cast<const chain_parser_t*>(parser))
+        return make<chain_parser_t>(parser, rewrite(chain->get_parser(), false), chain->get_f());
+
+    if (const flatten_parser_t *flatten = dynamic_cast<const flatten_parser_t*>(parser)) {
+        if (dropped && !keep) {
+            ++stats.removed_nodes;
+            return rewrite(flatten->get_parser(), true);
+        }
+        return make<flatten_parser_t>(parser, rewrite(flatten->get_parser(), false));
+    }
+
+    if (const sequence_of_parser_t *sequence = dynamic_cast<const sequence_of_parser_t*>(parser))
+        return rewrite_sequence(sequence, dropped);
+
+    if (const choice_of_parser_t *choice = dynamic_cast<const choice_of_parser_t*>(parser))
+        return rewrite_choice(choice, dropped);
+
+    if (const many1_parser_t *many1 = dynamic_cast<const many1_parser_t*>(parser))
+        return rewrite_many(many1, true, dropped);
+
+    if (const many_parser_t *many = dynamic_cast<const many_parser_t*>(parser))
+        return rewrite_many(many, false, dropped);
+
+    if (const between_parser_t *between = dynamic_cast<const between_parser_t*>(parser)) {
+        return make<between_parser_t>(parser,
+            rewrite(between->get_left_parser(), true),
+            rewrite(between->get_right_parser(), true),
+            rewrite(between->get_content_parser(), dropped));
+    }
+
+    if (const separated_by_parser_t *separated_by = dynamic_cast<const separated_by_parser_t*>(parser)) {
+        return make<separated_by_parser_t>(parser,
+            rewrite(separated_by->get_seaparator_parser(), true),
+            rewrite(separated_by->get_value_parser(), dropped));
+    }
+
+    // Leaves, and nodes the optimizer knows nothing about
+    return parser;
+}
+
+const parser_t* grammar_optimizer_t::rewrite_sequence(const sequence_of_parser_t *sequence, bool dropped)
+{
+    std::vector<const parser_t*> parsers;
+    for (const parser_t *child : sequence->get_parsers())
+        parsers.push_back(rewrite(child, dropped));
+
+    if (!dropped || is_kept(sequence))
+        return make<sequence_of_parser_t>(sequence, parsers);
+
+    // The result is dropped: only the matched length matters
+    std::vector<const parser_t*> flat;
+    for (const parser_t *child : parsers) {
+        const sequence_of_parser_t *inner = dynamic_cast<const sequence_of_parser_t*>(child);
+        if (inner != nullptr && !is_kept(inner)) {
+            ++stats.flattened_sequences;
+            flat.insert(flat.end(), inner->get_parsers().begin(), inner->get_parsers().end());
+        } else {
+            flat.push_back(child);
+        }
+    }
+
+    std::vector<const parser_t*> merged;
+    for (std::size_t i = 0; i < flat.size(); ) {
+        const string_parser_t *first = dynamic_cast<const string_parser_t*>(flat[i]);
+        std::size_t j = i + 1;
+        if (first != nullptr && !is_kept(first)) {
+            std::string s = first->get_string();
+            for (; j < flat.size(); ++j) {
+                const string_parser_t *next = dynamic_cast<const string_parser_t*>(flat[j]);
+                if (next == nullptr || is_kept(next))
+                    break;
+                s += next->get_string();
+            }
+            if (j > i + 1) {
+                stats.merged_strings += j - i - 1;
+                merged.push_back(g.make<string_parser_t>(s));
+                i = j;
+                continue;
+            }
+        }
+        merged.push_back(flat[i]);
+        i = j;
+    }
+
+    if (merged.size() == 1) {
+        ++stats.removed_nodes;
+        return merged[0];
+    }
+    return make<sequence_of_parser_t>(sequence, merged);
+}
+
+const parser_t* grammar_optimizer_t::rewrite_choice(const choice_of_parser_t *choice, bool dropped)
+{
+    // A choice returns the state of the alternative that matched as is, so
+    // nested choices can always be flattened
+    std::vector<const parser_t*> flat;
+    for (const parser_t *child : choice->get_parsers()) {
+        const parser_t *alternative = rewrite(child, dropped);
+        const choice_of_parser_t *inner = dynamic_cast<const choice_of_parser_t*>(alternative);
+        if (inner != nullptr && !is_kept(inner)) {
+            ++stats.flattened_choices;
+            flat.insert(flat.end(), inner->get_parsers().begin(), inner->get_parsers().end());
+        } else {
+            flat.push_back(alternative);
+        }
+    }
+
+    // Runs of literal alternatives are tried in order, as a trie does with
+    // match_mode_t::first_listed
+    std::vector<const parser_t*> parsers;
+    for (std::size_t i = 0; i < flat.size(); ) {
+        std::vector<std::string> words;
+        std::size_t j = i;
+        for (; j < flat.size() && !is_kept(flat[j]); ++j) {
+            if (const string_parser_t *literal = dynamic_cast<const string_parser_t*>(flat[j])) {
+                words.push_back(literal->get_string());
+            } else if (const choice_of_string_parser_t *literals = dynamic_cast<const choice_of_string_parser_t*>(flat[j]);
+                       literals != nullptr && literals->get_match_mode() == choice_of_string_parser_t::match_mode_t::first_listed) {
+                words.insert(words.end(), literals->get_words().begin(), literals->get_words().end());
+            } else {
+                break;
+            }
+        }
+        if (j > i + 1) {
+            ++stats.string_tries;
+            parsers.push_back(g.make<choice_of_string_parser_t>(words, choice_of_string_parser_t::match_mode_t::first_listed));
+            i = j;
+        } else {
+            parsers.push_back(flat[i]);
+            ++i;
+        }
+    }
+
+    if (parsers.size() == 1 && !is_kept(choice)) {
+        ++stats.removed_nodes;
+        return parsers[0];
+    }
+    return make<choice_of_parser_t>(choice, parsers);
+}
+
+const parser_t* grammar_optimizer_t::rewrite_many(const many_parser_t *many, bool at_least_one, bool dropped)
+{
+    const parser_t *child = rewrite(many->get_parser(), dropped);
+
+    if (dropped && !is_kept(many) && child != nullptr && !is_kept(child)) {
+        // The list of characters is dropped, so a scanner can match the run
+        const char_class_t *char_class = nullptr;
+        if (const char_parser_t *c = dynamic_cast<const char_parser_t*>(child))
+            char_class = &c->get_char_class();
+        else if (const chars_parser_t *c = dynamic_cast<const chars_parser_t*>(child))
+            char_class = &c->get_char_class();
+        if (char_class != nullptr) {
+            ++stats.char_scanners;
+            if (at_least_one)
+                return g.make<chars_parser_t>(*char_class);
+            return g.make<maybe_chars_parser_t>(*char_class);
+        }
+    }
+
+    if (at_least_one)
+        return make<many1_parser_t>(many, child);
+    return make<many_parser_t>(many, child);
+}
+
+
+// -----
+
+
+const parser_t* optimize_grammar(const parser_t *root, grammar_t& g, optimize_options_t options)
+{
+    return grammar_optimizer_t(g, options).optimize(root);
+}
+
+
+// -----
+} // namespace wi
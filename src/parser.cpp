@@ -22,34 +22,250 @@
 
 #include "parser.hpp"
 
+#include <unordered_set>
+#include <algorithm>
+
 namespace wi {
 // -----
 
 
+namespace {
+
+// Stateless, hence shared by every map_parser_t / chain_parser_t that needs
+// one, instead of allocating (and leaking) a new one each time
+parser_t* shared_do_nothing_parser()
+{
+    static do_nothing_parser_t parser;
+    return &parser;
+}
+
+// FIRST of a sequence: its parsers up to the first one that must consume
+first_set_t sequence_first_set(const first_set_analysis_t& analysis, const std::vector<const parser_t*>& parsers)
+{
+    first_set_t result;
+    result.nullable = true;
+    for (const parser_t *parser : parsers) {
+        first_set_t first = analysis.get(parser);
+        result.bytes.add_class(first.bytes);
+        if (!first.nullable) {
+            result.nullable = false;
+            break;
+        }
+    }
+    return result;
+}
+
+// parse_error_t::code values of the nodes below
+enum error_code_t : std::uint32_t {
+    no_match = 0,
+    unexpected_end = 1,
+    null_separator_parser = 2,
+    null_value_parser = 3
+};
+
+// Stands for the result list in event mode, where nothing is collected
+struct discarded_results_t {
+    void reserve(std::size_t) {}
+    template<typename T>
+    void emplace_back(T&&) {}
+};
+
+// A result list being built, whose buffers are counted in the stats of the
+// parse: a vector allocates exactly when its capacity changes
+template<typename vector_t>
+class counted_results_t {
+    vector_t& results;
+    parse_stats_t *stats;
+
+    void count(std::size_t capacity)
+    {
+        if (stats != nullptr && results.capacity() != capacity) {
+            ++stats->result_allocations;
+            stats->result_bytes_allocated += results.capacity() * sizeof(std::any);
+        }
+    }
+
+public:
+    counted_results_t(vector_t& _results, parse_stats_t *_stats)
+    : results(_results),
+      stats(_stats)
+    {}
+
+    void reserve(std::size_t size)
+    {
+        std::size_t capacity = results.capacity();
+        results.reserve(size);
+        count(capacity);
+    }
+
+    template<typename T>
+    void emplace_back(T&& value)
+    {
+        std::size_t capacity = results.capacity();
+        results.emplace_back(std::forward<T>(value));
+        count(capacity);
+    }
+};
+
+// Builds a result list, in the parse's arena if it has one; fill() receives
+// a counted_results_t over either a std::pmr::vector<std::any> or a
+// std::vector<std::any> (or, in event mode, a discarded_results_t, and the
+// list is left empty)
+template<typename fill_t>
+std::any collect_results(const parser_state_t& parser_state, fill_t fill)
+{
+    if (parser_state.context && parser_state.context->in_event_mode()) {
+        discarded_results_t results;
+        fill(results);
+        return std::vector<std::any>();
+    }
+    parse_stats_t *stats = parser_state.context ? &parser_state.context->stats : nullptr;
+    parse_arena_t *arena = parser_state.get_context() ? parser_state.get_context()->get_arena() : nullptr;
+    if (arena != nullptr) {
+        std::pmr::vector<std::any> results(arena);
+        counted_results_t<std::pmr::vector<std::any>> counted(results, stats);
+        fill(counted);
+        return results;
+    }
+    std::vector<std::any> results;
+    counted_results_t<std::vector<std::any>> counted(results, stats);
+    fill(counted);
+    return results;
+}
+
+// A backtrack point, in event mode: the events of a failed attempt are
+// dropped (see parse_context_t::begin_attempt())
+class event_attempt_t {
+    parse_context_t *context;
+    std::size_t mark;
+
+public:
+    event_attempt_t(const parser_state_t& parser_state)
+    : context(parser_state.context && parser_state.context->in_event_mode() ? parser_state.context.get() : nullptr),
+      mark(context ? context->begin_attempt() : 0)
+    {}
+
+    void end(bool matched)
+    {
+        if (context)
+            context->end_attempt(mark, matched);
+    }
+};
+
+// The events of the parts whose result is dropped are left out
+parser_state_t apply_muted(const parser_t *parser, parser_state_t parser_state)
+{
+    parse_context_t *context = parser_state.context && parser_state.context->in_event_mode() ? parser_state.context.get() : nullptr;
+    if (context == nullptr)
+        return parser->apply(std::move(parser_state));
+    context->mute_events();
+    parser_state = parser->apply(std::move(parser_state));
+    context->unmute_events();
+    return parser_state;
+}
+
+// A failure past parse_options_t::max_depth is not backtracked from, even
+// where the context was only created below (a run() without one)
+bool is_depth_failure(const parser_state_t& parser_state)
+{
+    return parser_state.context && parser_state.context->depth_error.has_value();
+}
+
+} // namespace
+
+
+// -----
+
+
+parse_error_t::parse_error_t()
+: parser(nullptr),
+  index(0),
+  code(0),
+  message()
+{}
+
+parse_error_t::parse_error_t(const parser_t *_parser, std::size_t _index, std::uint32_t _code)
+: parser(_parser),
+  index(_index),
+  code(_code),
+  message()
+{}
+
+parse_error_t::parse_error_t(std::string _message, std::size_t _index)
+: parser(nullptr),
+  index(_index),
+  code(0),
+  message(std::make_shared<const std::string>(std::move(_message)))
+{}
+
+bool parse_error_t::has_value() const
+{
+    return parser != nullptr || message != nullptr;
+}
+
+void parse_error_t::reset()
+{
+    *this = parse_error_t();
+}
+
+std::string parse_error_t::to_string(std::string_view target_string) const
+{
+    if (message)
+        return *message;
+    if (parser)
+        return parser->describe_error(*this, target_string);
+    return "";
+}
+
+
+// -----
+
+
 parser_state_t::parser_state_t()
-: target_string(),
+: input(),
+  target_string(),
+  context(),
   result(""),
   index(0),
   error()
 {}
 
 parser_state_t::parser_state_t(std::string _target_string)
-: target_string(_target_string),
+: parser_state_t(std::make_shared<const std::string>(std::move(_target_string)))
+{}
+
+parser_state_t::parser_state_t(std::shared_ptr<const std::string> _input)
+: input(),
+  target_string(),
+  context(),
   result(""),
   index(0),
   error()
+{
+    set_input(std::move(_input));
+}
 
-{}
+parser_state_t::~parser_state_t()
+{
+    if (result.has_value())
+        release_any(result);
+}
 
 parser_state_t& parser_state_t::set_target_string(std::string _target_string)
 {
-    target_string = _target_string;
+    return set_input(std::make_shared<const std::string>(std::move(_target_string)));
+}
+
+parser_state_t& parser_state_t::set_input(std::shared_ptr<const std::string> _input)
+{
+    target_string = _input ? std::string_view(*_input) : std::string_view();
+    input = std::move(_input);
     return *this;
 }
 
 parser_state_t& parser_state_t::set_result(std::any _result)
 {
-    result = _result;
+    result = std::move(_result);
     return *this;
 }
 
@@ -61,7 +277,7 @@ parser_state_t& parser_state_t::set_index(std::size_t _index)
 
 parser_state_t& parser_state_t::set_error(std::string _error)
 {
-    error = _error;
+    error = parse_error_t(std::move(_error), index);
     return *this;
 }
 
@@ -71,7 +287,26 @@ parser_state_t& parser_state_t::unset_error()
     return *this;
 }
 
+parser_state_t& parser_state_t::fail(const parser_t *parser, std::uint32_t code)
+{
+    error = parse_error_t(parser, index, code);
+    if (context)
+        context->note_failure(parser, index);
+    return *this;
+}
+
+parser_state_t& parser_state_t::set_context(std::shared_ptr<parse_context_t> _context)
+{
+    context = std::move(_context);
+    return *this;
+}
+
 std::string parser_state_t::get_target_string() const
+{
+    return std::string(target_string);
+}
+
+std::string_view parser_state_t::get_target_view() const
 {
     return target_string;
 }
@@ -88,15 +323,35 @@ std::size_t parser_state_t::get_index() const
 
 std::optional<std::string> parser_state_t::get_error() const
 {
-    return error;
+    if (!error.has_value())
+        return std::nullopt;
+    std::string message = error.to_string(target_string);
+    if (context) {
+        const furthest_failure_t& furthest_failure = context->get_furthest_failure();
+        if (furthest_failure.has_value() && furthest_failure.index > error.index) {
+            std::string furthest = furthest_failure.to_string(target_string);
+            if (!furthest.empty())
+                message += " (furthest failure: " + furthest + ")";
+        }
+    }
+    return message;
 }
 
-parser_state_t parser_state_t::map_result(std::function<std::any(std::any)> f) const
+std::shared_ptr<parse_context_t> parser_state_t::get_context() const
 {
-    if (this->error.has_value())
-        return *this;
-    parser_state_t parser_state = *this;
-    return parser_state.set_result(f(parser_state.result));
+    return context;
+}
+
+parser_state_t parser_state_t::map_result(std::function<std::any(std::any)> f) const &
+{
+    return parser_state_t(*this).map_result(f);
+}
+
+parser_state_t parser_state_t::map_result(std::function<std::any(std::any)> f) &&
+{
+    if (!(this->error.has_value()))
+        result = f(std::move(result));
+    return std::move(*this);
 }
 
 parser_state_t parser_state_t::map_error(std::function<std::string(std::string)> f) const
@@ -104,7 +359,7 @@ parser_state_t parser_state_t::map_error(std::function<std::string(std::string)>
     if (!(this->error.has_value()))
         return *this;
     parser_state_t parser_state = *this;
-    return parser_state.set_error(f(parser_state.error.value()));
+    return parser_state.set_error(f(error.to_string(target_string)));
 }
 
 parser_state_t parser_state_t::map_nested_result(std::function<std::any(std::string)> f) const
@@ -112,13 +367,16 @@ parser_state_t parser_state_t::map_nested_result(std::function<std::any(std::str
     if (this->error.has_value())
         return *this;
     std::function<std::any(std::any)> g = [&](std::any x) {
-        if (x.type() == typeid(std::vector<std::any>)) {
-            std::vector<std::any> v = std::any_cast< std::vector<std::any> >(x);
-            for (std::any& a : v)
-                a = g(a);
-            return std::any(v);
+        if (std::vector<std::any> *v = std::any_cast< std::vector<std::any> >(&x)) {
+            for (std::any& a : *v)
+                a = g(std::move(a));
+            return x;
+        } else if (std::pmr::vector<std::any> *v = std::any_cast< std::pmr::vector<std::any> >(&x)) {
+            for (std::any& a : *v)
+                a = g(std::move(a));
+            return x;
         } else { // string
-            return f(std::any_cast<std::string>(x));
+            return f(smart_string_any_cast(x));
         }
     };
     return this->map_result(g);
@@ -132,12 +390,44 @@ parser_state_t parser_state_t::chain(std::function<parser_t*(std::any)> f) const
     return next_parser->run(*this);
 }
 
-parser_state_t parser_state_t::flatten_result() const
+std::any parser_state_t::slice(std::size_t begin, std::size_t end) const
 {
-    if (this->error.has_value())
-        return *this;
-    parser_state_t parser_state = *this;
-    return parser_state.set_result(flatten_vector(parser_state.result));
+    if (wants_spans()) {
+        if (context->options.spans_keep_input)
+            return span_t{begin, end, target_string.substr(begin, end - begin), input};
+        return span_t{begin, end, target_string.substr(begin, end - begin), nullptr};
+    }
+    return std::string(target_string.substr(begin, end - begin));
+}
+
+bool parser_state_t::wants_spans() const
+{
+    return context && (context->options.span_results || context->in_event_mode());
+}
+
+void parser_state_t::note_lookahead(std::size_t end) const
+{
+    if (context && context->lookahead < end)
+        context->lookahead = end;
+}
+
+void parser_state_t::note_event(parse_event_kind_t kind, const parser_t *parser, std::size_t begin, std::size_t end) const
+{
+    if (context && context->in_event_mode())
+        context->emit_event(parse_event_t{kind, parser, begin, end,
+                                          begin < target_string.size() ? target_string.substr(begin, end - begin) : std::string_view()});
+}
+
+parser_state_t parser_state_t::flatten_result() const &
+{
+    return parser_state_t(*this).flatten_result();
+}
+
+parser_state_t parser_state_t::flatten_result() &&
+{
+    if (!(this->error.has_value()))
+        result = flatten_vector(result);
+    return std::move(*this);
 }
 
 
@@ -157,7 +447,7 @@ std::string parser_state_t::to_string() const
     
     if (error.has_value()) {
         ss << ",\n";
-        ss << "  error: \"" << error.value() << "\" }";
+        ss << "  error: \"" << get_error().value() << "\" }";
     } else {
         ss << " }";
     }
@@ -169,11 +459,292 @@ std::string parser_state_t::to_string() const
 // -----
 
 
+bool furthest_failure_t::has_value() const
+{
+    return !expected.empty();
+}
+
+std::string furthest_failure_t::to_string(std::string_view target_string) const
+{
+    std::vector<std::string> descriptions;
+    for (const parser_t *parser : expected) {
+        std::string description = parser->describe_expected();
+        if (!description.empty() && std::find(descriptions.begin(), descriptions.end(), description) == descriptions.end())
+            descriptions.push_back(std::move(description));
+    }
+    if (descriptions.empty())
+        return "";
+
+    std::string result = "expected ";
+    for (std::size_t i = 0; i < descriptions.size(); ++i) {
+        if (i > 0)
+            result += (i + 1 == descriptions.size()) ? " or " : ", ";
+        result += descriptions[i];
+    }
+    return result + " at index " + std::to_string(index) + " (\"" + string_at_most<true>(target_string, 10, index) + "\")";
+}
+
+
+// -----
+
+
+parse_context_t::parse_context_t()
+: options(),
+  stats(),
+  depth(0),
+  depth_error(),
+  lookahead(0),
+  profile(),
+  arena(),
+  furthest_failure(),
+  memo(),
+  memoizable(),
+  event_mode(false),
+  events(),
+  attempts(0),
+  muted(0)
+{}
+
+parse_context_t::parse_context_t(parse_options_t _options)
+: options(_options),
+  stats(),
+  depth(0),
+  depth_error(),
+  lookahead(0),
+  profile(),
+  arena(_options.use_arena ? std::make_unique<parse_arena_t>(_options.arena_block_size) : nullptr),
+  furthest_failure(),
+  memo(),
+  memoizable(),
+  event_mode((bool)_options.on_event),
+  events(),
+  attempts(0),
+  muted(0)
+{}
+
+const parse_options_t& parse_context_t::get_options() const
+{
+    return options;
+}
+
+double parse_stats_t::get_throughput() const
+{
+    return seconds > 0 ? input_bytes / seconds / 1e6 : 0;
+}
+
+parse_stats_t parse_context_t::get_stats() const
+{
+    parse_stats_t result = stats;
+    if (arena) {
+        result.arena_allocations = arena->get_allocations();
+        result.arena_bytes_allocated = arena->get_bytes_allocated();
+        result.arena_blocks = arena->get_block_count();
+        result.arena_bytes_reserved = arena->get_bytes_reserved();
+    }
+    return result;
+}
+
+const parse_profile_t& parse_context_t::get_profile() const
+{
+    return profile;
+}
+
+parse_arena_t* parse_context_t::get_arena() const
+{
+    return arena.get();
+}
+
+void parse_context_t::note_failure(const parser_t* parser, std::size_t index)
+{
+    // A bounded set: past a few dozen nodes the message would not help anyway
+    const std::size_t max_expected = 32;
+    std::vector<const parser_t*>& expected = furthest_failure.expected;
+    if (expected.empty() || index > furthest_failure.index) {
+        furthest_failure.index = index;
+        expected.clear();
+        expected.push_back(parser);
+    } else if (index == furthest_failure.index && expected.size() < max_expected &&
+               std::find(expected.begin(), expected.end(), parser) == expected.end()) {
+        expected.push_back(parser);
+    }
+}
+
+const furthest_failure_t& parse_context_t::get_furthest_failure() const
+{
+    return furthest_failure;
+}
+
+std::size_t parse_context_t::memo_key_hash_t::operator()(const std::pair<const parser_t*, std::size_t>& key) const
+{
+    std::size_t h = std::hash<const parser_t*>()(key.first);
+    return h ^ (std::hash<std::size_t>()(key.second) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+std::optional<parser_state_t> parse_context_t::memo_find(const parser_t* parser, std::size_t index)
+{
+    auto it = memo.find({parser, index});
+    if (it == memo.end()) {
+        ++stats.memo_misses;
+        return std::nullopt;
+    }
+    ++stats.memo_hits;
+    return it->second;
+}
+
+void parse_context_t::memo_store(const parser_t* parser, std::size_t index, parser_state_t parser_state)
+{
+    // The stored state must not keep its own context alive
+    parser_state.context.reset();
+    memo.insert_or_assign({parser, index}, std::move(parser_state));
+}
+
+std::size_t parse_context_t::memo_size() const
+{
+    return memo.size();
+}
+
+void parse_context_t::clear_memo()
+{
+    memo.clear();
+}
+
+bool parse_context_t::in_event_mode() const
+{
+    return event_mode;
+}
+
+void parse_context_t::emit_event(const parse_event_t& event)
+{
+    if (muted != 0)
+        return;
+    if (attempts == 0)
+        options.on_event(event);
+    else
+        events.push_back(event);
+}
+
+std::size_t parse_context_t::begin_attempt()
+{
+    ++attempts;
+    return events.size();
+}
+
+void parse_context_t::end_attempt(std::size_t mark, bool matched)
+{
+    if (!matched)
+        events.resize(mark);
+    if (--attempts == 0) {
+        for (const parse_event_t& event : events)
+            options.on_event(event);
+        events.clear();
+    }
+}
+
+void parse_context_t::mute_events()
+{
+    ++muted;
+}
+
+void parse_context_t::unmute_events()
+{
+    --muted;
+}
+
+bool parse_context_t::is_memoizable(const parser_t* parser)
+{
+    auto it = memoizable.find(parser);
+    if (it != memoizable.end())
+        return it->second;
+
+    std::vector<const parser_t*> stack = {parser};
+    std::vector<const parser_t*> seen = {parser};
+    std::unordered_set<const parser_t*> visited = {parser};
+    bool result = true;
+    while (!stack.empty() && result) {
+        const parser_t* p = stack.back();
+        stack.pop_back();
+        if (p->forwards_result()) {
+            result = false;
+            break;
+        }
+        for (const parser_t* child : p->get_children()) {
+            if (child != nullptr && visited.insert(child).second) {
+                stack.push_back(child);
+                seen.push_back(child);
+            }
+        }
+    }
+
+    if (result) {
+        // Everything reachable from a memoizable node is memoizable as well
+        for (const parser_t* p : seen)
+            memoizable[p] = true;
+    } else {
+        memoizable[parser] = false;
+    }
+    return result;
+}
+
+
+// -----
+
+
+parser_t::parser_t()
+: memoize(false),
+  label()
+{}
+
 parser_state_t parser_t::run([[maybe_unused]]parser_state_t parser_state) const
 {
     throw "parser_t::run() should never be run on its own!";
 }
 
+parser_state_t parser_t::apply(parser_state_t parser_state) const
+{
+    parse_context_t *context = parser_state.context.get();
+    if (context == nullptr || parser_state.error.has_value())
+        return run(std::move(parser_state));
+    // Going deeper than max_depth fails the whole parse: no other
+    // alternative is tried, and nothing that matched before counts
+    if (context->depth_error.has_value()) {
+        parser_state.error = context->depth_error;
+        return parser_state;
+    }
+
+#ifdef _WI_PROFILE_
+    std::size_t begin = parser_state.index;
+    context->profile.enter(this);
+    parser_state = apply_in_context(std::move(parser_state));
+    context->profile.leave(begin, parser_state.index, parser_state.error.has_value(), parser_state.error.index);
+#else
+    parser_state = apply_in_context(std::move(parser_state));
+#endif
+    if (context->depth_error.has_value())
+        parser_state.error = context->depth_error;
+    return parser_state;
+}
+
+parser_state_t parser_t::apply_in_context(parser_state_t parser_state) const
+{
+    parse_context_t *context = parser_state.context.get();
+    std::shared_ptr<parse_context_t> context_owner = parser_state.context;
+    if (!(memoize || context->options.memoize) || context->in_event_mode() || !context->is_memoizable(this)) {
+        parser_state = run(std::move(parser_state));
+        if (!parser_state.context)
+            parser_state.context = context_owner;
+        return parser_state;
+    }
+
+    std::size_t index = parser_state.index;
+    std::optional<parser_state_t> memoized = context->memo_find(this, index);
+    if (memoized.has_value())
+        return memoized->set_context(context_owner);
+
+    parser_state = run(std::move(parser_state));
+    context->memo_store(this, index, parser_state);
+    return parser_state.set_context(context_owner);
+}
+
 parser_t* parser_t::map(std::function<std::any(std::any)> f) const
 {
     return new map_parser_t(this, f);
@@ -184,6 +755,79 @@ parser_t* parser_t::chain(std::function<parser_t*(std::any)> f) const
     return new chain_parser_t(this, f);
 }
 
+parser_t& parser_t::set_memoize(bool _memoize)
+{
+    memoize = _memoize;
+    return *this;
+}
+
+bool parser_t::get_memoize() const
+{
+    return memoize;
+}
+
+parser_t& parser_t::set_label(std::string _label)
+{
+    label = std::move(_label);
+    return *this;
+}
+
+const std::string& parser_t::get_label() const
+{
+    return label;
+}
+
+std::string parser_t::get_name() const
+{
+    return "parser_t";
+}
+
+std::vector<const parser_t*> parser_t::get_children() const
+{
+    return {};
+}
+
+bool parser_t::forwards_result() const
+{
+    return false;
+}
+
+std::string parser_t::describe_error(const parse_error_t& error, [[maybe_unused]] std::string_view target_string) const
+{
+    return "parser_t::run(): Failed at index " + std::to_string(error.index);
+}
+
+std::string parser_t::describe_expected() const
+{
+    return "";
+}
+
+first_set_t parser_t::first_set([[maybe_unused]] const first_set_analysis_t& analysis) const
+{
+    return first_set_t::any();
+}
+
+
+parser_state_t parse(const parser_t* parser, std::string target_string, parse_options_t options)
+{
+    return parse(parser, std::make_shared<const std::string>(std::move(target_string)), options);
+}
+
+parser_state_t parse(const parser_t* parser, std::shared_ptr<const std::string> input, parse_options_t options)
+{
+    return parse(parser, parser_state_t(std::move(input)), options);
+}
+
+parser_state_t parse(const parser_t* parser, parser_state_t parser_state, parse_options_t options)
+{
+    std::shared_ptr<parse_context_t> context = std::make_shared<parse_context_t>(options);
+    parser_state.set_context(context);
+    parser_state = parser->apply(std::move(parser_state));
+    if (parser_state.error.has_value() && context->depth_error.has_value())
+        parser_state.error = context->depth_error;
+    return parser_state;
+}
+
 
 // -----
 
@@ -196,6 +840,23 @@ parser_state_t do_nothing_parser_t::run(parser_state_t parser_state) const
     return parser_state;
 }
 
+std::string do_nothing_parser_t::get_name() const
+{
+    return "do_nothing_parser_t";
+}
+
+first_set_t do_nothing_parser_t::first_set([[maybe_unused]] const first_set_analysis_t& analysis) const
+{
+    first_set_t result;
+    result.nullable = true;
+    return result;
+}
+
+bool do_nothing_parser_t::forwards_result() const
+{
+    return true;
+}
+
 
 // -----
 
@@ -210,7 +871,46 @@ lazy_parser_t::lazy_parser_t(const parser_t *_parser)
 
 parser_state_t lazy_parser_t::run(parser_state_t parser_state) const
 {
-    return parser->run(parser_state);
+    // The depth is counted by the context, so a run without one has no limit
+    parse_context_t *context = parser_state.context.get();
+    if (context == nullptr)
+        return parser->apply(std::move(parser_state));
+
+    // Recursive rules go through here, one level of nesting at a time
+    std::size_t max_depth = context->options.max_depth;
+    if (max_depth != 0 && context->depth >= max_depth) {
+        parser_state.fail(this);
+        if (!context->depth_error.has_value())
+            context->depth_error = parser_state.error;
+        return parser_state;
+    }
+
+    struct depth_guard_t {
+        std::size_t& depth;
+        depth_guard_t(std::size_t& _depth) : depth(++_depth) {}
+        ~depth_guard_t() { --depth; }
+    } guard(context->depth);
+    return parser->apply(std::move(parser_state));
+}
+
+std::string lazy_parser_t::get_name() const
+{
+    return "lazy_parser_t";
+}
+
+std::string lazy_parser_t::describe_error(const parse_error_t& error, std::string_view target_string) const
+{
+    return "lazy_parser_t::run(): The input is nested too deeply (see parse_options_t::max_depth) at the string \"" + string_at_most(target_string, 10, error.index) + "\"";
+}
+
+first_set_t lazy_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    return analysis.get(parser);
+}
+
+std::vector<const parser_t*> lazy_parser_t::get_children() const
+{
+    return {parser};
 }
 
 lazy_parser_t& lazy_parser_t::set_parser(const parser_t *_parser)
@@ -219,36 +919,60 @@ lazy_parser_t& lazy_parser_t::set_parser(const parser_t *_parser)
     return *this;
 }
 
+const parser_t* lazy_parser_t::get_parser() const
+{
+    return parser;
+}
+
 
 // -----
 
 
 map_parser_t::map_parser_t()
-: parser(new do_nothing_parser_t()),
-  f([](std::any a) {return a;})
+: parser(shared_do_nothing_parser()),
+  f([](std::any a) {return a;}),
+  identity(true)
 {}
 
 map_parser_t::map_parser_t(const parser_t *_parser)
 : parser(_parser),
-  f([](std::any a) {return a;})
+  f([](std::any a) {return a;}),
+  identity(true)
 {}
 
 map_parser_t::map_parser_t(std::function<std::any(std::any)> _f)
-: parser(new do_nothing_parser_t()),
-  f(_f)
+: parser(shared_do_nothing_parser()),
+  f(_f),
+  identity(false)
 {}
 
 map_parser_t::map_parser_t(const parser_t *_parser, std::function<std::any(std::any)> _f)
 : parser(_parser),
-  f(_f)
+  f(_f),
+  identity(false)
 {}
 
 parser_state_t map_parser_t::run(parser_state_t parser_state) const
 {
     if (parser_state.error.has_value())
         return parser_state;
-    parser_state = parser->run(parser_state);
-    return parser_state.map_result(f);
+    parser_state = parser->apply(std::move(parser_state));
+    return std::move(parser_state).map_result(f);
+}
+
+std::string map_parser_t::get_name() const
+{
+    return "map_parser_t";
+}
+
+first_set_t map_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    return analysis.get(parser);
+}
+
+std::vector<const parser_t*> map_parser_t::get_children() const
+{
+    return {parser};
 }
 
 map_parser_t& map_parser_t::set_parser(const parser_t *_parser)
@@ -260,25 +984,41 @@ map_parser_t& map_parser_t::set_parser(const parser_t *_parser)
 map_parser_t& map_parser_t::set_f(std::function<std::any(std::any)> _f)
 {
     f = _f;
+    identity = false;
     return *this;
 }
 
+const parser_t* map_parser_t::get_parser() const
+{
+    return parser;
+}
+
+const std::function<std::any(std::any)>& map_parser_t::get_f() const
+{
+    return f;
+}
+
+bool map_parser_t::is_identity() const
+{
+    return identity;
+}
+
 
 // -----
 
 
 chain_parser_t::chain_parser_t()
-: parser(new do_nothing_parser_t()),
-  f([]([[maybe_unused]] std::any a) {return new do_nothing_parser_t();})
+: parser(shared_do_nothing_parser()),
+  f([]([[maybe_unused]] std::any a) {return shared_do_nothing_parser();})
 {}
 
 chain_parser_t::chain_parser_t(const parser_t *_parser)
 : parser(_parser),
-  f([]([[maybe_unused]] std::any a) {return new do_nothing_parser_t();})
+  f([]([[maybe_unused]] std::any a) {return shared_do_nothing_parser();})
 {}
 
 chain_parser_t::chain_parser_t(std::function<parser_t*(std::any)> _f)
-: parser(new do_nothing_parser_t()),
+: parser(shared_do_nothing_parser()),
   f(_f)
 {}
 
@@ -291,10 +1031,27 @@ parser_state_t chain_parser_t::run(parser_state_t parser_state) const
 {
     if (parser_state.error.has_value())
         return parser_state;
-    parser_state = parser->run(parser_state);
+    parser_state = parser->apply(std::move(parser_state));
     return parser_state.chain(f);
 }
 
+std::string chain_parser_t::get_name() const
+{
+    return "chain_parser_t";
+}
+
+first_set_t chain_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    // The parser chained to is only known at run time
+    first_set_t first = analysis.get(parser);
+    return first.nullable ? first_set_t::any() : first;
+}
+
+std::vector<const parser_t*> chain_parser_t::get_children() const
+{
+    return {parser};
+}
+
 chain_parser_t& chain_parser_t::set_parser(const parser_t *_parser)
 {
     parser = _parser;
@@ -307,6 +1064,16 @@ chain_parser_t& chain_parser_t::set_f(std::function<parser_t*(std::any)> _f)
     return *this;
 }
 
+const parser_t* chain_parser_t::get_parser() const
+{
+    return parser;
+}
+
+const std::function<parser_t*(std::any)>& chain_parser_t::get_f() const
+{
+    return f;
+}
+
 
 // -----
 
@@ -323,8 +1090,23 @@ parser_state_t flatten_parser_t::run(parser_state_t parser_state) const
 {
     if (parser_state.error.has_value())
         return parser_state;
-    parser_state = parser->run(parser_state);
-    return parser_state.flatten_result();
+    parser_state = parser->apply(std::move(parser_state));
+    return std::move(parser_state).flatten_result();
+}
+
+std::string flatten_parser_t::get_name() const
+{
+    return "flatten_parser_t";
+}
+
+first_set_t flatten_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    return analysis.get(parser);
+}
+
+std::vector<const parser_t*> flatten_parser_t::get_children() const
+{
+    return {parser};
 }
 
 flatten_parser_t& flatten_parser_t::set_parser(const parser_t *_parser)
@@ -333,6 +1115,11 @@ flatten_parser_t& flatten_parser_t::set_parser(const parser_t *_parser)
     return *this;
 }
 
+const parser_t* flatten_parser_t::get_parser() const
+{
+    return parser;
+}
+
 
 // -----
 
@@ -350,16 +1137,40 @@ parser_state_t sequence_of_parser_t::run(parser_state_t parser_state) const
     if (parser_state.error.has_value())
         return parser_state;
 
-    std::vector<std::any> results;
-    for (auto parser : this->parsers) {
-        parser_state = parser->run(parser_state);
-        results.emplace_back(parser_state.result);
-    }
+    std::size_t begin = parser_state.index;
+    parser_state.note_event(parse_event_kind_t::begin, this, begin, begin);
+    std::any results = collect_results(parser_state, [&](auto& results) {
+        results.reserve(this->parsers.size());
+        for (std::size_t i = 0; i < this->parsers.size(); ++i) {
+            parser_state = this->parsers[i]->apply(std::move(parser_state));
+            // The next parser gets to see this result, the last one is free
+            if (i + 1 < this->parsers.size())
+                results.emplace_back(parser_state.result);
+            else
+                results.emplace_back(std::move(parser_state.result));
+        }
+    });
 
     if (parser_state.error.has_value())
         return parser_state;
 
-    return parser_state.set_result(results);
+    parser_state.note_event(parse_event_kind_t::end, this, begin, parser_state.index);
+    return parser_state.set_result(std::move(results));
+}
+
+std::string sequence_of_parser_t::get_name() const
+{
+    return "sequence_of_parser_t";
+}
+
+first_set_t sequence_of_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    return sequence_first_set(analysis, parsers);
+}
+
+std::vector<const parser_t*> sequence_of_parser_t::get_children() const
+{
+    return parsers;
 }
 
 sequence_of_parser_t& sequence_of_parser_t::set_parsers(std::vector<const parser_t*> _parsers)
@@ -380,16 +1191,23 @@ sequence_of_parser_t& sequence_of_parser_t::clear()
     return *this;
 }
 
+const std::vector<const parser_t*>& sequence_of_parser_t::get_parsers() const
+{
+    return parsers;
+}
+
 
 // -----
 
 
 choice_of_parser_t::choice_of_parser_t()
-: parsers()
+: parsers(),
+  dispatch_table()
 {}
 
 choice_of_parser_t::choice_of_parser_t(std::vector<const parser_t*> _parsers)
-: parsers(_parsers)
+: parsers(_parsers),
+  dispatch_table()
 {}
 
 parser_state_t choice_of_parser_t::run(parser_state_t parser_state) const
@@ -397,35 +1215,98 @@ parser_state_t choice_of_parser_t::run(parser_state_t parser_state) const
     if (parser_state.error.has_value())
         return parser_state;
 
-    for (auto parser : this->parsers) {
-        parser_state_t next_state = parser->run(parser_state);
-        if (!next_state.error.has_value())
-            return next_state;
+    if (dispatch_table) {
+        // Only the alternatives that can start with the next byte, which is
+        // thus read (or found missing)
+        parser_state.note_lookahead(parser_state.index + 1);
+        std::size_t slot = parser_state.index < parser_state.target_string.size()
+            ? (unsigned char)parser_state.target_string[parser_state.index]
+            : 256;
+        for (const std::uint32_t *it = dispatch_table->begin(slot); it != dispatch_table->end(slot); ++it) {
+            event_attempt_t attempt(parser_state);
+            parser_state_t next_state = this->parsers[*it]->apply(parser_state);
+            attempt.end(!next_state.error.has_value());
+            if (!next_state.error.has_value() || is_depth_failure(next_state))
+                return next_state;
+        }
+    } else {
+        for (auto parser : this->parsers) {
+            event_attempt_t attempt(parser_state);
+            parser_state_t next_state = parser->apply(parser_state);
+            attempt.end(!next_state.error.has_value());
+            if (!next_state.error.has_value() || is_depth_failure(next_state))
+                return next_state;
+        }
     }
 
     return parser_state
         .set_result("")
-        .set_error("choice_of_parser_t::run(): Unable to match with any parser the string \"" + string_at_most(parser_state.target_string, 10, parser_state.index) + "\"");
+        .fail(this);
+}
+
+std::string choice_of_parser_t::get_name() const
+{
+    return "choice_of_parser_t";
+}
+
+first_set_t choice_of_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    first_set_t result;
+    for (const parser_t *parser : parsers) {
+        first_set_t first = analysis.get(parser);
+        result.bytes.add_class(first.bytes);
+        result.nullable = result.nullable || first.nullable;
+    }
+    return result;
+}
+
+std::vector<const parser_t*> choice_of_parser_t::get_children() const
+{
+    return parsers;
+}
+
+std::string choice_of_parser_t::describe_error(const parse_error_t& error, std::string_view target_string) const
+{
+    return "choice_of_parser_t::run(): Unable to match with any parser the string \"" + string_at_most(target_string, 10, error.index) + "\"";
 }
 
 choice_of_parser_t& choice_of_parser_t::set_parsers(std::vector<const parser_t*> _parsers)
 {
     parsers = _parsers;
+    dispatch_table.reset();
     return *this;
 }
 
 choice_of_parser_t& choice_of_parser_t::add_parser(const parser_t* parser)
 {
     parsers.push_back(parser);
+    dispatch_table.reset();
     return *this;
 }
 
 choice_of_parser_t& choice_of_parser_t::clear()
 {
     parsers.clear();
+    dispatch_table.reset();
+    return *this;
+}
+
+const std::vector<const parser_t*>& choice_of_parser_t::get_parsers() const
+{
+    return parsers;
+}
+
+const choice_of_parser_t& choice_of_parser_t::set_dispatch_table(std::shared_ptr<const dispatch_table_t> _dispatch_table) const
+{
+    dispatch_table = std::move(_dispatch_table);
     return *this;
 }
 
+std::shared_ptr<const dispatch_table_t> choice_of_parser_t::get_dispatch_table() const
+{
+    return dispatch_table;
+}
+
 
 // -----
 
@@ -440,20 +1321,57 @@ many_parser_t::many_parser_t(const parser_t* _parser)
 
 parser_state_t many_parser_t::run(parser_state_t parser_state) const
 {
+    std::size_t count = 0;
+    return run_counted(std::move(parser_state), count);
+}
+
+parser_state_t many_parser_t::run_counted(parser_state_t parser_state, std::size_t& count) const
+{
+    count = 0;
     if (parser_state.error.has_value())
         return parser_state;
 
-    parser_state_t next_state;
-    std::vector<std::any> results;
-    do {
-        next_state = parser->run(parser_state);
-        if (next_state.error.has_value())
-            break;
-        parser_state = next_state;
-        results.emplace_back(next_state.result);
-    } while (1);
+    std::size_t begin = parser_state.index;
+    parser_state.note_event(parse_event_kind_t::begin, this, begin, begin);
+    std::optional<parser_state_t> depth_failure;
+    std::any results = collect_results(parser_state, [&](auto& results) {
+        do {
+            event_attempt_t attempt(parser_state);
+            parser_state_t next_state = parser->apply(parser_state);
+            attempt.end(!next_state.error.has_value());
+            if (next_state.error.has_value()) {
+                if (is_depth_failure(next_state))
+                    depth_failure = std::move(next_state);
+                break;
+            }
+            next_state.note_event(parse_event_kind_t::item, this, parser_state.index, next_state.index);
+            results.emplace_back(next_state.result);
+            ++count;
+            parser_state = std::move(next_state);
+        } while (1);
+    });
+    if (depth_failure.has_value())
+        return std::move(*depth_failure);
+
+    parser_state.note_event(parse_event_kind_t::end, this, begin, parser_state.index);
+    return parser_state.set_result(std::move(results));
+}
+
+std::string many_parser_t::get_name() const
+{
+    return "many_parser_t";
+}
+
+first_set_t many_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    first_set_t result = analysis.get(parser);
+    result.nullable = true;
+    return result;
+}
 
-    return parser_state.set_result(results);
+std::vector<const parser_t*> many_parser_t::get_children() const
+{
+    return {parser};
 }
 
 many_parser_t& many_parser_t::set_parser(const parser_t* _parser)
@@ -462,6 +1380,11 @@ many_parser_t& many_parser_t::set_parser(const parser_t* _parser)
     return *this;
 }
 
+const parser_t* many_parser_t::get_parser() const
+{
+    return parser;
+}
+
 
 // -----
 
@@ -476,18 +1399,33 @@ many1_parser_t::many1_parser_t(const parser_t* _parser)
 
 parser_state_t many1_parser_t::run(parser_state_t parser_state) const
 {
-    parser_state = many_parser_t::run(parser_state);
+    std::size_t count = 0;
+    parser_state = run_counted(std::move(parser_state), count);
     if (!parser_state.error.has_value()) {
-        std::vector<std::any> results = std::any_cast< std::vector<std::any> >(parser_state.result);
-        if (results.size() == 0) {
-            return parser_state_t()
+        if (count == 0) {
+            return parser_state
                 .set_result("")
-                .set_error("many1_parser_t::run(): Unable to match any inputs using given parser for the string \"" + string_at_most(parser_state.target_string, 10, parser_state.index) + "\"");
+                .fail(this);
         }
     }
     return parser_state;
 }
 
+std::string many1_parser_t::get_name() const
+{
+    return "many1_parser_t";
+}
+
+first_set_t many1_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    return analysis.get(get_children()[0]);
+}
+
+std::string many1_parser_t::describe_error(const parse_error_t& error, std::string_view target_string) const
+{
+    return "many1_parser_t::run(): Unable to match any inputs using given parser for the string \"" + string_at_most(target_string, 10, error.index) + "\"";
+}
+
 many1_parser_t& many1_parser_t::set_parser(const parser_t* _parser)
 {
     many_parser_t::set_parser(_parser);
@@ -504,19 +1442,19 @@ between_parser_t::between_parser_t()
   content_parser(nullptr)
 {}
 
-between_parser_t::between_parser_t(parser_t* content_parser)
+between_parser_t::between_parser_t(const parser_t* content_parser)
 : left_parser(nullptr),
   right_parser(nullptr),
   content_parser(content_parser)
 {}
 
-between_parser_t::between_parser_t(parser_t* _left_parser, parser_t* _right_parser)
+between_parser_t::between_parser_t(const parser_t* _left_parser, const parser_t* _right_parser)
 : left_parser(_left_parser),
   right_parser(_right_parser),
   content_parser(nullptr)
 {}
 
-between_parser_t::between_parser_t(parser_t* _left_parser, parser_t* _right_parser, parser_t* content_parser)
+between_parser_t::between_parser_t(const parser_t* _left_parser, const parser_t* _right_parser, const parser_t* content_parser)
 : left_parser(_left_parser),
   right_parser(_right_parser),
   content_parser(content_parser)
@@ -524,20 +1462,69 @@ between_parser_t::between_parser_t(parser_t* _left_parser, parser_t* _right_pars
 
 parser_state_t between_parser_t::run(parser_state_t parser_state) const
 {
-    sequence_of_parser_t sequence_of_parser;
-    sequence_of_parser.add_parser(left_parser);
-    sequence_of_parser.add_parser(content_parser);
-    sequence_of_parser.add_parser(right_parser);
-    parser_state = sequence_of_parser.run(parser_state);
-    if (!parser_state.error.has_value()) {
-        std::vector<std::any> v = std::any_cast< std::vector<std::any> >(parser_state.result);
-        if (v.size() == 0) {
-            // TODO
-            throw -1;
-        }
-        parser_state.set_result(v[1]);
-    }
-    return parser_state;
+    if (parser_state.error.has_value())
+        return parser_state;
+
+    parser_state = apply_muted(left_parser, std::move(parser_state));
+    if (parser_state.error.has_value())
+        return parser_state;
+    parser_state = content_parser->apply(std::move(parser_state));
+    if (parser_state.error.has_value())
+        return parser_state;
+    // right_parser gets to see the content too, as in a sequence
+    std::any content = parser_state.result;
+    parser_state = apply_muted(right_parser, std::move(parser_state));
+    if (parser_state.error.has_value())
+        return parser_state;
+    return parser_state.set_result(std::move(content));
+}
+
+std::string between_parser_t::get_name() const
+{
+    return "between_parser_t";
+}
+
+first_set_t between_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    return sequence_first_set(analysis, {left_parser, content_parser, right_parser});
+}
+
+std::vector<const parser_t*> between_parser_t::get_children() const
+{
+    return {left_parser, content_parser, right_parser};
+}
+
+between_parser_t& between_parser_t::set_left_parser(const parser_t* _left_parser)
+{
+    left_parser = _left_parser;
+    return *this;
+}
+
+between_parser_t& between_parser_t::set_right_parser(const parser_t* _right_parser)
+{
+    right_parser = _right_parser;
+    return *this;
+}
+
+between_parser_t& between_parser_t::set_content_parser(const parser_t* _content_parser)
+{
+    content_parser = _content_parser;
+    return *this;
+}
+
+const parser_t* between_parser_t::get_left_parser() const
+{
+    return left_parser;
+}
+
+const parser_t* between_parser_t::get_right_parser() const
+{
+    return right_parser;
+}
+
+const parser_t* between_parser_t::get_content_parser() const
+{
+    return content_parser;
 }
 
 
@@ -549,12 +1536,12 @@ separated_by_parser_t::separated_by_parser_t()
   value_parser(nullptr)
 {}
 
-separated_by_parser_t::separated_by_parser_t(parser_t* _seaparator_parser)
+separated_by_parser_t::separated_by_parser_t(const parser_t* _seaparator_parser)
 : seaparator_parser(_seaparator_parser),
   value_parser(nullptr)
 {}
 
-separated_by_parser_t::separated_by_parser_t(parser_t* _seaparator_parser, parser_t* _value_parser)
+separated_by_parser_t::separated_by_parser_t(const parser_t* _seaparator_parser, const parser_t* _value_parser)
 : seaparator_parser(_seaparator_parser),
   value_parser(_value_parser)
 {}
@@ -564,45 +1551,95 @@ parser_state_t separated_by_parser_t::run(parser_state_t parser_state) const
     if (parser_state.error.has_value())
         return parser_state;
     if (seaparator_parser == nullptr) {
-        return parser_state_t()
+        return parser_state
             .set_result("")
-            .set_error("separated_by_parser_t::run(): seaparator_parser is NULL");
+            .fail(this, null_separator_parser);
     }
     if (value_parser == nullptr) {
-        return parser_state_t()
+        return parser_state
             .set_result("")
-            .set_error("separated_by_parser_t::run(): value_parser is NULL");
+            .fail(this, null_value_parser);
     }
 
-    parser_state_t next_state = parser_state;
-    std::vector<std::any> results;
-    do {
-        parser_state_t wanted_state = value_parser->run(next_state);
-        if (wanted_state.error.has_value())
-            break;
-        results.emplace_back(wanted_state.result);
-        next_state = wanted_state;
-        parser_state_t separator_state = seaparator_parser->run(next_state);
-        if (separator_state.error.has_value())
-            break;
-        next_state = separator_state;
-    } while (1);
+    std::size_t begin = parser_state.index;
+    parser_state.note_event(parse_event_kind_t::begin, this, begin, begin);
+    std::optional<parser_state_t> depth_failure;
+    std::any results = collect_results(parser_state, [&](auto& results) {
+        do {
+            event_attempt_t attempt(parser_state);
+            parser_state_t wanted_state = value_parser->apply(parser_state);
+            attempt.end(!wanted_state.error.has_value());
+            if (wanted_state.error.has_value()) {
+                if (is_depth_failure(wanted_state))
+                    depth_failure = std::move(wanted_state);
+                break;
+            }
+            wanted_state.note_event(parse_event_kind_t::item, this, parser_state.index, wanted_state.index);
+            results.emplace_back(wanted_state.result);
+            parser_state = std::move(wanted_state);
+            parser_state_t separator_state = apply_muted(seaparator_parser, parser_state);
+            if (separator_state.error.has_value()) {
+                if (is_depth_failure(separator_state))
+                    depth_failure = std::move(separator_state);
+                break;
+            }
+            parser_state = std::move(separator_state);
+        } while (1);
+    });
+    if (depth_failure.has_value())
+        return std::move(*depth_failure);
+
+    parser_state.note_event(parse_event_kind_t::end, this, begin, parser_state.index);
+    return parser_state.set_result(std::move(results));
+}
+
+std::string separated_by_parser_t::get_name() const
+{
+    return "separated_by_parser_t";
+}
+
+first_set_t separated_by_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    // Zero values is a match as well
+    first_set_t result = analysis.get(value_parser);
+    result.nullable = true;
+    return result;
+}
+
+std::vector<const parser_t*> separated_by_parser_t::get_children() const
+{
+    return {value_parser, seaparator_parser};
+}
 
-    return next_state.set_result(results);
+std::string separated_by_parser_t::describe_error(const parse_error_t& error, [[maybe_unused]] std::string_view target_string) const
+{
+    if (error.code == null_separator_parser)
+        return "separated_by_parser_t::run(): seaparator_parser is NULL";
+    return "separated_by_parser_t::run(): value_parser is NULL";
 }
 
-separated_by_parser_t& separated_by_parser_t::set_seaparator_parser(parser_t* _seaparator_parser)
+separated_by_parser_t& separated_by_parser_t::set_seaparator_parser(const parser_t* _seaparator_parser)
 {
     seaparator_parser = _seaparator_parser;
     return *this;
 }
 
-separated_by_parser_t& separated_by_parser_t::set_value_parser(parser_t* _value_parser)
+separated_by_parser_t& separated_by_parser_t::set_value_parser(const parser_t* _value_parser)
 {
     value_parser = _value_parser;
     return *this;
 }
 
+const parser_t* separated_by_parser_t::get_seaparator_parser() const
+{
+    return seaparator_parser;
+}
+
+const parser_t* separated_by_parser_t::get_value_parser() const
+{
+    return value_parser;
+}
+
 
 // -----
 
@@ -620,22 +1657,51 @@ parser_state_t string_parser_t::run(parser_state_t parser_state) const
     if (parser_state.error.has_value())
         return parser_state;
 
+    parser_state.note_lookahead(parser_state.index + this->s.size());
     if (parser_state.target_string.size() == 0) {
         return parser_state
             .set_result("")
-            .set_error("string_parser_t::run(): Unexpected end of string");
+            .fail(this, unexpected_end);
     }
 
     if (string_starts_with(parser_state.target_string, this->s, parser_state.index)) {
-        return parser_state_t()
-            .set_target_string(parser_state.target_string)
-            .set_result(this->s)
-            .set_index(parser_state.index + this->s.size());
+        std::size_t end = parser_state.index + this->s.size();
+        parser_state.note_event(parse_event_kind_t::leaf, this, parser_state.index, end);
+        return parser_state
+            .set_result(parser_state.wants_spans() ? parser_state.slice(parser_state.index, end) : std::any(this->s))
+            .set_index(end);
     }
 
     return parser_state
         .set_result("")
-        .set_error("string_parser_t::run(): Couldn't match \"" + this->s + "\" in \"" + string_at_most<true>(parser_state.target_string, 10, parser_state.index) + "\"");
+        .fail(this);
+}
+
+std::string string_parser_t::get_name() const
+{
+    return "string_parser_t";
+}
+
+first_set_t string_parser_t::first_set([[maybe_unused]] const first_set_analysis_t& analysis) const
+{
+    first_set_t result;
+    if (s.empty())
+        result.nullable = true;
+    else
+        result.bytes.add((unsigned char)s[0]);
+    return result;
+}
+
+std::string string_parser_t::describe_error(const parse_error_t& error, std::string_view target_string) const
+{
+    if (error.code == unexpected_end)
+        return "string_parser_t::run(): Unexpected end of string";
+    return "string_parser_t::run(): Couldn't match \"" + this->s + "\" in \"" + string_at_most<true>(target_string, 10, error.index) + "\"";
+}
+
+std::string string_parser_t::describe_expected() const
+{
+    return "\"" + this->s + "\"";
 }
 
 string_parser_t& string_parser_t::set_string(std::string _s)
@@ -644,61 +1710,141 @@ string_parser_t& string_parser_t::set_string(std::string _s)
     return *this;
 }
 
+const std::string& string_parser_t::get_string() const
+{
+    return s;
+}
+
 
 // -----
 
 
 choice_of_string_parser_t::choice_of_string_parser_t()
-: words()
+: words(),
+  trie(),
+  match_mode(match_mode_t::first_listed)
 {}
 
 choice_of_string_parser_t::choice_of_string_parser_t(std::vector<std::string> _words)
-: words(_words)
+: choice_of_string_parser_t(_words, match_mode_t::first_listed)
 {}
 
+choice_of_string_parser_t::choice_of_string_parser_t(std::vector<std::string> _words, match_mode_t _match_mode)
+: words(),
+  trie(),
+  match_mode(_match_mode)
+{
+    set_words(_words);
+}
+
 parser_state_t choice_of_string_parser_t::run(parser_state_t parser_state) const
 {
     if (parser_state.error.has_value())
         return parser_state;
 
-    string_parser_t parser;
-
-    for (const std::string& word : this->words) {
-        parser_state_t next_state = parser.set_string(word).run(parser_state);
-        if (!next_state.error.has_value())
-            return next_state;
+    parser_state.note_lookahead(parser_state.index + trie.get_max_length());
+    if (parser_state.target_string.size() != 0 && parser_state.index <= parser_state.target_string.size()) {
+        string_trie_t::match_t match = (match_mode == match_mode_t::longest)
+            ? trie.match_longest(parser_state.target_string, parser_state.index)
+            : trie.match_first(parser_state.target_string, parser_state.index);
+        if (match.word != string_trie_t::npos) {
+            std::size_t end = parser_state.index + match.length;
+            parser_state.note_event(parse_event_kind_t::leaf, this, parser_state.index, end);
+            return parser_state
+                .set_result(parser_state.wants_spans() ? parser_state.slice(parser_state.index, end) : std::any(words[match.word]))
+                .set_index(end);
+        }
     }
 
     return parser_state
         .set_result("")
-        .set_error("choice_of_string_parser_t::run(): Unable to match with any parser the string \"" + string_at_most(parser_state.target_string, 10, parser_state.index) + "\"");
+        .fail(this);
+}
+
+std::string choice_of_string_parser_t::get_name() const
+{
+    return "choice_of_string_parser_t";
+}
+
+first_set_t choice_of_string_parser_t::first_set([[maybe_unused]] const first_set_analysis_t& analysis) const
+{
+    first_set_t result;
+    for (int c = 0; c < 256; ++c) {
+        if (trie.can_start_with((unsigned char)c))
+            result.bytes.add((unsigned char)c);
+    }
+    result.nullable = trie.has_empty_word();
+    return result;
+}
+
+std::string choice_of_string_parser_t::describe_error(const parse_error_t& error, std::string_view target_string) const
+{
+    return "choice_of_string_parser_t::run(): Unable to match with any parser the string \"" + string_at_most(target_string, 10, error.index) + "\"";
+}
+
+std::string choice_of_string_parser_t::describe_expected() const
+{
+    std::string result;
+    for (std::size_t i = 0; i < words.size(); ++i)
+        result += (i == 0 ? "\"" : " | \"") + words[i] + "\"";
+    return words.size() == 1 ? result : "one of " + result;
 }
 
 choice_of_string_parser_t& choice_of_string_parser_t::set_words(std::vector<std::string> _words)
 {
     words = _words;
+    trie.clear();
+    for (std::size_t i = 0; i < words.size(); ++i)
+        trie.insert(words[i], i);
     return *this;
 }
 
 choice_of_string_parser_t& choice_of_string_parser_t::add_word(std::string _word)
 {
     words.push_back(_word);
+    trie.insert(words.back(), words.size() - 1);
     return *this;
 }
 
 choice_of_string_parser_t& choice_of_string_parser_t::clear()
 {
     words.clear();
+    trie.clear();
+    return *this;
+}
+
+choice_of_string_parser_t& choice_of_string_parser_t::set_match_mode(match_mode_t _match_mode)
+{
+    match_mode = _match_mode;
     return *this;
 }
 
+const std::vector<std::string>& choice_of_string_parser_t::get_words() const
+{
+    return words;
+}
+
+const string_trie_t& choice_of_string_parser_t::get_trie() const
+{
+    return trie;
+}
+
+choice_of_string_parser_t::match_mode_t choice_of_string_parser_t::get_match_mode() const
+{
+    return match_mode;
+}
+
 
 
 // -----
 
 
 char_parser_t::char_parser_t(std::regex _rexp)
-: rexp(_rexp)
+: char_class(_rexp)
+{}
+
+char_parser_t::char_parser_t(char_class_t _char_class)
+: char_class(_char_class)
 {}
 
 parser_state_t char_parser_t::run(parser_state_t parser_state) const
@@ -706,110 +1852,240 @@ parser_state_t char_parser_t::run(parser_state_t parser_state) const
     if (parser_state.error.has_value())
         return parser_state;
 
+    parser_state.note_lookahead(parser_state.index + 1);
     if (parser_state.target_string.size() == 0) {
         return parser_state
             .set_result("")
-            .set_error("char_parser_t::run(): Unexpected end of string");
+            .fail(this, unexpected_end);
     }
 
     if (parser_state.index < parser_state.target_string.size()) {
-        std::string first_char = std::string(1, parser_state.target_string[parser_state.index]);
-        if (std::regex_search(first_char, rexp)) {
-            return parser_state_t()
-                .set_target_string(parser_state.target_string)
-                .set_result(first_char)
+        if (char_class.contains((unsigned char)parser_state.target_string[parser_state.index])) {
+            parser_state.note_event(parse_event_kind_t::leaf, this, parser_state.index, parser_state.index + 1);
+            return parser_state
+                .set_result(parser_state.slice(parser_state.index, parser_state.index + 1))
                 .set_index(parser_state.index + 1);
         }
     }
 
     return parser_state
         .set_result("")
-        .set_error("char_parser_t::run(): Couldn't match any character TODO in \"" + string_at_most<true>(parser_state.target_string, 10, parser_state.index) + "\"");
+        .fail(this);
+}
+
+std::string char_parser_t::get_name() const
+{
+    return "char_parser_t";
+}
+
+first_set_t char_parser_t::first_set([[maybe_unused]] const first_set_analysis_t& analysis) const
+{
+    first_set_t result;
+    result.bytes = char_class;
+    return result;
+}
+
+std::string char_parser_t::describe_error(const parse_error_t& error, std::string_view target_string) const
+{
+    if (error.code == unexpected_end)
+        return "char_parser_t::run(): Unexpected end of string";
+    return "char_parser_t::run(): Couldn't match any character of " + char_class.to_string() + " in \"" + string_at_most<true>(target_string, 10, error.index) + "\"";
+}
+
+std::string char_parser_t::describe_expected() const
+{
+    return "a character of " + char_class.to_string();
+}
+
+const char_class_t& char_parser_t::get_char_class() const
+{
+    return char_class;
 }
 
 letter_parser_t::letter_parser_t()
-: char_parser_t(std::regex(R"([A-Za-z])"))
+: char_parser_t(char_class_t(R"([A-Za-z])"))
 {}
 
+std::string letter_parser_t::get_name() const
+{
+    return "letter_parser_t";
+}
+
 digit_parser_t::digit_parser_t()
-: char_parser_t(std::regex(R"([0-9])"))
+: char_parser_t(char_class_t(R"([0-9])"))
 {}
 
+std::string digit_parser_t::get_name() const
+{
+    return "digit_parser_t";
+}
+
 whitespace_parser_t::whitespace_parser_t()
-: char_parser_t(std::regex(R"(\s)"))
+: char_parser_t(char_class_t(R"(\s)"))
 {}
 
+std::string whitespace_parser_t::get_name() const
+{
+    return "whitespace_parser_t";
+}
+
 
 // -----
 
 
 chars_parser_t::chars_parser_t(std::regex _rexp)
-: char_parser(_rexp)
+: scanner(char_class_t(_rexp))
+{}
+
+chars_parser_t::chars_parser_t(char_class_t _char_class)
+: scanner(_char_class)
 {}
 
 parser_state_t chars_parser_t::run(parser_state_t parser_state) const
 {
-    parser_state = many1_parser_t(&char_parser).run(parser_state);
     if (parser_state.error.has_value())
         return parser_state;
-    
-    return parser_state.map_result(
-        [](std::any x) {
-            std::vector<std::any> v = std::any_cast< std::vector<std::any> >(x);
-            std::string s;
-            for (std::any& a : v)
-                s += std::any_cast<std::string>(a);
-            return s;
-        }
-    );
+
+    std::size_t end = scanner.scan(parser_state.target_string, parser_state.index);
+    // The run stopped at the byte at end, or at the end of the input
+    parser_state.note_lookahead(end + 1);
+    if (end == parser_state.index || parser_state.index >= parser_state.target_string.size()) {
+        return parser_state
+            .set_result("")
+            .fail(this);
+    }
+
+    parser_state.note_event(parse_event_kind_t::leaf, this, parser_state.index, end);
+    return parser_state
+        .set_result(parser_state.slice(parser_state.index, end))
+        .set_index(end);
+}
+
+std::string chars_parser_t::get_name() const
+{
+    return "chars_parser_t";
+}
+
+first_set_t chars_parser_t::first_set([[maybe_unused]] const first_set_analysis_t& analysis) const
+{
+    first_set_t result;
+    result.bytes = scanner.get_char_class();
+    return result;
+}
+
+std::string chars_parser_t::describe_error(const parse_error_t& error, std::string_view target_string) const
+{
+    return "chars_parser_t::run(): Couldn't match any character of " + scanner.get_char_class().to_string() + " in \"" + string_at_most<true>(target_string, 10, error.index) + "\"";
+}
+
+std::string chars_parser_t::describe_expected() const
+{
+    return "one or more characters of " + scanner.get_char_class().to_string();
+}
+
+const char_class_t& chars_parser_t::get_char_class() const
+{
+    return scanner.get_char_class();
 }
 
 letters_parser_t::letters_parser_t()
-: chars_parser_t(std::regex(R"([A-Za-z])"))
+: chars_parser_t(char_class_t(R"([A-Za-z])"))
 {}
 
+std::string letters_parser_t::get_name() const
+{
+    return "letters_parser_t";
+}
+
 digits_parser_t::digits_parser_t()
-: chars_parser_t(std::regex(R"([0-9])"))
+: chars_parser_t(char_class_t(R"([0-9])"))
 {}
 
+std::string digits_parser_t::get_name() const
+{
+    return "digits_parser_t";
+}
+
 whitespaces_parser_t::whitespaces_parser_t()
-: chars_parser_t(std::regex(R"(\s)"))
+: chars_parser_t(char_class_t(R"(\s)"))
 {}
 
+std::string whitespaces_parser_t::get_name() const
+{
+    return "whitespaces_parser_t";
+}
+
 
 // -----
 
 
 maybe_chars_parser_t::maybe_chars_parser_t(std::regex _rexp)
-: char_parser(_rexp)
+: scanner(char_class_t(_rexp))
+{}
+
+maybe_chars_parser_t::maybe_chars_parser_t(char_class_t _char_class)
+: scanner(_char_class)
 {}
 
 parser_state_t maybe_chars_parser_t::run(parser_state_t parser_state) const
 {
-    parser_state = many_parser_t(&char_parser).run(parser_state);    
-    return parser_state.map_result(
-        [](std::any x) {
-            std::vector<std::any> v = std::any_cast< std::vector<std::any> >(x);
-            std::string s;
-            for (std::any& a : v)
-                s += std::any_cast<std::string>(a);
-            return s;
-        }
-    );
+    if (parser_state.error.has_value())
+        return parser_state;
+
+    std::size_t index = std::min(parser_state.index, parser_state.target_string.size());
+    std::size_t end = scanner.scan(parser_state.target_string, index);
+    parser_state.note_lookahead(end + 1);
+    parser_state.note_event(parse_event_kind_t::leaf, this, index, end);
+    return parser_state
+        .set_result(parser_state.slice(index, end))
+        .set_index(std::max(end, parser_state.index));
+}
+
+std::string maybe_chars_parser_t::get_name() const
+{
+    return "maybe_chars_parser_t";
+}
+
+first_set_t maybe_chars_parser_t::first_set([[maybe_unused]] const first_set_analysis_t& analysis) const
+{
+    first_set_t result;
+    result.bytes = scanner.get_char_class();
+    result.nullable = true;
+    return result;
+}
+
+const char_class_t& maybe_chars_parser_t::get_char_class() const
+{
+    return scanner.get_char_class();
 }
 
 maybe_letters_parser_t::maybe_letters_parser_t()
-: maybe_chars_parser_t(std::regex(R"([A-Za-z])"))
+: maybe_chars_parser_t(char_class_t(R"([A-Za-z])"))
 {}
 
+std::string maybe_letters_parser_t::get_name() const
+{
+    return "maybe_letters_parser_t";
+}
+
 maybe_digits_parser_t::maybe_digits_parser_t()
-: maybe_chars_parser_t(std::regex(R"([0-9])"))
+: maybe_chars_parser_t(char_class_t(R"([0-9])"))
 {}
 
+std::string maybe_digits_parser_t::get_name() const
+{
+    return "maybe_digits_parser_t";
+}
+
 maybe_whitespaces_parser_t::maybe_whitespaces_parser_t()
-: maybe_chars_parser_t(std::regex(R"(\s)"))
+: maybe_chars_parser_t(char_class_t(R"(\s)"))
 {}
 
+std::string maybe_whitespaces_parser_t::get_name() const
+{
+    return "maybe_whitespaces_parser_t";
+}
+
 
 // -----
 } // namespace wi
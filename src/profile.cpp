@@ -0,0 +1,167 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "profile.hpp"
+#include "parser.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace wi {
+// -----
+
+
+std::string node_profile_t::get_name() const
+{
+    if (parser == nullptr)
+        return "";
+    const std::string& label = parser->get_label();
+    return label.empty() ? parser->get_name() : parser->get_name() + "[" + label + "]";
+}
+
+
+// -----
+
+
+parse_profile_t::parse_profile_t()
+: nodes(),
+  node_indices(),
+  active(),
+  paths(1, path_t{0, 0, {}, 0}),
+  stack()
+{}
+
+bool parse_profile_t::is_enabled()
+{
+#ifdef _WI_PROFILE_
+    return true;
+#else
+    return false;
+#endif
+}
+
+void parse_profile_t::enter(const parser_t *parser)
+{
+    std::size_t parent = stack.empty() ? 0 : stack.back().path;
+    std::size_t path = 0;
+    for (const auto& child : paths[parent].children) {
+        if (child.first == parser) {
+            path = child.second;
+            break;
+        }
+    }
+    if (path == 0) {
+        auto it = node_indices.find(parser);
+        if (it == node_indices.end()) {
+            it = node_indices.emplace(parser, nodes.size()).first;
+            nodes.emplace_back();
+            nodes.back().parser = parser;
+            active.push_back(0);
+        }
+        path = paths.size();
+        paths.push_back(path_t{parent, it->second, {}, 0});
+        paths[parent].children.emplace_back(parser, path);
+    }
+
+    ++active[paths[path].node];
+    stack.push_back(frame_t{path, clock_t::now(), 0});
+}
+
+void parse_profile_t::leave(std::size_t begin, std::size_t index, bool failed, std::size_t error_index)
+{
+    frame_t frame = stack.back();
+    stack.pop_back();
+    std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - frame.start).count();
+    std::uint64_t exclusive = elapsed - std::min(elapsed, frame.children_ns);
+    if (!stack.empty())
+        stack.back().children_ns += elapsed;
+
+    path_t& path = paths[frame.path];
+    path.exclusive_ns += exclusive;
+    node_profile_t& node = nodes[path.node];
+    ++node.calls;
+    ++(failed ? node.failures : node.successes);
+    node.exclusive_ns += exclusive;
+    // The bytes and time of a node running inside itself are those of the
+    // outer call already
+    if (--active[path.node] != 0)
+        return;
+    if (failed)
+        node.bytes_backtracked += error_index > begin ? error_index - begin : 0;
+    else
+        node.bytes_consumed += index > begin ? index - begin : 0;
+    node.inclusive_ns += elapsed;
+}
+
+std::vector<node_profile_t> parse_profile_t::get_nodes() const
+{
+    std::vector<node_profile_t> result = nodes;
+    std::stable_sort(result.begin(), result.end(), [](const node_profile_t& a, const node_profile_t& b) {
+        return a.exclusive_ns > b.exclusive_ns;
+    });
+    return result;
+}
+
+std::string parse_profile_t::to_folded_stacks() const
+{
+    // The frames of a line are separated by ';' and the count by a space
+    auto frame_name = [&](std::size_t node) {
+        std::string name = nodes[node].get_name();
+        std::replace(name.begin(), name.end(), ';', '_');
+        std::replace(name.begin(), name.end(), ' ', '_');
+        return name;
+    };
+
+    std::ostringstream ss;
+    for (std::size_t i = 1; i < paths.size(); ++i) {
+        if (paths[i].exclusive_ns == 0)
+            continue;
+        std::vector<std::size_t> frames;
+        for (std::size_t path = i; path != 0; path = paths[path].parent)
+            frames.push_back(paths[path].node);
+        for (auto it = frames.rbegin(); it != frames.rend(); ++it)
+            ss << (it == frames.rbegin() ? "" : ";") << frame_name(*it);
+        ss << " " << paths[i].exclusive_ns << "\n";
+    }
+    return ss.str();
+}
+
+std::string parse_profile_t::to_string() const
+{
+    std::ostringstream ss;
+    for (const node_profile_t& node : get_nodes()) {
+        ss << node.get_name() << ": " << node.calls << " calls (" << node.successes << " matched, "
+           << node.failures << " failed), " << node.bytes_consumed << " bytes consumed, "
+           << node.bytes_backtracked << " backtracked, " << node.inclusive_ns / 1e6 << " ms ("
+           << node.exclusive_ns / 1e6 << " ms exclusive)\n";
+    }
+    return ss.str();
+}
+
+bool parse_profile_t::empty() const
+{
+    return nodes.empty();
+}
+
+
+// -----
+} // namespace wi
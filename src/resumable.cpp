@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "resumable.hpp"
+
+namespace wi {
+// -----
+
+
+resumable_parser_t::resumable_parser_t(const vm_program_t& _program, parse_options_t _options)
+: program(_program),
+  options(std::move(_options)),
+  buffer(),
+  offset(0),
+  finished(false),
+  status(feed_status_t::need_more),
+  machine(),
+  parser_state(),
+  suspensions(0)
+{
+    if (options.on_event)
+        throw std::string("resumable_parser_t::resumable_parser_t(): Event mode is not supported");
+    // Spans would view a buffer that moves as it grows
+    options.span_results = false;
+    start();
+}
+
+feed_status_t resumable_parser_t::feed(std::string_view bytes)
+{
+    if (finished)
+        throw std::string("resumable_parser_t::feed(): The input was finished");
+    buffer.append(bytes);
+    return resume();
+}
+
+feed_status_t resumable_parser_t::finish()
+{
+    finished = true;
+    return resume();
+}
+
+feed_status_t resumable_parser_t::next()
+{
+    if (status != feed_status_t::done)
+        throw std::string("resumable_parser_t::next(): The current message is not done");
+    std::size_t consumed = std::min(parser_state.index, buffer.size());
+    buffer.erase(0, consumed);
+    offset += consumed;
+    start();
+    return resume();
+}
+
+feed_status_t resumable_parser_t::get_status() const
+{
+    return status;
+}
+
+const parser_state_t& resumable_parser_t::get_state() const
+{
+    return parser_state;
+}
+
+std::size_t resumable_parser_t::get_offset() const
+{
+    return offset;
+}
+
+std::string_view resumable_parser_t::get_buffer() const
+{
+    return buffer;
+}
+
+std::size_t resumable_parser_t::get_suspensions() const
+{
+    return suspensions;
+}
+
+void resumable_parser_t::start()
+{
+    machine = vm_machine_t();
+    parser_state = parser_state_t();
+    parser_state.set_context(std::make_shared<parse_context_t>(options));
+    status = feed_status_t::need_more;
+}
+
+feed_status_t resumable_parser_t::resume()
+{
+    if (status != feed_status_t::need_more)
+        return status;
+    // Nothing matches an empty input, which more bytes would change
+    if (buffer.empty() && !finished)
+        return status;
+
+    parser_state.target_string = buffer;
+    vm_status_t vm_status = program.execute(machine, parser_state, !finished);
+    if (vm_status == vm_status_t::suspended) {
+        ++suspensions;
+        // The memoized outcomes may have been cut short by the end of the input
+        if (parser_state.context->memo_size() != 0)
+            parser_state.context->clear_memo();
+        return status;
+    }
+
+    if (vm_status == vm_status_t::failed) {
+        // The grammar reports the error, from the start of the message
+        parser_state.index = 0;
+        parser_state.error.reset();
+        parser_state.result = std::string("");
+        parser_state = program.get_root()->apply(std::move(parser_state));
+        if (parser_state.error.has_value() && parser_state.context->depth_error.has_value())
+            parser_state.error = parser_state.context->depth_error;
+    }
+    machine = vm_machine_t();
+    status = parser_state.error.has_value() ? feed_status_t::error : feed_status_t::done;
+    return status;
+}
+
+
+// -----
+} // namespace wi
@@ -0,0 +1,254 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "stream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <memory>
+
+#include <unistd.h>
+
+namespace wi {
+// -----
+
+
+memory_source_t::memory_source_t(std::string_view _data)
+: data(_data),
+  position(0)
+{}
+
+std::size_t memory_source_t::read(char *buffer, std::size_t size)
+{
+    std::size_t n = std::min(size, data.size() - position);
+    std::memcpy(buffer, data.data() + position, n);
+    position += n;
+    return n;
+}
+
+istream_source_t::istream_source_t(std::istream& _stream)
+: stream(_stream)
+{}
+
+std::size_t istream_source_t::read(char *buffer, std::size_t size)
+{
+    stream.read(buffer, size);
+    return (std::size_t)stream.gcount();
+}
+
+fd_source_t::fd_source_t(int _fd)
+: fd(_fd)
+{}
+
+std::size_t fd_source_t::read(char *buffer, std::size_t size)
+{
+    while (1) {
+        ssize_t n = ::read(fd, buffer, size);
+        if (n >= 0)
+            return (std::size_t)n;
+        if (errno != EINTR)
+            throw std::string("fd_source_t::read(): ") + std::strerror(errno);
+    }
+}
+
+
+// -----
+
+
+input_window_t::input_window_t(input_source_t& _source, std::size_t _chunk_size)
+: source(_source),
+  buffer(),
+  begin(0),
+  offset(0),
+  chunk_size(std::max<std::size_t>(_chunk_size, 1)),
+  peak_size(0),
+  end(false)
+{}
+
+std::string_view input_window_t::get_view() const
+{
+    return std::string_view(buffer).substr(begin);
+}
+
+std::size_t input_window_t::get_offset() const
+{
+    return offset;
+}
+
+bool input_window_t::at_end() const
+{
+    return end;
+}
+
+std::size_t input_window_t::get_peak_size() const
+{
+    return peak_size;
+}
+
+std::size_t input_window_t::fill()
+{
+    if (end)
+        return 0;
+
+    // The discarded bytes only go now, to move the others once per fill
+    buffer.erase(0, begin);
+    begin = 0;
+
+    std::size_t wanted = std::max(chunk_size, buffer.size());
+    std::size_t size = buffer.size();
+    std::size_t got = 0;
+    buffer.resize(size + wanted);
+    while (got < wanted) {
+        std::size_t n = source.read(&buffer[size + got], wanted - got);
+        if (n == 0) {
+            end = true;
+            break;
+        }
+        got += n;
+    }
+    buffer.resize(size + got);
+    peak_size = std::max(peak_size, buffer.size());
+    return got;
+}
+
+void input_window_t::discard(std::size_t n)
+{
+    n = std::min(n, buffer.size() - begin);
+    begin += n;
+    offset += n;
+}
+
+
+// -----
+
+
+// Parses one element (or separator) at index in the window, reading more of
+// the input for as long as the attempt looked past the end of the window: a
+// greedy leaf may have stopped there, or a literal may have been cut short.
+// Filling the window moves it, so the attempt that is returned is always one
+// made after the last fill.
+static parser_state_t parse_in_window(const parser_t *parser, input_window_t& window, std::size_t index, const parse_options_t& options)
+{
+    while (1) {
+        parser_state_t parser_state;
+        parser_state.target_string = window.get_view();
+        parser_state.index = index;
+        parser_state.set_context(std::make_shared<parse_context_t>(options));
+        parser_state = parser->apply(std::move(parser_state));
+
+        // The leaves report how far they looked; the other checks are for
+        // the custom parsers that do not
+        std::size_t size = parser_state.target_string.size();
+        const furthest_failure_t& furthest = parser_state.context->get_furthest_failure();
+        bool reached_end = parser_state.context->lookahead > size
+            || (parser_state.error.has_value() ? parser_state.error.index >= size : parser_state.index >= size)
+            || (furthest.has_value() && furthest.index >= size);
+        if (!reached_end || window.at_end())
+            return parser_state;
+        window.fill();
+    }
+}
+
+stream_result_t parse_stream(const parser_t *list_parser, input_source_t& source, stream_callback_t on_element,
+                             parse_options_t options, std::size_t chunk_size)
+{
+    const parser_t *value_parser = nullptr;
+    const parser_t *separator_parser = nullptr;
+    bool at_least_one = false;
+    if (const separated_by_parser_t *separated_by = dynamic_cast<const separated_by_parser_t*>(list_parser)) {
+        value_parser = separated_by->get_value_parser();
+        separator_parser = separated_by->get_seaparator_parser();
+    } else if (const many_parser_t *many = dynamic_cast<const many_parser_t*>(list_parser)) {
+        value_parser = many->get_parser();
+        at_least_one = dynamic_cast<const many1_parser_t*>(list_parser) != nullptr;
+    } else {
+        throw std::string("parse_stream(): Expected a many_parser_t, many1_parser_t or separated_by_parser_t");
+    }
+
+    input_window_t window(source, chunk_size);
+    window.fill();
+
+    stream_result_t stream_result{parser_state_t(), 0, 0, 0};
+    parser_state_t& parser_state = stream_result.state;
+    parser_state.set_context(std::make_shared<parse_context_t>(options));
+
+    if (value_parser == nullptr || (separator_parser == nullptr && dynamic_cast<const separated_by_parser_t*>(list_parser))) {
+        // Let the list report it
+        parser_state = list_parser->apply(std::move(parser_state));
+    } else {
+        std::size_t index = 0;
+        // Where the current element (and its separator) began in the input
+        std::size_t element_begin = 0;
+        bool value_next = true;
+        parse_error_t depth_error;
+        while (1) {
+            const parser_t *parser = value_next ? value_parser : separator_parser;
+            parser_state_t next_state = parse_in_window(parser, window, index, options);
+            if (next_state.error.has_value()) {
+                if (next_state.context->depth_error.has_value())
+                    depth_error = next_state.error;
+                break;
+            }
+            if (value_next) {
+                element_begin = window.get_offset() + index;
+                ++stream_result.elements;
+                on_element(std::move(next_state.result), element_begin, window.get_offset() + next_state.index);
+            }
+
+            // Nothing can go back before the new index anymore
+            window.discard(next_state.index);
+            index = 0;
+
+            bool element_done = separator_parser == nullptr || !value_next;
+            if (separator_parser != nullptr)
+                value_next = !value_next;
+            // An element matching nothing would be matched forever
+            if (element_done && window.get_offset() == element_begin)
+                break;
+        }
+
+        parser_state.target_string = window.get_view();
+        parser_state.index = index;
+        parser_state.set_result("");
+        if (depth_error.has_value()) {
+            // Going past max_depth fails the whole list, as it does in run()
+            parser_state.index = depth_error.index;
+            parser_state.error = depth_error;
+        } else if (at_least_one && stream_result.elements == 0) {
+            parser_state.fail(list_parser);
+        }
+    }
+
+    // The final state views the window, so it keeps what is left of it
+    std::shared_ptr<const std::string> rest = std::make_shared<const std::string>(parser_state.target_string);
+    parser_state.input = rest;
+    parser_state.target_string = *rest;
+
+    stream_result.index = window.get_offset() + parser_state.index;
+    stream_result.peak_window_size = window.get_peak_size();
+    return stream_result;
+}
+
+
+// -----
+} // namespace wi
@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "string_trie.hpp"
+
+#include <algorithm>
+
+namespace wi {
+// -----
+
+
+string_trie_t::string_trie_t()
+: nodes(1, node_t{{}, npos}),
+  max_length(0),
+  root_edges{}
+{}
+
+string_trie_t& string_trie_t::insert(std::string_view word, std::size_t id)
+{
+    std::uint32_t node = 0;
+    for (char ch : word) {
+        unsigned char c = (unsigned char)ch;
+        std::uint32_t next = child(node, c);
+        if (next == 0) {
+            next = (std::uint32_t)nodes.size();
+            nodes.push_back(node_t{{}, npos});
+            if (node == 0) {
+                root_edges[c] = next;
+            } else {
+                auto& edges = nodes[node].edges;
+                auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(c, (std::uint32_t)0));
+                edges.insert(it, std::make_pair(c, next));
+            }
+        }
+        node = next;
+    }
+    nodes[node].word = std::min(nodes[node].word, id);
+    max_length = std::max(max_length, word.size());
+    return *this;
+}
+
+string_trie_t& string_trie_t::clear()
+{
+    nodes.assign(1, node_t{{}, npos});
+    max_length = 0;
+    std::fill(root_edges, root_edges + 256, 0);
+    return *this;
+}
+
+std::uint32_t string_trie_t::child(std::uint32_t node, unsigned char c) const
+{
+    if (node == 0)
+        return root_edges[c];
+    const auto& edges = nodes[node].edges;
+    if (edges.size() <= 8) {
+        for (const auto& edge : edges) {
+            if (edge.first == c)
+                return edge.second;
+        }
+        return 0;
+    }
+    auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(c, (std::uint32_t)0));
+    return (it != edges.end() && it->first == c) ? it->second : 0;
+}
+
+string_trie_t::match_t string_trie_t::match_first(std::string_view s, std::size_t index) const
+{
+    match_t result{nodes[0].word, 0};
+    std::uint32_t node = 0;
+    for (std::size_t i = index; i < s.size(); ++i) {
+        node = child(node, (unsigned char)s[i]);
+        if (node == 0)
+            break;
+        if (nodes[node].word < result.word)
+            result = match_t{nodes[node].word, i + 1 - index};
+    }
+    return result;
+}
+
+string_trie_t::match_t string_trie_t::match_longest(std::string_view s, std::size_t index) const
+{
+    match_t result{nodes[0].word, 0};
+    std::uint32_t node = 0;
+    for (std::size_t i = index; i < s.size(); ++i) {
+        node = child(node, (unsigned char)s[i]);
+        if (node == 0)
+            break;
+        if (nodes[node].word != npos)
+            result = match_t{nodes[node].word, i + 1 - index};
+    }
+    return result;
+}
+
+bool string_trie_t::extends(std::string_view s, std::size_t index) const
+{
+    std::uint32_t node = 0;
+    for (std::size_t i = index; i < s.size(); ++i) {
+        node = child(node, (unsigned char)s[i]);
+        if (node == 0)
+            return false;
+    }
+    // The root's edges only live in root_edges
+    return node == 0 ? max_length != 0 : !nodes[node].edges.empty();
+}
+
+bool string_trie_t::can_start_with(unsigned char c) const
+{
+    return root_edges[c] != 0;
+}
+
+bool string_trie_t::has_empty_word() const
+{
+    return nodes[0].word != npos;
+}
+
+std::size_t string_trie_t::node_count() const
+{
+    return nodes.size();
+}
+
+std::size_t string_trie_t::get_max_length() const
+{
+    return max_length;
+}
+
+
+// -----
+} // namespace wi
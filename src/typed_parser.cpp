@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "typed_parser.hpp"
+
+namespace wi {
+// -----
+
+
+typed_string_parser_t::typed_string_parser_t(std::string _s)
+: s(_s)
+{}
+
+bool typed_string_parser_t::parse(std::string_view target, std::size_t& index, std::string_view& value) const
+{
+    if (target.size() == 0 || !string_starts_with(target, s, index))
+        return false;
+    value = target.substr(index, s.size());
+    index += s.size();
+    return true;
+}
+
+
+// -----
+
+
+typed_choice_of_string_parser_t::typed_choice_of_string_parser_t(std::vector<std::string> _words)
+: parser(_words)
+{}
+
+typed_choice_of_string_parser_t::typed_choice_of_string_parser_t(std::vector<std::string> _words, choice_of_string_parser_t::match_mode_t _match_mode)
+: parser(_words, _match_mode)
+{}
+
+bool typed_choice_of_string_parser_t::parse(std::string_view s, std::size_t& index, std::string_view& value) const
+{
+    if (s.size() == 0 || index > s.size())
+        return false;
+    const string_trie_t& trie = parser.get_trie();
+    string_trie_t::match_t match = (parser.get_match_mode() == choice_of_string_parser_t::match_mode_t::longest)
+        ? trie.match_longest(s, index)
+        : trie.match_first(s, index);
+    if (match.word == string_trie_t::npos)
+        return false;
+    value = s.substr(index, match.length);
+    index += match.length;
+    return true;
+}
+
+
+// -----
+
+
+typed_char_parser_t::typed_char_parser_t(char_class_t _char_class)
+: char_class(_char_class)
+{}
+
+bool typed_char_parser_t::parse(std::string_view s, std::size_t& index, char& value) const
+{
+    if (index >= s.size() || !char_class.contains((unsigned char)s[index]))
+        return false;
+    value = s[index++];
+    return true;
+}
+
+
+// -----
+
+
+typed_chars_parser_t::typed_chars_parser_t(char_class_t _char_class, bool _allow_empty)
+: scanner(_char_class),
+  allow_empty(_allow_empty)
+{}
+
+bool typed_chars_parser_t::parse(std::string_view s, std::size_t& index, std::string_view& value) const
+{
+    std::size_t from = std::min(index, s.size());
+    std::size_t end = scanner.scan(s, from);
+    if (end == from && !allow_empty)
+        return false;
+    value = s.substr(from, end - from);
+    index = std::max(index, end);
+    return true;
+}
+
+
+// -----
+
+
+typed_legacy_parser_t::typed_legacy_parser_t(const parser_t *_parser)
+: parser(_parser)
+{}
+
+bool typed_legacy_parser_t::parse(std::string_view s, std::size_t& index, std::any& value) const
+{
+    parser_state_t parser_state;
+    parser_state.target_string = s;
+    parser_state.set_index(index);
+    parser_state = parser->apply(parser_state);
+    if (parser_state.error.has_value())
+        return false;
+    value = std::move(parser_state.result);
+    index = parser_state.index;
+    return true;
+}
+
+
+// -----
+} // namespace wi
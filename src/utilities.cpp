@@ -26,7 +26,114 @@ namespace wi {
 // -----
 
 
-bool string_starts_with(std::string s, std::string prefix, std::size_t index)
+std::size_t span_t::size() const
+{
+    return end - begin;
+}
+
+std::string span_t::str() const
+{
+    return std::string(text);
+}
+
+
+// -----
+
+
+any_vector_view_t::any_vector_view_t()
+: data(nullptr),
+  length(0)
+{}
+
+any_vector_view_t::any_vector_view_t(const std::vector<std::any>& v)
+: data(v.data()),
+  length(v.size())
+{}
+
+any_vector_view_t::any_vector_view_t(const std::pmr::vector<std::any>& v)
+: data(v.data()),
+  length(v.size())
+{}
+
+const std::any* any_vector_view_t::begin() const
+{
+    return data;
+}
+
+const std::any* any_vector_view_t::end() const
+{
+    return data + length;
+}
+
+const std::any& any_vector_view_t::operator[](std::size_t i) const
+{
+    return data[i];
+}
+
+std::size_t any_vector_view_t::size() const
+{
+    return length;
+}
+
+bool any_is_vector(const std::any& a)
+{
+    return a.type() == typeid(std::vector<std::any>) ||
+           a.type() == typeid(std::pmr::vector<std::any>);
+}
+
+any_vector_view_t any_vector_view(const std::any& a)
+{
+    if (const std::vector<std::any> *v = std::any_cast< std::vector<std::any> >(&a))
+        return any_vector_view_t(*v);
+    if (const std::pmr::vector<std::any> *v = std::any_cast< std::pmr::vector<std::any> >(&a))
+        return any_vector_view_t(*v);
+    return any_vector_view_t();
+}
+
+// Moves the lists held by the list a, if any, to pending
+static void detach_nested_lists(std::any& a, std::vector<std::any>& pending)
+{
+    if (std::vector<std::any> *v = std::any_cast< std::vector<std::any> >(&a)) {
+        for (std::any& x : *v)
+            if (any_is_vector(x))
+                pending.push_back(std::move(x));
+    } else if (std::pmr::vector<std::any> *v = std::any_cast< std::pmr::vector<std::any> >(&a)) {
+        for (std::any& x : *v)
+            if (any_is_vector(x))
+                pending.push_back(std::move(x));
+    }
+}
+
+void release_any(std::any& a)
+{
+    if (!any_is_vector(a)) {
+        a.reset();
+        return;
+    }
+
+    bool nested = false;
+    for (const std::any& x : any_vector_view(a))
+        nested = nested || any_is_vector(x);
+    if (!nested) {
+        a.reset();
+        return;
+    }
+
+    std::vector<std::any> pending;
+    pending.push_back(std::move(a));
+    a.reset();
+    while (!pending.empty()) {
+        std::any list = std::move(pending.back());
+        pending.pop_back();
+        detach_nested_lists(list, pending);
+    }
+}
+
+
+// -----
+
+
+bool string_starts_with(std::string_view s, std::string_view prefix, std::size_t index)
 {
     if (index + prefix.size() > s.size())
         return false;
@@ -37,37 +144,37 @@ bool string_starts_with(std::string s, std::string prefix, std::size_t index)
     return true;
 }
 
-std::vector<std::any> flatten_vector(std::any pot_v)
+static void flatten_vector_into(const std::any& pot_v, std::vector<std::any>& result)
 {
-    std::vector<std::any> result;
-    if (pot_v.type() != typeid(std::vector<std::any>)) {
-        result.emplace_back(pot_v);
-        return result;
-    }
-    std::vector<std::any> v = std::any_cast< std::vector<std::any> >(pot_v);
-    for (std::any& a : v) {
-        if (a.type() == typeid(std::vector<std::any>)) {
-            std::vector<std::any> aux = flatten_vector(a);
-            for (std::any& x : aux)
-                result.emplace_back(x);
-        } else {
-            result.push_back(a);
-        }
+    if (!any_is_vector(pot_v)) {
+        result.push_back(pot_v);
+        return;
     }
+    for (const std::any& a : any_vector_view(pot_v))
+        flatten_vector_into(a, result);
+}
+
+std::vector<std::any> flatten_vector(const std::any& pot_v)
+{
+    std::vector<std::any> result;
+    flatten_vector_into(pot_v, result);
     return result;
 }
 
-bool any_is_smart_string(std::any a)
+bool any_is_smart_string(const std::any& a)
 {
     return a.type() == typeid(std::string) ||
+           a.type() == typeid(span_t) ||
            a.type() == typeid(char *) ||
            a.type() == typeid(const char *);
 }
 
-std::string smart_string_any_cast(std::any a)
+std::string smart_string_any_cast(const std::any& a)
 {
-    if (a.type() == typeid(std::string))
-        return std::any_cast<std::string>(a);
+    if (const std::string *s = std::any_cast<std::string>(&a))
+        return *s;
+    if (const span_t *span = std::any_cast<span_t>(&a))
+        return span->str();
     if (a.type() == typeid(char *))
         return std::string(std::any_cast<char *>(a));
     if (a.type() == typeid(const char *))
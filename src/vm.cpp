@@ -0,0 +1,793 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "vm.hpp"
+#include "grammar.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+namespace wi {
+// -----
+
+
+namespace {
+
+constexpr std::uint32_t no_target = 0xFFFFFFFF;
+
+// Runs a node the machine cannot look into on a copy of the state, which is
+// only kept if the node did not read (or want to read) past the end of the
+// input; see vm_program_t::execute()
+template<typename F>
+bool apply_within(parser_state_t& parser_state, F apply)
+{
+    parse_context_t *context = parser_state.context.get();
+    std::size_t size = parser_state.target_string.size();
+    std::size_t lookahead = context->lookahead;
+    context->lookahead = 0;
+    parser_state_t next_state = apply(parser_state);
+    bool cut_short = context->lookahead > size || (next_state.error.has_value() && next_state.error.index >= size);
+    context->lookahead = std::max(lookahead, context->lookahead);
+    if (cut_short)
+        return false;
+    parser_state = std::move(next_state);
+    return true;
+}
+
+// Nodes compiled into a single instruction, never worth a subroutine
+bool is_leaf(const parser_t *parser)
+{
+    return dynamic_cast<const string_parser_t*>(parser) != nullptr
+        || dynamic_cast<const choice_of_string_parser_t*>(parser) != nullptr
+        || dynamic_cast<const char_parser_t*>(parser) != nullptr
+        || dynamic_cast<const chars_parser_t*>(parser) != nullptr
+        || dynamic_cast<const maybe_chars_parser_t*>(parser) != nullptr
+        || dynamic_cast<const do_nothing_parser_t*>(parser) != nullptr;
+}
+
+} // namespace
+
+
+// -----
+
+
+const char* vm_opcode_name(vm_opcode_t opcode)
+{
+    switch (opcode) {
+    case vm_opcode_t::end: return "end";
+    case vm_opcode_t::fail: return "fail";
+    case vm_opcode_t::match_string: return "match_string";
+    case vm_opcode_t::match_words: return "match_words";
+    case vm_opcode_t::match_char: return "match_char";
+    case vm_opcode_t::match_chars: return "match_chars";
+    case vm_opcode_t::match_maybe_chars: return "match_maybe_chars";
+    case vm_opcode_t::test_set: return "test_set";
+    case vm_opcode_t::choice: return "choice";
+    case vm_opcode_t::commit: return "commit";
+    case vm_opcode_t::partial_commit: return "partial_commit";
+    case vm_opcode_t::jump: return "jump";
+    case vm_opcode_t::call: return "call";
+    case vm_opcode_t::ret: return "ret";
+    case vm_opcode_t::open_list: return "open_list";
+    case vm_opcode_t::push_value: return "push_value";
+    case vm_opcode_t::close_list: return "close_list";
+    case vm_opcode_t::close_list1: return "close_list1";
+    case vm_opcode_t::pop_value: return "pop_value";
+    case vm_opcode_t::map: return "map";
+    case vm_opcode_t::flatten: return "flatten";
+    case vm_opcode_t::chain: return "chain";
+    case vm_opcode_t::native: return "native";
+    }
+    return "unknown";
+}
+
+
+// -----
+
+
+vm_program_t::vm_program_t(const parser_t *_root)
+: root(_root),
+  instructions(),
+  literals(),
+  scanners(),
+  first_sets(),
+  nodes(),
+  forwards(false),
+  references(),
+  rules(),
+  pending_rules(),
+  calls()
+{
+    if (root == nullptr)
+        throw std::string("vm_program_t::vm_program_t(): root is NULL");
+
+    // Nodes reached more than once (the root counts as reached from above)
+    // become subroutines; every cycle goes through one of them
+    ++references[root];
+    visit_grammar(root, [&](const parser_t *parser) {
+        if (parser->forwards_result())
+            forwards = true;
+        for (const parser_t *child : parser->get_children())
+            ++references[child];
+    });
+
+    first_set_analysis_t analysis(root);
+    compile(root, analysis);
+    emit(vm_opcode_t::end);
+    while (!pending_rules.empty()) {
+        const parser_t *parser = pending_rules.back();
+        pending_rules.pop_back();
+        rules[parser] = (std::uint32_t)instructions.size();
+        compile_node(parser, analysis);
+        emit(vm_opcode_t::ret);
+    }
+    for (const auto& [position, parser] : calls)
+        instructions[position].target = rules[parser];
+
+    references.clear();
+    rules.clear();
+    calls.clear();
+}
+
+std::uint32_t vm_program_t::emit(vm_opcode_t opcode, std::uint32_t arg, std::uint32_t target)
+{
+    instructions.push_back({opcode, arg, target});
+    return (std::uint32_t)instructions.size() - 1;
+}
+
+std::uint32_t vm_program_t::add_node(const parser_t *parser)
+{
+    nodes.push_back(parser);
+    return (std::uint32_t)nodes.size() - 1;
+}
+
+void vm_program_t::compile(const parser_t *parser, const first_set_analysis_t& analysis)
+{
+    if (parser == nullptr)
+        throw std::string("vm_program_t::compile(): the grammar contains a NULL parser");
+    if (references[parser] < 2 || is_leaf(parser)) {
+        compile_node(parser, analysis);
+        return;
+    }
+    if (rules.emplace(parser, no_target).second)
+        pending_rules.push_back(parser);
+    calls.push_back({emit(vm_opcode_t::call), parser});
+}
+
+void vm_program_t::compile_node(const parser_t *parser, const first_set_analysis_t& analysis)
+{
+    if (parser->get_memoize()) {
+        emit(vm_opcode_t::native, add_node(parser));
+        return;
+    }
+
+    if (const lazy_parser_t *lazy = dynamic_cast<const lazy_parser_t*>(parser)) {
+        compile(lazy->get_parser(), analysis);
+        return;
+    }
+
+    if (dynamic_cast<const do_nothing_parser_t*>(parser) != nullptr)
+        return;
+
+    if (const map_parser_t *map = dynamic_cast<const map_parser_t*>(parser)) {
+        compile(map->get_parser(), analysis);
+        if (!map->is_identity())
+            emit(vm_opcode_t::map, add_node(map));
+        return;
+    }
+
+    if (const chain_parser_t *chain = dynamic_cast<const chain_parser_t*>(parser)) {
+        compile(chain->get_parser(), analysis);
+        emit(vm_opcode_t::chain, add_node(chain));
+        return;
+    }
+
+    if (const flatten_parser_t *flatten = dynamic_cast<const flatten_parser_t*>(parser)) {
+        compile(flatten->get_parser(), analysis);
+        emit(vm_opcode_t::flatten);
+        return;
+    }
+
+    if (const sequence_of_parser_t *sequence = dynamic_cast<const sequence_of_parser_t*>(parser)) {
+        emit(vm_opcode_t::open_list);
+        for (const parser_t *child : sequence->get_parsers()) {
+            compile(child, analysis);
+            emit(vm_opcode_t::push_value);
+        }
+        emit(vm_opcode_t::close_list);
+        return;
+    }
+
+    if (const choice_of_parser_t *choice = dynamic_cast<const choice_of_parser_t*>(parser)) {
+        compile_choice(choice->get_parsers(), analysis);
+        return;
+    }
+
+    if (const many1_parser_t *many1 = dynamic_cast<const many1_parser_t*>(parser)) {
+        compile_many(many1->get_parser(), true, analysis);
+        return;
+    }
+
+    if (const many_parser_t *many = dynamic_cast<const many_parser_t*>(parser)) {
+        compile_many(many->get_parser(), false, analysis);
+        return;
+    }
+
+    if (const between_parser_t *between = dynamic_cast<const between_parser_t*>(parser)) {
+        // The content is kept on the value stack while right runs
+        compile(between->get_left_parser(), analysis);
+        compile(between->get_content_parser(), analysis);
+        emit(vm_opcode_t::push_value);
+        compile(between->get_right_parser(), analysis);
+        emit(vm_opcode_t::pop_value);
+        return;
+    }
+
+    if (const separated_by_parser_t *separated_by = dynamic_cast<const separated_by_parser_t*>(parser)) {
+        const parser_t *value = separated_by->get_value_parser();
+        const parser_t *separator = separated_by->get_seaparator_parser();
+        if (value == nullptr || separator == nullptr) {
+            // Reported as an error by run()
+            emit(vm_opcode_t::native, add_node(parser));
+            return;
+        }
+        std::vector<std::uint32_t> exits;
+        emit(vm_opcode_t::open_list);
+        std::uint32_t loop = (std::uint32_t)instructions.size();
+        if (!analysis.get(value).nullable) {
+            first_sets.push_back(analysis.get(value));
+            exits.push_back(emit(vm_opcode_t::test_set, (std::uint32_t)first_sets.size() - 1));
+        }
+        exits.push_back(emit(vm_opcode_t::choice));
+        compile(value, analysis);
+        emit(vm_opcode_t::push_value);
+        emit(vm_opcode_t::commit, 0, (std::uint32_t)instructions.size() + 1);
+        if (!analysis.get(separator).nullable) {
+            first_sets.push_back(analysis.get(separator));
+            exits.push_back(emit(vm_opcode_t::test_set, (std::uint32_t)first_sets.size() - 1));
+        }
+        exits.push_back(emit(vm_opcode_t::choice));
+        compile(separator, analysis);
+        emit(vm_opcode_t::commit, 0, loop);
+        for (std::uint32_t exit : exits)
+            instructions[exit].target = (std::uint32_t)instructions.size();
+        emit(vm_opcode_t::close_list);
+        return;
+    }
+
+    if (const string_parser_t *string = dynamic_cast<const string_parser_t*>(parser)) {
+        literals.push_back(string->get_string());
+        emit(vm_opcode_t::match_string, (std::uint32_t)literals.size() - 1);
+        return;
+    }
+
+    if (dynamic_cast<const choice_of_string_parser_t*>(parser) != nullptr) {
+        emit(vm_opcode_t::match_words, add_node(parser));
+        return;
+    }
+
+    if (const char_parser_t *char_parser = dynamic_cast<const char_parser_t*>(parser)) {
+        scanners.emplace_back(char_parser->get_char_class());
+        emit(vm_opcode_t::match_char, (std::uint32_t)scanners.size() - 1);
+        return;
+    }
+
+    if (const chars_parser_t *chars = dynamic_cast<const chars_parser_t*>(parser)) {
+        scanners.emplace_back(chars->get_char_class());
+        emit(vm_opcode_t::match_chars, (std::uint32_t)scanners.size() - 1);
+        return;
+    }
+
+    if (const maybe_chars_parser_t *maybe_chars = dynamic_cast<const maybe_chars_parser_t*>(parser)) {
+        scanners.emplace_back(maybe_chars->get_char_class());
+        emit(vm_opcode_t::match_maybe_chars, (std::uint32_t)scanners.size() - 1);
+        return;
+    }
+
+    emit(vm_opcode_t::native, add_node(parser));
+}
+
+void vm_program_t::compile_choice(const std::vector<const parser_t*>& parsers, const first_set_analysis_t& analysis)
+{
+    if (parsers.empty()) {
+        emit(vm_opcode_t::fail);
+        return;
+    }
+
+    //     test_set L1   (unless the alternative may match nothing)
+    //     choice L1
+    //     <alternative>
+    //     commit END
+    // L1: ...
+    //     <last alternative>
+    // END:
+    std::vector<std::uint32_t> commits;
+    for (std::size_t i = 0; i + 1 < parsers.size(); ++i) {
+        std::uint32_t test = no_target;
+        first_set_t first = analysis.get(parsers[i]);
+        if (!first.nullable) {
+            first_sets.push_back(first);
+            test = emit(vm_opcode_t::test_set, (std::uint32_t)first_sets.size() - 1);
+        }
+        std::uint32_t choice = emit(vm_opcode_t::choice);
+        compile(parsers[i], analysis);
+        commits.push_back(emit(vm_opcode_t::commit));
+        instructions[choice].target = (std::uint32_t)instructions.size();
+        if (test != no_target)
+            instructions[test].target = (std::uint32_t)instructions.size();
+    }
+    compile(parsers.back(), analysis);
+    for (std::uint32_t commit : commits)
+        instructions[commit].target = (std::uint32_t)instructions.size();
+}
+
+void vm_program_t::compile_many(const parser_t *parser, bool at_least_one, const first_set_analysis_t& analysis)
+{
+    //     open_list
+    // L1: test_set L2   (unless the parser may match nothing)
+    //     choice L2
+    //     <parser>
+    //     push_value
+    //     commit L1
+    // L2: close_list
+    //
+    // Without test_set, the loop keeps its backtrack entry, updated by
+    // partial_commit, and jumps back to <parser>
+    emit(vm_opcode_t::open_list);
+    std::uint32_t loop = (std::uint32_t)instructions.size();
+    std::uint32_t test = no_target;
+    first_set_t first = analysis.get(parser);
+    if (!first.nullable) {
+        first_sets.push_back(first);
+        test = emit(vm_opcode_t::test_set, (std::uint32_t)first_sets.size() - 1);
+    }
+    std::uint32_t choice = emit(vm_opcode_t::choice);
+    compile(parser, analysis);
+    emit(vm_opcode_t::push_value);
+    if (test != no_target)
+        emit(vm_opcode_t::commit, 0, loop);
+    else
+        emit(vm_opcode_t::partial_commit, 0, choice + 1);
+    instructions[choice].target = (std::uint32_t)instructions.size();
+    if (test != no_target)
+        instructions[test].target = (std::uint32_t)instructions.size();
+    emit(at_least_one ? vm_opcode_t::close_list1 : vm_opcode_t::close_list);
+}
+
+
+// -----
+
+
+parser_state_t vm_program_t::run(parser_state_t parser_state) const
+{
+    if (parser_state.error.has_value())
+        return parser_state;
+    if (parser_state.context && (parser_state.context->options.memoize || parser_state.context->in_event_mode()))
+        return root->apply(std::move(parser_state));
+
+    // A failed parse is run again by the grammar, which reports the error;
+    // the incoming result only matters to nodes that forward it
+    const std::size_t initial_index = parser_state.index;
+    std::any initial_result = forwards ? parser_state.result : std::any();
+
+    vm_machine_t machine;
+    if (execute(machine, parser_state) == vm_status_t::failed) {
+        parser_state.index = initial_index;
+        parser_state.error.reset();
+        parser_state.result = std::move(initial_result);
+        parser_state = root->apply(std::move(parser_state));
+        if (parser_state.error.has_value() && parser_state.context && parser_state.context->depth_error.has_value())
+            parser_state.error = parser_state.context->depth_error;
+    }
+    return parser_state;
+}
+
+vm_status_t vm_program_t::execute(vm_machine_t& machine, parser_state_t& parser_state, bool more_input) const
+{
+    const std::string_view s = parser_state.target_string;
+    const bool spans = parser_state.wants_spans();
+    parse_arena_t *arena = parser_state.context ? parser_state.context->get_arena() : nullptr;
+
+    std::vector<vm_frame_t>& stack = machine.stack;
+    std::vector<std::any>& values = machine.values;
+    std::vector<std::any>& saved_results = machine.saved_results;
+    std::uint32_t pc = machine.pc;
+    std::size_t depth = machine.depth;
+    const std::size_t max_depth = parser_state.context ? parser_state.context->options.max_vm_depth : parse_options_t().max_vm_depth;
+
+    auto suspend = [&]() {
+        machine.pc = pc;
+        machine.depth = depth;
+        return vm_status_t::suspended;
+    };
+
+    while (1) {
+        const vm_instruction_t& instruction = instructions[pc];
+        bool matched = true;
+
+        if (more_input && needs_input(instruction, s, parser_state.index))
+            return suspend();
+
+        switch (instruction.opcode) {
+        case vm_opcode_t::end:
+            machine.pc = pc;
+            machine.depth = depth;
+            return vm_status_t::done;
+
+        case vm_opcode_t::fail:
+            matched = false;
+            break;
+
+        case vm_opcode_t::match_string: {
+            const std::string& literal = literals[instruction.arg];
+            parser_state.note_lookahead(parser_state.index + literal.size());
+            if (s.size() != 0 && string_starts_with(s, literal, parser_state.index)) {
+                std::size_t end = parser_state.index + literal.size();
+                parser_state.result = spans ? parser_state.slice(parser_state.index, end) : std::any(literal);
+                parser_state.index = end;
+                ++pc;
+            } else {
+                matched = false;
+            }
+            break;
+        }
+
+        case vm_opcode_t::match_words: {
+            const choice_of_string_parser_t *words = static_cast<const choice_of_string_parser_t*>(nodes[instruction.arg]);
+            matched = false;
+            parser_state.note_lookahead(parser_state.index + words->get_trie().get_max_length());
+            if (s.size() != 0 && parser_state.index <= s.size()) {
+                string_trie_t::match_t match = (words->get_match_mode() == choice_of_string_parser_t::match_mode_t::longest)
+                    ? words->get_trie().match_longest(s, parser_state.index)
+                    : words->get_trie().match_first(s, parser_state.index);
+                if (match.word != string_trie_t::npos) {
+                    std::size_t end = parser_state.index + match.length;
+                    parser_state.result = spans ? parser_state.slice(parser_state.index, end) : std::any(words->get_words()[match.word]);
+                    parser_state.index = end;
+                    matched = true;
+                    ++pc;
+                }
+            }
+            break;
+        }
+
+        case vm_opcode_t::match_char:
+            parser_state.note_lookahead(parser_state.index + 1);
+            if (parser_state.index < s.size() && scanners[instruction.arg].get_char_class().contains((unsigned char)s[parser_state.index])) {
+                parser_state.result = parser_state.slice(parser_state.index, parser_state.index + 1);
+                ++parser_state.index;
+                ++pc;
+            } else {
+                matched = false;
+            }
+            break;
+
+        case vm_opcode_t::match_chars: {
+            std::size_t end = scanners[instruction.arg].scan(s, parser_state.index);
+            parser_state.note_lookahead(end + 1);
+            if (end == parser_state.index || parser_state.index >= s.size()) {
+                matched = false;
+            } else {
+                parser_state.result = parser_state.slice(parser_state.index, end);
+                parser_state.index = end;
+                ++pc;
+            }
+            break;
+        }
+
+        case vm_opcode_t::match_maybe_chars: {
+            std::size_t index = std::min(parser_state.index, s.size());
+            std::size_t end = scanners[instruction.arg].scan(s, index);
+            parser_state.note_lookahead(end + 1);
+            parser_state.result = parser_state.slice(index, end);
+            parser_state.index = std::max(end, parser_state.index);
+            ++pc;
+            break;
+        }
+
+        case vm_opcode_t::test_set: {
+            std::size_t slot = parser_state.index < s.size() ? (unsigned char)s[parser_state.index] : 256;
+            parser_state.note_lookahead(parser_state.index + 1);
+            pc = first_sets[instruction.arg].viable(slot) ? pc + 1 : instruction.target;
+            break;
+        }
+
+        case vm_opcode_t::choice:
+            stack.push_back({choice_frame, instruction.target, parser_state.index, values.size()});
+            if (forwards)
+                saved_results.push_back(parser_state.result);
+            ++pc;
+            break;
+
+        case vm_opcode_t::commit:
+            stack.pop_back();
+            if (forwards)
+                saved_results.pop_back();
+            pc = instruction.target;
+            break;
+
+        case vm_opcode_t::partial_commit: {
+            vm_frame_t& frame = stack.back();
+            frame.index = parser_state.index;
+            frame.values_size = values.size();
+            if (forwards)
+                saved_results.back() = parser_state.result;
+            pc = instruction.target;
+            break;
+        }
+
+        case vm_opcode_t::jump:
+            pc = instruction.target;
+            break;
+
+        case vm_opcode_t::call:
+            if (max_depth != 0 && depth >= max_depth) {
+                // Fails the whole parse at once, rather than trying the
+                // other alternatives
+                parser_state.set_error("vm_program_t::run(): The input is nested too deeply (see parse_options_t::max_vm_depth) at the string \""
+                                       + string_at_most(s, 10, parser_state.index) + "\"");
+                return vm_status_t::done;
+            }
+            stack.push_back({call_frame, pc + 1, 0, 0});
+            ++depth;
+            pc = instruction.target;
+            break;
+
+        case vm_opcode_t::ret:
+            pc = stack.back().pc;
+            stack.pop_back();
+            --depth;
+            break;
+
+        case vm_opcode_t::open_list:
+            stack.push_back({list_frame, 0, 0, values.size()});
+            ++pc;
+            break;
+
+        case vm_opcode_t::push_value:
+            // Nobody reads a result once it was collected, unless some node
+            // forwards it
+            if (forwards)
+                values.push_back(parser_state.result);
+            else
+                values.push_back(std::move(parser_state.result));
+            ++pc;
+            break;
+
+        case vm_opcode_t::close_list:
+        case vm_opcode_t::close_list1: {
+            auto first = values.begin() + stack.back().values_size;
+            if (instruction.opcode == vm_opcode_t::close_list1 && first == values.end()) {
+                matched = false;
+                break;
+            }
+            // One buffer, counted as collect_results() does in parser.cpp
+            if (parser_state.context && first != values.end()) {
+                ++parser_state.context->stats.result_allocations;
+                parser_state.context->stats.result_bytes_allocated += (values.end() - first) * sizeof(std::any);
+            }
+            if (arena != nullptr) {
+                std::pmr::vector<std::any> results(std::make_move_iterator(first), std::make_move_iterator(values.end()), arena);
+                parser_state.result = std::move(results);
+            } else {
+                std::vector<std::any> results(std::make_move_iterator(first), std::make_move_iterator(values.end()));
+                parser_state.result = std::move(results);
+            }
+            values.erase(first, values.end());
+            stack.pop_back();
+            ++pc;
+            break;
+        }
+
+        case vm_opcode_t::pop_value:
+            parser_state.result = std::move(values.back());
+            values.pop_back();
+            ++pc;
+            break;
+
+        case vm_opcode_t::map: {
+            const map_parser_t *map = static_cast<const map_parser_t*>(nodes[instruction.arg]);
+            parser_state.result = map->get_f()(std::move(parser_state.result));
+            ++pc;
+            break;
+        }
+
+        case vm_opcode_t::flatten:
+            parser_state.result = flatten_vector(parser_state.result);
+            ++pc;
+            break;
+
+        case vm_opcode_t::chain: {
+            const chain_parser_t *chain = static_cast<const chain_parser_t*>(nodes[instruction.arg]);
+            if (more_input) {
+                if (!apply_within(parser_state, [&](const parser_state_t& state) { return state.chain(chain->get_f()); }))
+                    return suspend();
+            } else {
+                parser_state = parser_state.chain(chain->get_f());
+            }
+            matched = !parser_state.error.has_value();
+            ++pc;
+            break;
+        }
+
+        case vm_opcode_t::native:
+            if (more_input) {
+                const parser_t *node = nodes[instruction.arg];
+                if (!apply_within(parser_state, [&](const parser_state_t& state) { return node->apply(state); }))
+                    return suspend();
+            } else {
+                parser_state = nodes[instruction.arg]->apply(std::move(parser_state));
+            }
+            matched = !parser_state.error.has_value();
+            ++pc;
+            break;
+        }
+
+        if (matched)
+            continue;
+
+        // Back to the last choice, dropping the calls and lists opened since
+        while (!stack.empty() && stack.back().kind != choice_frame) {
+            if (stack.back().kind == call_frame)
+                --depth;
+            stack.pop_back();
+        }
+        if (stack.empty())
+            return vm_status_t::failed;
+
+        vm_frame_t& frame = stack.back();
+        parser_state.index = frame.index;
+        parser_state.error.reset();
+        if (forwards) {
+            parser_state.result = std::move(saved_results.back());
+            saved_results.pop_back();
+        }
+        for (std::size_t i = frame.values_size; i < values.size(); ++i)
+            release_any(values[i]);
+        values.erase(values.begin() + frame.values_size, values.end());
+        pc = frame.pc;
+        stack.pop_back();
+    }
+}
+
+bool vm_program_t::needs_input(const vm_instruction_t& instruction, std::string_view s, std::size_t index) const
+{
+    switch (instruction.opcode) {
+    case vm_opcode_t::match_string: {
+        // Unless the bytes there already differ from the literal
+        const std::string& literal = literals[instruction.arg];
+        return index + literal.size() > s.size()
+            && (index >= s.size() || literal.compare(0, s.size() - index, s, index) == 0);
+    }
+    case vm_opcode_t::match_words:
+        return index >= s.size() || static_cast<const choice_of_string_parser_t*>(nodes[instruction.arg])->get_trie().extends(s, index);
+    case vm_opcode_t::match_char:
+    case vm_opcode_t::test_set:
+        return index >= s.size();
+    case vm_opcode_t::match_chars:
+    case vm_opcode_t::match_maybe_chars:
+        // The run may go on
+        return scanners[instruction.arg].scan(s, std::min(index, s.size())) >= s.size();
+    default:
+        return false;
+    }
+}
+
+const parser_t* vm_program_t::get_root() const
+{
+    return root;
+}
+
+const std::vector<vm_instruction_t>& vm_program_t::get_instructions() const
+{
+    return instructions;
+}
+
+std::string vm_program_t::to_string() const
+{
+    std::stringstream ss;
+    for (std::size_t pc = 0; pc < instructions.size(); ++pc) {
+        const vm_instruction_t& instruction = instructions[pc];
+        ss << pc << ": " << vm_opcode_name(instruction.opcode);
+        switch (instruction.opcode) {
+        case vm_opcode_t::match_string:
+            ss << " \"" << literals[instruction.arg] << "\"";
+            break;
+        case vm_opcode_t::match_char:
+        case vm_opcode_t::match_chars:
+        case vm_opcode_t::match_maybe_chars:
+            ss << " " << scanners[instruction.arg].get_char_class().to_string();
+            break;
+        case vm_opcode_t::test_set:
+            ss << " " << first_sets[instruction.arg].bytes.to_string() << " else -> " << instruction.target;
+            break;
+        case vm_opcode_t::match_words:
+        case vm_opcode_t::map:
+        case vm_opcode_t::chain:
+        case vm_opcode_t::native:
+            ss << " " << nodes[instruction.arg]->get_name();
+            break;
+        case vm_opcode_t::choice:
+        case vm_opcode_t::commit:
+        case vm_opcode_t::partial_commit:
+        case vm_opcode_t::jump:
+        case vm_opcode_t::call:
+            ss << " -> " << instruction.target;
+            break;
+        default:
+            break;
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+
+parser_state_t parse(const vm_program_t& program, std::string target_string, parse_options_t options)
+{
+    return parse(program, std::make_shared<const std::string>(std::move(target_string)), options);
+}
+
+parser_state_t parse(const vm_program_t& program, std::shared_ptr<const std::string> input, parse_options_t options)
+{
+    parser_state_t parser_state(std::move(input));
+    parser_state.set_context(std::make_shared<parse_context_t>(options));
+    return program.run(parser_state);
+}
+
+
+// -----
+
+
+vm_parser_t::vm_parser_t(const parser_t *root)
+: program(root)
+{}
+
+parser_state_t vm_parser_t::run(parser_state_t parser_state) const
+{
+    return program.run(std::move(parser_state));
+}
+
+std::string vm_parser_t::get_name() const
+{
+    return "vm_parser_t";
+}
+
+first_set_t vm_parser_t::first_set(const first_set_analysis_t& analysis) const
+{
+    return analysis.get(program.get_root());
+}
+
+std::vector<const parser_t*> vm_parser_t::get_children() const
+{
+    return {program.get_root()};
+}
+
+const vm_program_t& vm_parser_t::get_program() const
+{
+    return program;
+}
+
+
+// -----
+} // namespace wi
@@ -21,11 +21,25 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <iostream>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <charconv>
 #include <vector>
 #include <cmath>
 #include <regex>
 
+#include "typed_parser.hpp"
 #include "utilities.hpp"
+#include "static_parser.hpp"
+#include "optimizer.hpp"
+#include "vm.hpp"
+#include "stream.hpp"
+#include "batch.hpp"
+#include "resumable.hpp"
+#include "incremental.hpp"
+#include "mapped_file.hpp"
+#include "grammar.hpp"
 #include "parser.hpp"
 
 
@@ -37,29 +51,30 @@
 void example_lisp() {
     using namespace wi;
     
+    grammar_t g;
     parser_state_t init_parser_state("[% (* 2 (- [+ 8 2] (pow 2 2))) 5]");
 
-    lazy_parser_t *p_lazy_function = new lazy_parser_t();
+    lazy_parser_t *p_lazy_function = g.make<lazy_parser_t>();
 
-    parser_t *p_value = new choice_of_parser_t({
-        new digits_parser_t(),
+    parser_t *p_value = g.make<choice_of_parser_t>({
+        g.make<digits_parser_t>(),
         p_lazy_function
     });
 
-    parser_t *p_function = new between_parser_t(
-        new sequence_of_parser_t({
-            new char_parser_t(std::regex(R"([\(\[])")),
-            new maybe_whitespaces_parser_t()
+    parser_t *p_function = g.make<between_parser_t>(
+        g.make<sequence_of_parser_t>({
+            g.make<char_parser_t>(std::regex(R"([\(\[])")),
+            g.make<maybe_whitespaces_parser_t>()
         }),
-        new sequence_of_parser_t({
-            new maybe_whitespaces_parser_t(),
-            new char_parser_t(std::regex(R"([\)\]])"))
+        g.make<sequence_of_parser_t>({
+            g.make<maybe_whitespaces_parser_t>(),
+            g.make<char_parser_t>(std::regex(R"([\)\]])"))
         }),
-        new sequence_of_parser_t({
-            new choice_of_string_parser_t({"+", "-", "*", "/", "%", "pow"}),
-            new between_parser_t(
-                new whitespaces_parser_t(),
-                new whitespaces_parser_t(),
+        g.make<sequence_of_parser_t>({
+            g.make<choice_of_string_parser_t>({"+", "-", "*", "/", "%", "pow"}),
+            g.make<between_parser_t>(
+                g.make<whitespaces_parser_t>(),
+                g.make<whitespaces_parser_t>(),
                 p_value
             ),
             p_value
@@ -67,6 +82,8 @@ void example_lisp() {
     );
 
     p_lazy_function->set_parser(p_function);
+    // Lets p_value go straight to the alternative the next byte allows
+    build_dispatch_tables(p_function);
     parser_state_t ps = p_function->run(init_parser_state);
 
     std::function<int(std::any)> f = [&](std::any a) {
@@ -96,60 +113,563 @@ void example_lisp() {
 void example_chain() {
     using namespace wi;
     
+    grammar_t g;
     parser_state_t init_parser_state("[% (* 2 (- [+ 8 2] (pow 2 2))) 5]");
 
-    lazy_parser_t *p_lazy_function = new lazy_parser_t();
+    lazy_parser_t *p_lazy_function = g.make<lazy_parser_t>();
 
-    parser_t *p_value = new choice_of_parser_t({
-        new digits_parser_t(),
+    parser_t *p_value = g.make<choice_of_parser_t>({
+        g.make<digits_parser_t>(),
         p_lazy_function
     });
 
-    parser_t *p_function = new between_parser_t(
-        new sequence_of_parser_t({
-            new char_parser_t(std::regex(R"([\(\[])")),
-            new maybe_whitespaces_parser_t()
+    parser_t *p_function = g.make<between_parser_t>(
+        g.make<sequence_of_parser_t>({
+            g.make<char_parser_t>(std::regex(R"([\(\[])")),
+            g.make<maybe_whitespaces_parser_t>()
         }),
-        new sequence_of_parser_t({
-            new maybe_whitespaces_parser_t(),
-            new char_parser_t(std::regex(R"([\)\]])"))
+        g.make<sequence_of_parser_t>({
+            g.make<maybe_whitespaces_parser_t>(),
+            g.make<char_parser_t>(std::regex(R"([\)\]])"))
         }),
-        new sequence_of_parser_t({
-            new choice_of_string_parser_t({"+", "-", "*", "/", "%", "pow"}),
-            new between_parser_t(
-                new whitespaces_parser_t(),
-                new whitespaces_parser_t(),
+        g.make<sequence_of_parser_t>({
+            g.make<choice_of_string_parser_t>({"+", "-", "*", "/", "%", "pow"}),
+            g.make<between_parser_t>(
+                g.make<whitespaces_parser_t>(),
+                g.make<whitespaces_parser_t>(),
                 p_value
             ),
             p_value
         })
     );
 
-    p_lazy_function->set_parser(p_function);
-    parser_state_t ps = p_function->chain([](std::any a) {
-        std::vector<std::any> v = std::any_cast< std::vector<std::any> >(a);
-        if (smart_string_any_cast(v[0]) == "%") {
-            return (parser_t*)new map_parser_t(
-                new do_nothing_parser_t(),
-                []([[maybe_unused]]std::any a) {
-                    return std::any("yoohoo!");
-                }
-            );
+    parser_t *p_replace = g.make<map_parser_t>(
+        g.make<do_nothing_parser_t>(),
+        []([[maybe_unused]]std::any a) {
+            return std::any("yoohoo!");
         }
-        return (parser_t*)new do_nothing_parser_t();
+    );
+    parser_t *p_keep = g.make<do_nothing_parser_t>();
+
+    p_lazy_function->set_parser(p_function);
+    parser_state_t ps = g.chain(p_function, [&](std::any a) {
+        const std::vector<std::any> *v = std::any_cast< std::vector<std::any> >(&a);
+        if (smart_string_any_cast((*v)[0]) == "%")
+            return p_replace;
+        return p_keep;
     })->run(init_parser_state);
 
     std::cout << ps.to_string() << std::endl;
 }
 
+// This example parses the same expression as example_lisp(), but using the
+// typed layer: every parser knows the type of its result, so the expression
+// is evaluated while being parsed, without building any std::any tree.
+void example_typed_lisp() {
+    using namespace wi;
+
+    grammar_t g;
+    typed_lazy_parser_t<int> *p_lazy_function = g.make< typed_lazy_parser_t<int> >();
+
+    auto *p_number = typed_map(g, g.make<typed_chars_parser_t>("[0-9]"), [](std::string_view s) {
+        int x = 0;
+        std::from_chars(s.data(), s.data() + s.size(), x);
+        return x;
+    });
+
+    auto *p_value = typed_choice_of(g, p_number, p_lazy_function);
+
+    auto *p_function = typed_map(g,
+        typed_between(g,
+            typed_sequence_of(g,
+                g.make<typed_char_parser_t>(R"([\(\[])"),
+                g.make<typed_chars_parser_t>(R"(\s)", true)
+            ),
+            typed_sequence_of(g,
+                g.make<typed_chars_parser_t>(R"(\s)", true),
+                g.make<typed_char_parser_t>(R"([\)\]])")
+            ),
+            typed_sequence_of(g,
+                g.make<typed_choice_of_string_parser_t>({"+", "-", "*", "/", "%", "pow"}),
+                typed_between(g,
+                    g.make<typed_chars_parser_t>(R"(\s)"),
+                    g.make<typed_chars_parser_t>(R"(\s)"),
+                    p_value
+                ),
+                p_value
+            )
+        ),
+        [](std::tuple<std::string_view, int, int>&& t) {
+            auto [op, left, right] = t;
+            if (op == "+") return left + right;
+            if (op == "-") return left - right;
+            if (op == "*") return left * right;
+            if (op == "/") return left / right;
+            if (op == "%") return left % right;
+            if (op == "pow") return (int)std::pow(left, right);
+            return 0;
+        }
+    );
+
+    p_lazy_function->set_parser(p_function);
+
+    // The adapter runs the typed grammar like any other parser_t
+    parser_state_t ps = typed_adapter(g, p_function)->run(
+        parser_state_t("[% (* 2 (- [+ 8 2] (pow 2 2))) 5]"));
+
+    std::cout << ps.to_string() << std::endl;
+}
+
+// This example parses the expression of example_typed_lisp() with the
+// compile-time combinators: the whole grammar is a single type, parsed by
+// inlined code, and only the recursion goes through a typed_parser_t.
+void example_static_lisp() {
+    using namespace wi;
+    using namespace wi::st;
+
+    typed_lazy_parser_t<int> lazy_function;
+
+    const auto number = map(chars(digit), [](std::string_view s) {
+        int x = 0;
+        std::from_chars(s.data(), s.data() + s.size(), x);
+        return x;
+    });
+
+    const auto value = alt(number, ref(lazy_function));
+
+    const auto function = map(
+        between(
+            seq(chr(one_of("([")), maybe_chars(space)),
+            seq(maybe_chars(space), chr(one_of(")]"))),
+            seq(
+                alt(lit<'+'>, lit<'-'>, lit<'*'>, lit<'/'>, lit<'%'>, str("pow")),
+                between(chars(space), chars(space), value),
+                value
+            )
+        ),
+        [](std::tuple<std::string_view, int, int>&& t) {
+            auto [op, left, right] = t;
+            if (op == "+") return left + right;
+            if (op == "-") return left - right;
+            if (op == "*") return left * right;
+            if (op == "/") return left / right;
+            if (op == "%") return left % right;
+            if (op == "pow") return (int)std::pow(left, right);
+            return 0;
+        }
+    );
+
+    static_typed_parser_t<decltype(function)> typed_function(function);
+    lazy_function.set_parser(&typed_function);
+
+    grammar_t g;
+    parser_state_t ps = to_parser(g, function)->run(
+        parser_state_t("[% (* 2 (- [+ 8 2] (pow 2 2))) 5]"));
+
+    std::cout << ps.to_string() << std::endl;
+}
+
+// This example shows the packrat mode on a grammar which backtracks a lot:
+// every nesting level re-parses the same nested term up to three times, so
+// the plain run takes exponential time, while the memoized one is linear.
+void example_packrat() {
+    using namespace wi;
+
+    grammar_t g;
+    std::string input = std::string(12, '(') + "a" + std::string(12, ')');
+
+    lazy_parser_t *p_lazy_term = g.make<lazy_parser_t>();
+
+    parser_t *p_term = g.make<choice_of_parser_t>({
+        g.make<between_parser_t>(
+            g.make<string_parser_t>("("),
+            g.make<string_parser_t>(")"),
+            g.make<choice_of_parser_t>({
+                g.make<sequence_of_parser_t>({p_lazy_term, g.make<string_parser_t>("x")}),
+                g.make<sequence_of_parser_t>({p_lazy_term, g.make<string_parser_t>("y")}),
+                p_lazy_term
+            })
+        ),
+        g.make<string_parser_t>("a")
+    });
+
+    p_lazy_term->set_parser(p_term);
+
+    parse_options_t options;
+    options.memoize = true;
+    parser_state_t ps = parse(p_term, input, options);
+    parse_stats_t stats = ps.get_context()->get_stats();
+
+    std::cout << ps.to_string() << std::endl;
+    std::cout << "memo hits: " << stats.memo_hits
+              << ", memo misses: " << stats.memo_misses << std::endl;
+}
+
 
 // -----
 
 
+// The same parse with the result lists on the heap and in an arena: they
+// allocate the same buffers, but the arena takes them from a few blocks.
+void example_arena() {
+    using namespace wi;
+
+    grammar_t g;
+    parser_t *p_config = g.make<separated_by_parser_t>(
+        g.make<string_parser_t>(";"),
+        g.make<sequence_of_parser_t>({
+            g.make<letters_parser_t>(),
+            g.make<string_parser_t>("="),
+            g.make<digits_parser_t>()
+        })
+    );
+    std::string input = "width=80";
+    for (int i = 0; i < 99; ++i)
+        input += ";height=" + std::to_string(i);
+
+    for (bool use_arena : {false, true}) {
+        parse_options_t options;
+        options.use_arena = use_arena;
+        parser_state_t ps = parse(p_config, input, options);
+        parse_stats_t stats = ps.get_context()->get_stats();
+        std::cout << (use_arena ? "arena: " : "heap: ") << stats.result_allocations << " allocations, "
+                  << stats.result_bytes_allocated << " bytes";
+        if (use_arena)
+            std::cout << " (" << stats.arena_allocations << " served from " << stats.arena_blocks << " blocks)";
+        std::cout << std::endl;
+    }
+}
+
+
+// -----
+
+
+void example_optimizer() {
+    using namespace wi;
+
+    grammar_t g;
+    std::string input = "let x; print x ;return y;";
+
+    parser_t *p_keyword = g.make<choice_of_parser_t>({
+        g.make<string_parser_t>("let"),
+        g.make<choice_of_parser_t>({
+            g.make<string_parser_t>("print"),
+            g.make<string_parser_t>("return")
+        })
+    });
+
+    parser_t *p_statement = g.make<sequence_of_parser_t>({
+        p_keyword,
+        g.make<between_parser_t>(
+            g.make<many1_parser_t>(g.make<whitespace_parser_t>()),
+            g.make<sequence_of_parser_t>({
+                g.make<maybe_whitespaces_parser_t>(),
+                g.make<string_parser_t>(";")
+            }),
+            g.make<map_parser_t>(g.make<letters_parser_t>())
+        )
+    });
+
+    parser_t *p_program = g.make<separated_by_parser_t>(
+        g.make<maybe_whitespaces_parser_t>(),
+        g.make<lazy_parser_t>(p_statement)
+    );
+
+    // The keywords become a single trie, the identity map and the lazy go
+    // away and the whitespace before each name is matched by a scanner
+    grammar_t optimized;
+    grammar_optimizer_t optimizer(optimized);
+    const parser_t *p_fast = optimizer.optimize(p_program);
+
+    parser_state_t ps = parse(p_fast, input);
+    std::cout << ps.to_string() << std::endl;
+    std::cout << "same as unoptimized: " << (ps.to_string() == parse(p_program, input).to_string() ? "yes" : "no")
+              << ", nodes: " << optimizer.get_stats().nodes_before << " -> " << optimizer.get_stats().nodes_after << std::endl;
+}
+
+// This example compiles a recursive grammar (nested lists of numbers) into a
+// vm_program_t, which parses without walking the parser_t nodes.
+void example_vm() {
+    using namespace wi;
+
+    grammar_t g;
+    std::string input = "[1, [2, 3], [], [[4]]]";
+
+    lazy_parser_t *p_lazy_list = g.make<lazy_parser_t>();
+    parser_t *p_list = g.make<between_parser_t>(
+        g.make<string_parser_t>("["),
+        g.make<string_parser_t>("]"),
+        g.make<separated_by_parser_t>(
+            g.make<sequence_of_parser_t>({
+                g.make<string_parser_t>(","),
+                g.make<maybe_whitespaces_parser_t>()
+            }),
+            g.make<choice_of_parser_t>({
+                g.make<digits_parser_t>(),
+                p_lazy_list
+            })
+        )
+    );
+    p_lazy_list->set_parser(p_list);
+
+    vm_program_t program(p_list);
+    parser_state_t ps = parse(program, input);
+    std::cout << ps.to_string() << std::endl;
+    std::cout << "same as run(): " << (ps.to_string() == parse(p_list, input).to_string() ? "yes" : "no")
+              << ", instructions: " << program.get_instructions().size() << std::endl;
+
+    // The program keeps its stack on the heap, whereas running the grammar
+    // can be told to stop at parse_options_t::max_depth instead of
+    // overflowing the stack
+    parse_options_t options;
+    options.max_depth = 500;
+    std::string deep = std::string(100000, '[') + std::string(100000, ']');
+    std::cout << "nested 100000 deep: " << (parse(program, deep).error.has_value() ? "failed" : "parsed")
+              << ", run(): " << parse(p_list, deep, options).get_error().value() << std::endl;
+
+    // There is no limit by default, so a right-recursive list (items :=
+    // "a" items | "b") may be longer than any limit one would set
+    lazy_parser_t *p_lazy_items = g.make<lazy_parser_t>();
+    parser_t *p_items = g.make<choice_of_parser_t>({
+        g.make<sequence_of_parser_t>({g.make<string_parser_t>("a"), p_lazy_items}),
+        g.make<string_parser_t>("b")
+    });
+    p_lazy_items->set_parser(p_items);
+    std::string items = std::string(2000, 'a') + "b";
+    std::cout << "2001 items: " << (parse(p_items, items).error.has_value() ? "failed" : "parsed")
+              << ", run() without a context: " << (p_items->run(parser_state_t(items)).error.has_value() ? "failed" : "parsed")
+              << ", with max_depth 500: " << (parse(p_items, items, options).error.has_value() ? "failed" : "parsed") << std::endl;
+}
+
+// Records are handed over one at a time, while the input is read 8 bytes at a
+// time, so that only a record or so is ever held in memory
+void example_stream() {
+    using namespace wi;
+
+    grammar_t g;
+    std::istringstream input("a=1; bb=22; ccc=333; dddd=4444");
+
+    parser_t *p_records = g.make<separated_by_parser_t>(
+        g.make<sequence_of_parser_t>({
+            g.make<string_parser_t>(";"),
+            g.make<maybe_whitespaces_parser_t>()
+        }),
+        g.make<sequence_of_parser_t>({
+            g.make<letters_parser_t>(),
+            g.make<string_parser_t>("="),
+            g.make<digits_parser_t>()
+        })
+    );
+
+    istream_source_t source(input);
+    stream_result_t r = parse_stream(p_records, source, [](std::any record, std::size_t begin, std::size_t end) {
+        std::cout << any_to_string(record) << " at [" << begin << ", " << end << ")" << std::endl;
+    }, parse_options_t(), 8);
+    std::cout << r.elements << " records, " << r.index << " bytes, peak window: " << r.peak_window_size << " bytes" << std::endl;
+
+    // A record nested deeper than max_depth fails the whole list, as it does
+    // in run(), instead of ending it
+    lazy_parser_t *p_lazy_nested = g.make<lazy_parser_t>();
+    parser_t *p_nested = g.make<choice_of_parser_t>({
+        g.make<sequence_of_parser_t>({g.make<string_parser_t>("a"), p_lazy_nested}),
+        g.make<string_parser_t>("b")
+    });
+    p_lazy_nested->set_parser(p_nested);
+    std::istringstream nested("ab\n" + std::string(600, 'a') + "b\nab\n");
+    istream_source_t nested_source(nested);
+    parse_options_t options;
+    options.max_depth = 500;
+    stream_result_t deep = parse_stream(g.make<separated_by_parser_t>(g.make<string_parser_t>("\n"), p_nested), nested_source,
+                                        [](std::any, std::size_t, std::size_t) {}, options, 8);
+    std::cout << deep.elements << " record, then at " << deep.index << ": " << deep.state.get_error().value() << std::endl;
+}
+
+// The file is mapped instead of read, and the keys are spans into the mapping,
+// which they keep mapped: the result outlives the states of the parse
+void example_parse_file() {
+    using namespace wi;
+
+    grammar_t g;
+    parser_t *p_entries = g.make<separated_by_parser_t>(
+        g.make<string_parser_t>("\n"),
+        g.make<sequence_of_parser_t>({
+            g.make<letters_parser_t>(),
+            g.make<string_parser_t>("="),
+            g.make<digits_parser_t>()
+        })
+    );
+
+    std::string path = std::string(P_tmpdir) + "/wiparser_example.txt";
+    std::ofstream(path) << "width=80\nheight=24\ndepth=3";
+
+    parse_options_t options;
+    options.span_results = true;
+    std::any entries;
+    {
+        parser_state_t ps = parse_file(p_entries, path, options);
+        std::remove(path.c_str());
+        if (ps.error.has_value()) {
+            std::cout << ps.get_error().value() << std::endl;
+            return;
+        }
+        std::cout << ps.get_context()->get_stats().input_bytes << " bytes" << std::endl;
+        entries = std::move(ps.result);
+    }
+
+    std::cout << any_to_string(entries) << std::endl;
+    for (const std::any& entry : std::any_cast<const std::vector<std::any>&>(entries)) {
+        const span_t& key = std::any_cast<const span_t&>(std::any_cast<const std::vector<std::any>&>(entry)[0]);
+        std::cout << key.str() << " at [" << key.begin << ", " << key.end << ")" << std::endl;
+    }
+}
+
+void example_events() {
+    using namespace wi;
+
+    grammar_t g;
+    parser_t *p_records = g.make<separated_by_parser_t>(
+        g.make<sequence_of_parser_t>({
+            g.make<string_parser_t>(";"),
+            g.make<maybe_whitespaces_parser_t>()
+        }),
+        g.make<choice_of_parser_t>({
+            g.make<sequence_of_parser_t>({
+                g.make<letters_parser_t>(),
+                g.make<string_parser_t>("="),
+                g.make<digits_parser_t>()
+            }),
+            g.make<letters_parser_t>()
+        })
+    );
+
+    // Only the records are printed; "c" is first tried as a key/value pair,
+    // whose events are dropped when the choice backtracks
+    parse_options_t options;
+    options.on_event = [](const parse_event_t& event) {
+        if (event.kind == parse_event_kind_t::item)
+            std::cout << "record '" << event.text << "' at [" << event.begin << ", " << event.end << ")" << std::endl;
+    };
+    parser_state_t s = parse(p_records, "a=1; bb=22; c; dddd=4444", options);
+    std::cout << "stopped at " << s.index << std::endl;
+}
+
+void example_batch() {
+    using namespace wi;
+
+    grammar_t g;
+    parser_t *p_pair = g.make<sequence_of_parser_t>({
+        g.make<letters_parser_t>(),
+        g.make<string_parser_t>("="),
+        g.make<digits_parser_t>()
+    });
+
+    // The grammar is shared by the threads; the results come in input order
+    std::vector<std::string_view> documents = {"a=1", "bb=22", "ccc=", "dddd=4444"};
+    std::vector<parser_state_t> results = parse_batch(p_pair, documents, 2);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        if (results[i].error.has_value())
+            std::cout << documents[i] << ": " << results[i].get_error().value() << std::endl;
+        else
+            std::cout << documents[i] << ": " << any_to_string(results[i].result) << std::endl;
+    }
+
+    // One input of newline-separated records, cut into chunks after newlines
+    std::string log = "a=1\nbb=22\nccc=\ndddd=4444\n";
+    parser_t *p_lines = g.make<separated_by_parser_t>(g.make<string_parser_t>("\n"), p_pair);
+    chunked_result_t r = parse_chunked(p_lines, log, after_delimiter('\n'), 2, parse_options_t(), 4);
+    std::cout << any_to_string(r.state.result) << " in " << r.chunks << " chunks, stopped at " << r.state.index
+              << ": " << r.stop_error.to_string(log) << std::endl;
+}
+
+void example_resumable() {
+    using namespace wi;
+
+    grammar_t g;
+    parser_t *p_message = g.make<between_parser_t>(
+        g.make<string_parser_t>("GET "),
+        g.make<string_parser_t>("\r\n"),
+        g.make<letters_parser_t>()
+    );
+    vm_program_t program(p_message);
+
+    // The pieces arrive as from a socket; the parse goes on from where the
+    // previous piece left it
+    resumable_parser_t parser(program);
+    for (std::string_view piece : {"GE", "T ind", "ex\r", "\nGET ab", "out\r\n"}) {
+        feed_status_t status = parser.feed(piece);
+        while (status == feed_status_t::done) {
+            std::cout << "message at " << parser.get_offset() << ": " << any_to_string(parser.get_state().result) << std::endl;
+            status = parser.next();
+        }
+    }
+    std::cout << parser.get_suspensions() << " suspensions" << std::endl;
+}
+
+void example_incremental() {
+    using namespace wi;
+
+    grammar_t g;
+    parser_t *p_entry = g.make<sequence_of_parser_t>({
+        g.make<letters_parser_t>(),
+        g.make<string_parser_t>("="),
+        g.make<digits_parser_t>()
+    });
+    parser_t *p_config = g.make<separated_by_parser_t>(g.make<string_parser_t>(";"), p_entry);
+
+    incremental_parser_t parser(p_config, "width=80;height=24;depth=3");
+    // "24" becomes "25"; only the entry around it is parsed again
+    parser.edit({17, 1, "5"});
+    std::cout << any_to_string(parser.get_state().result) << std::endl;
+    std::cout << parser.get_stats().elements_reused << " entries reused, " << parser.get_stats().elements_parsed << " parsed" << std::endl;
+}
+
+void example_profile() {
+    using namespace wi;
+
+    grammar_t g;
+    parser_t *p_decimal = g.make<sequence_of_parser_t>({
+        g.make<digits_parser_t>(),
+        g.make<string_parser_t>("."),
+        g.make<digits_parser_t>()
+    });
+    p_decimal->set_label("decimal");
+    parser_t *p_integer = g.make<digits_parser_t>();
+    p_integer->set_label("integer");
+    parser_t *p_numbers = g.make<separated_by_parser_t>(
+        g.make<string_parser_t>(","),
+        g.make<choice_of_parser_t>({p_decimal, p_integer})
+    );
+
+    // Only recorded when built with _WI_PROFILE_ (make PROFILE=1)
+    parser_state_t ps = parse(p_numbers, "1.5,22,3.25,4");
+    if (!parse_profile_t::is_enabled()) {
+        std::cout << "profiling is off" << std::endl;
+        return;
+    }
+    // The integers are read twice: once by the decimal alternative
+    for (const node_profile_t& node : ps.get_context()->get_profile().get_nodes()) {
+        if (node.parser == p_decimal || node.parser == p_integer)
+            std::cout << node.get_name() << ": " << node.calls << " calls, " << node.failures << " failed, " << node.bytes_backtracked << " bytes backtracked" << std::endl;
+    }
+}
+
 int main() {
     try {
         example_lisp();
         example_chain();
+        example_typed_lisp();
+        example_static_lisp();
+        example_packrat();
+        example_arena();
+        example_optimizer();
+        example_vm();
+        example_stream();
+        example_parse_file();
+        example_events();
+        example_batch();
+        example_resumable();
+        example_incremental();
+        example_profile();
     } catch (std::string s) {
         std::cout << s << std::endl;
     }
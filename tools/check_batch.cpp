@@ -0,0 +1,172 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Checks that a built grammar can be run concurrently: parses random
+// expressions of the grammar of example_lisp() (whose recursion goes through
+// a lazy_parser_t) with parse_batch() on pools of several sizes, with and
+// without memoization, spans and arenas, and requires the same outcome,
+// index, result and error as parsing them one after the other. Also checks
+// that an exception thrown by a map() function reaches the caller, and that
+// parse_chunked() agrees with run() on lists of records, some of which span
+// several lines, are broken or are nested deeper than max_depth.
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lisp_grammar.hpp"
+#include "grammar.hpp"
+#include "utilities.hpp"
+#include "batch.hpp"
+#include "parser.hpp"
+
+int main()
+{
+    wi::grammar_t g;
+    const wi::parser_t *p_lisp = make_lisp_grammar(g);
+
+    std::mt19937 rng(2023);
+    std::vector<std::string> inputs = {"[% (* 2 (- [+ 8 2] (pow 2 2))) 5]", "", "(", "(+ 1 2) trailing"};
+    for (int k = 0; k < 5000; ++k) {
+        std::string s = random_lisp_expression(rng, 1 + rng() % 6);
+        if (rng() % 4 == 0)
+            s[rng() % s.size()] = "x( ]"[rng() % 4];
+        inputs.push_back(s);
+    }
+    std::vector<std::string_view> documents(inputs.begin(), inputs.end());
+
+    std::vector<wi::parse_options_t> configurations(3);
+    configurations[1].memoize = true;
+    configurations[2].span_results = true;
+    configurations[2].use_arena = true;
+
+    std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> thread_counts = {1, 2, 4, hardware, 2 * hardware};
+    std::size_t batches = 0, mismatches = 0;
+    for (const wi::parse_options_t& options : configurations) {
+        std::vector<std::string> expected;
+        for (std::string_view document : documents) {
+            wi::parser_state_t ps = wi::parse(p_lisp, std::string(document), options);
+            expected.push_back(ps.error.has_value() ? "error " + ps.get_error().value()
+                : std::to_string(ps.index) + " " + wi::any_to_string<true>(ps.result));
+        }
+        for (std::size_t threads : thread_counts) {
+            std::vector<wi::parser_state_t> results = wi::parse_batch(p_lisp, documents, threads, options);
+            for (std::size_t i = 0; i < documents.size(); ++i) {
+                const wi::parser_state_t& ps = results[i];
+                std::string got = ps.error.has_value() ? "error " + ps.get_error().value()
+                    : std::to_string(ps.index) + " " + wi::any_to_string<true>(ps.result);
+                if (got != expected[i] && ++mismatches <= 5)
+                    std::cout << "mismatch on \"" << documents[i] << "\" with " << threads << " threads" << std::endl;
+            }
+            ++batches;
+        }
+    }
+
+    // Every map() call happens, once per match, and a throw stops the batch
+    std::atomic<std::size_t> calls(0);
+    const wi::parser_t *p_counted = p_lisp->map([&calls](std::any x) {
+        if (calls.fetch_add(1) == 100)
+            throw std::string("stop");
+        return x;
+    });
+    bool thrown = false;
+    try {
+        wi::parse_batch(p_counted, documents, hardware);
+    } catch (std::string s) {
+        thrown = s == "stop";
+    }
+    if (!thrown) {
+        std::cout << "the exception of a map() function was lost" << std::endl;
+        ++mismatches;
+    }
+
+    // Records such as "key=12" or "key=\"a\nb\"", on one or more lines
+    wi::parser_t *p_record = g.make<wi::sequence_of_parser_t>({
+        g.make<wi::letters_parser_t>(),
+        g.make<wi::string_parser_t>("="),
+        g.make<wi::choice_of_parser_t>({
+            g.make<wi::digits_parser_t>(),
+            g.make<wi::between_parser_t>(
+                g.make<wi::string_parser_t>("\""),
+                g.make<wi::string_parser_t>("\""),
+                g.make<wi::maybe_chars_parser_t>(std::regex("[a-z\n]"))
+            )
+        })
+    });
+    std::vector<const wi::parser_t*> lists = {
+        g.make<wi::many_parser_t>(g.make<wi::sequence_of_parser_t>({p_record, g.make<wi::string_parser_t>("\n")})),
+        g.make<wi::many1_parser_t>(g.make<wi::sequence_of_parser_t>({p_record, g.make<wi::string_parser_t>("\n")})),
+        g.make<wi::separated_by_parser_t>(g.make<wi::string_parser_t>("\n"), p_record)
+    };
+    const char *lines[] = {"a=1\n", "bb=22\n", "c=\"x\ny\"\n", "d=\"\n\"\n", "e=\"\n", "=\n", "f=5"};
+    wi::work_stealing_pool_t pool(4);
+    std::size_t chunked = 0;
+    for (int k = 0; k < 2000; ++k) {
+        std::string input;
+        for (int n = rng() % 200; n > 0; --n)
+            input += lines[rng() % (k % 2 ? 4 : 7)];
+        for (const wi::parser_t *p_list : lists) {
+            wi::parser_state_t expected = wi::parse(p_list, input);
+            wi::chunked_result_t r = wi::parse_chunked(p_list, input, wi::after_delimiter('\n'), pool, wi::parse_options_t(), 1 + rng() % 64);
+            bool same = expected.error.has_value() == r.state.error.has_value() && expected.index == r.state.index
+                && wi::any_to_string<true>(expected.result) == wi::any_to_string<true>(r.state.result)
+                && r.stop_error.has_value() == (r.state.index < input.size());
+            if (!same && ++mismatches <= 5)
+                std::cout << "parse_chunked() mismatch on \"" << input << "\"" << std::endl;
+            ++chunked;
+        }
+    }
+
+    // Records nested one level per "a" (record := "a" record | "b"): one
+    // deeper than max_depth fails the whole list, as in run(), wherever the
+    // chunks are cut
+    wi::lazy_parser_t *p_lazy_nested = g.make<wi::lazy_parser_t>();
+    wi::parser_t *p_nested = g.make<wi::choice_of_parser_t>({
+        g.make<wi::sequence_of_parser_t>({g.make<wi::string_parser_t>("a"), p_lazy_nested}),
+        g.make<wi::string_parser_t>("b")
+    });
+    p_lazy_nested->set_parser(p_nested);
+    wi::parser_t *p_nested_list = g.make<wi::separated_by_parser_t>(g.make<wi::string_parser_t>("\n"), p_nested);
+    wi::parse_options_t shallow;
+    shallow.max_depth = 16;
+    for (int k = 0; k < 500; ++k) {
+        std::string input;
+        for (int n = rng() % 50; n > 0; --n)
+            input += std::string(rng() % (k % 2 ? 16 : 20), 'a') + "b\n";
+        wi::parser_state_t expected = wi::parse(p_nested_list, input, shallow);
+        wi::chunked_result_t r = wi::parse_chunked(p_nested_list, input, wi::after_delimiter('\n'), pool, shallow, 1 + rng() % 64);
+        bool same = expected.error.has_value() == r.state.error.has_value() && expected.index == r.state.index
+            && (expected.error.has_value() ? expected.get_error() == r.state.get_error()
+                : wi::any_to_string<true>(expected.result) == wi::any_to_string<true>(r.state.result));
+        if (!same && ++mismatches <= 5)
+            std::cout << "parse_chunked() mismatch past max_depth on \"" << input << "\"" << std::endl;
+        ++chunked;
+    }
+
+    std::cout << "parse_batch(): " << batches << " batches of " << documents.size() << " documents on up to "
+              << *std::max_element(thread_counts.begin(), thread_counts.end()) << " threads; parse_chunked(): " << chunked << " lists; " << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Checks incremental_parser_t against parsing the edited text from scratch:
+// applies random edits to documents of the grammar of example_lisp(), to
+// lists of "key = value" entries (some of them long enough to be read in
+// several windows), to lists whose elements forward the incoming result and
+// to many1_parser_t lists, with and without memoization of every node, a
+// small max_depth and dispatch tables, and requires the same outcome, index,
+// result and error after every edit.
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lisp_grammar.hpp"
+#include "incremental.hpp"
+#include "first_set.hpp"
+#include "grammar.hpp"
+#include "utilities.hpp"
+#include "parser.hpp"
+
+namespace {
+
+std::string describe(const wi::parser_state_t& ps)
+{
+    if (ps.error.has_value())
+        return "error " + std::to_string(ps.error.index) + " " + ps.error.to_string(ps.target_string);
+    return std::to_string(ps.index) + " " + wi::any_to_string<true>(ps.result);
+}
+
+struct grammars_t {
+    wi::grammar_t g;
+    // Expressions, one per line
+    const wi::parser_t *p_lisp_lines;
+    // Entries such as "ab = 12", separated by ';', each memoized
+    const wi::parser_t *p_entries;
+    // Entries "a" or "ax": the choice reads the byte after the "a"
+    const wi::parser_t *p_optional_x;
+    // Words separated by ',', or nothing, which forwards the separator
+    const wi::parser_t *p_forwarding;
+    // At least one "ab;"
+    const wi::parser_t *p_terminated;
+
+    grammars_t(bool dispatch)
+    {
+        p_lisp_lines = g.make<wi::separated_by_parser_t>(g.make<wi::string_parser_t>("\n"), make_lisp_grammar(g));
+        wi::parser_t *p_entry = g.make<wi::sequence_of_parser_t>({
+            g.make<wi::letters_parser_t>(),
+            g.make<wi::maybe_whitespaces_parser_t>(),
+            g.make<wi::string_parser_t>("="),
+            g.make<wi::maybe_whitespaces_parser_t>(),
+            g.make<wi::choice_of_parser_t>({g.make<wi::digits_parser_t>(), g.make<wi::letters_parser_t>()})
+        });
+        p_entry->set_memoize(true);
+        p_entries = g.make<wi::separated_by_parser_t>(g.make<wi::string_parser_t>(";"), p_entry);
+        wi::parser_t *p_a = g.make<wi::sequence_of_parser_t>({
+            g.make<wi::string_parser_t>("a"),
+            g.make<wi::choice_of_parser_t>({g.make<wi::string_parser_t>("x"), g.make<wi::string_parser_t>("")})
+        });
+        p_a->set_memoize(true);
+        p_optional_x = g.make<wi::many_parser_t>(p_a);
+        p_forwarding = g.make<wi::separated_by_parser_t>(g.make<wi::string_parser_t>(","),
+            g.make<wi::choice_of_parser_t>({g.make<wi::letters_parser_t>(), g.make<wi::do_nothing_parser_t>()}));
+        p_terminated = g.make<wi::many1_parser_t>(g.make<wi::sequence_of_parser_t>({
+            g.make<wi::letters_parser_t>(),
+            g.make<wi::string_parser_t>(";")
+        }));
+        if (dispatch) {
+            wi::build_dispatch_tables(p_lisp_lines);
+            wi::build_dispatch_tables(p_entries);
+            wi::build_dispatch_tables(p_optional_x);
+            wi::build_dispatch_tables(p_forwarding);
+            wi::build_dispatch_tables(p_terminated);
+        }
+    }
+};
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(2023);
+    std::size_t edits = 0, mismatches = 0;
+    auto check = [&](const wi::parser_t *p, const wi::incremental_parser_t& parser, const wi::parse_options_t& options) {
+        wi::parser_state_t expected = wi::parse(p, std::string(parser.get_text()), options);
+        if (describe(expected) != describe(parser.get_state()) && ++mismatches <= 5) {
+            std::cout << "mismatch on \"" << parser.get_text() << "\": " << describe(parser.get_state())
+                      << " instead of " << describe(expected) << std::endl;
+        }
+        ++edits;
+    };
+
+    for (bool dispatch : {false, true}) {
+        grammars_t grammars(dispatch);
+
+        // The byte after an entry decides it: "ayay" becomes "axay"
+        {
+            wi::incremental_parser_t parser(grammars.p_optional_x, "ayay");
+            parser.edit({1, 1, "x"});
+            check(grammars.p_optional_x, parser, wi::parse_options_t());
+        }
+
+        for (int k = 0; k < 1000; ++k) {
+            int kind = k % 5;
+            const wi::parser_t *parsers[] = {
+                grammars.p_lisp_lines, grammars.p_entries, grammars.p_optional_x, grammars.p_forwarding, grammars.p_terminated
+            };
+            const char *alphabets[] = {"()[]+-*/%pow 0123456789\n", "ab=; 12", "axy", "ab,", "ab;"};
+            const wi::parser_t *p = parsers[kind];
+            const char *alphabet = alphabets[kind];
+            std::size_t alphabet_size = std::string(alphabet).size();
+
+            std::string text;
+            for (int n = kind == 1 && k % 4 == 1 ? 1000 : 1 + rng() % 6; n > 0; --n) {
+                if (kind == 0)
+                    text += (text.empty() ? "" : "\n") + random_lisp_expression(rng, 1 + rng() % 4);
+                else if (kind == 1)
+                    text += (text.empty() ? "" : ";") + std::string("ab = ") + std::to_string(rng() % 100);
+                else if (kind == 2)
+                    text += rng() % 2 ? "ax" : "a";
+                else if (kind == 3)
+                    text += (text.empty() ? "" : ",") + std::string(rng() % 2 ? "ab" : "");
+                else
+                    text += rng() % 2 ? "ab;" : "b;";
+            }
+            wi::parse_options_t options;
+            options.memoize = rng() % 2;
+            if (rng() % 4 == 0)
+                options.max_depth = 2 + rng() % 3;
+
+            wi::incremental_parser_t parser(p, text, options);
+            for (int e = 0; e < 40; ++e) {
+                std::size_t size = parser.get_text().size();
+                std::size_t offset = rng() % (size + 1);
+                std::size_t removed = std::min<std::size_t>(rng() % 3, size - offset);
+                std::string inserted;
+                for (int n = rng() % 3; n > 0; --n)
+                    inserted += alphabet[rng() % alphabet_size];
+                parser.edit({offset, removed, inserted});
+                check(p, parser, options);
+            }
+        }
+    }
+
+    std::cout << "incremental_parser_t: " << edits << " edits, " << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Checks the parser generated for the grammar of example_lisp() against the
+// interpreted grammar, on the example's expression and on random ones (valid
+// or slightly broken): both must agree on success, index and result. Also
+// reports how long each one took.
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lisp_parser.hpp"
+#include "lisp_grammar.hpp"
+#include "utilities.hpp"
+#include "parser.hpp"
+
+int main()
+{
+    wi::grammar_t g;
+    const wi::parser_t *p_lisp = make_lisp_grammar(g);
+
+    std::mt19937 rng(2023);
+    std::vector<std::string> inputs = {"[% (* 2 (- [+ 8 2] (pow 2 2))) 5]", "", "(", "(+ 1 2) trailing"};
+    for (int k = 0; k < 20000; ++k) {
+        std::string s = random_lisp_expression(rng, 1 + rng() % 6);
+        if (rng() % 4 == 0)
+            s[rng() % s.size()] = "x( ]"[rng() % 4];
+        inputs.push_back(s);
+    }
+
+    std::size_t parsed = 0, mismatches = 0;
+    double interpreted_seconds = 0, generated_seconds = 0;
+    for (const std::string& input : inputs) {
+        auto start = std::chrono::steady_clock::now();
+        wi::parser_state_t ps = wi::parse(p_lisp, input);
+        auto middle = std::chrono::steady_clock::now();
+        std::size_t index = 0;
+        std::any result = "";
+        bool ok = lisp_parser::parse(input, index, result);
+        auto end = std::chrono::steady_clock::now();
+        interpreted_seconds += std::chrono::duration<double>(middle - start).count();
+        generated_seconds += std::chrono::duration<double>(end - middle).count();
+
+        bool same = ok == !ps.error.has_value();
+        if (same && ok)
+            same = index == ps.index && wi::any_to_string<true>(result) == wi::any_to_string<true>(ps.result);
+        if (!same) {
+            if (++mismatches <= 5)
+                std::cout << "mismatch on \"" << input << "\"" << std::endl;
+        }
+        parsed += ok;
+    }
+
+    std::cout << "generated parser: " << inputs.size() << " inputs, " << parsed << " parsed, "
+              << mismatches << " mismatches; interpreted " << interpreted_seconds * 1e3
+              << " ms, generated " << generated_seconds * 1e3 << " ms" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+// Writes the parser generated for the grammar of example_lisp() to the file
+// given as argument (see `make check_codegen`).
+//
+//   ./codegen_lisp obj/lisp_parser.hpp
+
+#include <iostream>
+#include <fstream>
+
+#include "lisp_grammar.hpp"
+#include "codegen.hpp"
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " OUTPUT" << std::endl;
+        return 1;
+    }
+
+    try {
+        wi::grammar_t g;
+        wi::codegen_options_t options;
+        options.namespace_name = "lisp_parser";
+        std::ofstream(argv[1]) << wi::generate_cpp(make_lisp_grammar(g), options);
+    } catch (std::string s) {
+        std::cerr << s << std::endl;
+        return 1;
+    }
+    return 0;
+}
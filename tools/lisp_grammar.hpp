@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2023 Valentin-Ioan Vintilă
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the “Software”), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+// The grammar of example_lisp() in test.cpp, shared by the code generation
+// tools: a LISP-like expression such as "[% (* 2 (- [+ 8 2] (pow 2 2))) 5]"
+
+#ifndef _WI_TOOLS_LISP_GRAMMAR_HPP_
+#define _WI_TOOLS_LISP_GRAMMAR_HPP_ "1.0.2b"
+
+#include "grammar.hpp"
+#include "parser.hpp"
+
+#include <random>
+#include <string>
+#include <regex>
+
+
+inline const wi::parser_t* make_lisp_grammar(wi::grammar_t& g)
+{
+    using namespace wi;
+
+    lazy_parser_t *p_lazy_function = g.make<lazy_parser_t>();
+
+    parser_t *p_value = g.make<choice_of_parser_t>({
+        g.make<digits_parser_t>(),
+        p_lazy_function
+    });
+
+    parser_t *p_function = g.make<between_parser_t>(
+        g.make<sequence_of_parser_t>({
+            g.make<char_parser_t>(std::regex(R"([\(\[])")),
+            g.make<maybe_whitespaces_parser_t>()
+        }),
+        g.make<sequence_of_parser_t>({
+            g.make<maybe_whitespaces_parser_t>(),
+            g.make<char_parser_t>(std::regex(R"([\)\]])"))
+        }),
+        g.make<sequence_of_parser_t>({
+            g.make<choice_of_string_parser_t>({"+", "-", "*", "/", "%", "pow"}),
+            g.make<between_parser_t>(
+                g.make<whitespaces_parser_t>(),
+                g.make<whitespaces_parser_t>(),
+                p_value
+            ),
+            p_value
+        })
+    );
+
+    p_lazy_function->set_parser(p_function);
+    return p_function;
+}
+
+// A random valid expression of the grammar, at most depth functions deep
+inline std::string random_lisp_expression(std::mt19937& rng, int depth)
+{
+    static const char *ops[] = {"+", "-", "*", "/", "%", "pow"};
+    if (depth == 0 || rng() % 3 == 0)
+        return std::to_string(rng() % 1000);
+    std::string s(1, "(["[rng() % 2]);
+    s += std::string(rng() % 2, ' ') + ops[rng() % 6];
+    s += std::string(1 + rng() % 2, ' ') + random_lisp_expression(rng, depth - 1);
+    s += std::string(1 + rng() % 2, ' ') + random_lisp_expression(rng, depth - 1);
+    s += std::string(rng() % 2, ' ') + ")]"[rng() % 2];
+    return s;
+}
+
+#endif // _WI_TOOLS_LISP_GRAMMAR_HPP_